@@ -20,13 +20,31 @@ inline __attribute__((always_inline)) void ret() {
   asm volatile ("ret");
 }
 
+// stall until an interrupt is pending, even a masked one
+inline __attribute__((always_inline)) void wfi() {
+  asm volatile("wfi" : : : "memory");
+}
+
 inline __attribute__((always_inline)) void sfence() {
   asm volatile("sfence.vma zero, zero");
 }
 
+// flush all non-global translations tagged with asid
+inline __attribute__((always_inline)) void sfence_asid(uint64_t asid) {
+  asm volatile("sfence.vma zero, %0" : : "r" (asid) : "memory");
+}
+
+// flush translations of va in every address space
+inline __attribute__((always_inline)) void sfence_va(uint64_t va) {
+  asm volatile("sfence.vma %0, zero" : : "r" (va) : "memory");
+}
+
 }  // namespace isa
 
 constexpr uint8_t MAX_PMP_REG = 16;
+// mhpmcounter3 .. mhpmcounter31, counter 0 is mcycle and 2 is minstret
+constexpr uint8_t MIN_HPM_COUNTER = 3;
+constexpr uint8_t MAX_HPM_COUNTER = 31;
 
 enum class virtual_addresing : uint64_t {
   Bare = 0,
@@ -34,6 +52,9 @@ enum class virtual_addresing : uint64_t {
   Sv48 = 9uL << 60,
 };
 
+constexpr uint64_t SATP_ASID_OFFSET = 44;
+constexpr uint64_t SATP_ASID_MASK = 0xffffuL;
+
 constexpr uint64_t MPP_OFFSET = 11;
 constexpr uint64_t MPP_MASK = ~(3uL << MPP_OFFSET);
 
@@ -65,6 +86,17 @@ enum class MIE : uint64_t {
   MEIE = 1uL << 11,
 };
 
+// mcounteren / scounteren, a set bit lets the lower mode read the counter
+enum class Counteren : uint64_t {
+  CY = 1uL << 0,
+  TM = 1uL << 1,
+  IR = 1uL << 2,
+};
+
+// csr numbers of the first programmable counter and its event selector
+constexpr uint16_t CSR_MHPMCOUNTER3 = 0xb03;
+constexpr uint16_t CSR_MHPMEVENT3 = 0x323;
+
 enum class PMPBit : uint8_t {
   R     = 1uL << 0,
   W     = 1uL << 1,
@@ -1,6 +1,8 @@
 #ifndef ARCH_RISCV_REG_H
 #define ARCH_RISCV_REG_H
 
+#include <utility>
+
 #include "arch/riscv_isa.h"
 #include "lib/types.h"
 
@@ -93,6 +95,40 @@ struct mscratch_op {
   }
 };
 
+struct mcounteren_op {
+  template <int imm>
+  static void write_imm() {
+    asm volatile ("csrwi mcounteren, %0" : : "i" (imm));
+  }
+
+  static void write(uint64_t v) {
+    asm volatile ("csrw mcounteren, %0" : : "r" (v));
+  }
+
+  static uint64_t read() {
+    uint64_t v = 0;
+    asm volatile ("csrr %0, mcounteren" : "=r" (v));
+    return v;
+  }
+};
+
+struct scounteren_op {
+  template <int imm>
+  static void write_imm() {
+    asm volatile ("csrwi scounteren, %0" : : "i" (imm));
+  }
+
+  static void write(uint64_t v) {
+    asm volatile ("csrw scounteren, %0" : : "r" (v));
+  }
+
+  static uint64_t read() {
+    uint64_t v = 0;
+    asm volatile ("csrr %0, scounteren" : "=r" (v));
+    return v;
+  }
+};
+
 struct mhartid_op {
   static uint64_t read() {
     uint64_t v = 0;
@@ -101,6 +137,30 @@ struct mhartid_op {
   }
 };
 
+struct mcycle_op {
+  static void write(uint64_t v) {
+    asm volatile ("csrw mcycle, %0" : : "r" (v));
+  }
+
+  static uint64_t read() {
+    uint64_t v = 0;
+    asm volatile ("csrr %0, mcycle" : "=r" (v));
+    return v;
+  }
+};
+
+struct minstret_op {
+  static void write(uint64_t v) {
+    asm volatile ("csrw minstret, %0" : : "r" (v));
+  }
+
+  static uint64_t read() {
+    uint64_t v = 0;
+    asm volatile ("csrr %0, minstret" : "=r" (v));
+    return v;
+  }
+};
+
 struct mtval_op {
   static uint64_t read() {
     uint64_t v = 0;
@@ -225,6 +285,14 @@ class SatpImpl {
     asm volatile ("csrw satp, %0" : : "r" (mode | (reinterpret_cast<uint64_t>(root_page) >> 12)));
   }
 
+  inline __attribute__((always_inline)) void write(uint64_t v) {
+    asm volatile ("csrw satp, %0" : : "r" (v));
+  }
+
+  static uint64_t make(riscv::virtual_addresing mode, uint16_t asid, const uint64_t* root_page) {
+    return (mode | (static_cast<uint64_t>(asid) << SATP_ASID_OFFSET)) | (reinterpret_cast<uint64_t>(root_page) >> 12);
+  }
+
   uint64_t read() {
     uint64_t v = 0;
     asm volatile ("csrr %0, satp" : "=r" (v));
@@ -234,6 +302,35 @@ class SatpImpl {
  private:
 };
 
+// A bank of csrs numbered base + index - MIN_HPM_COUNTER. Csr numbers are
+// part of the instruction, so a runtime index picks one of the unrolled
+// accesses.
+template <uint16_t base>
+class HpmBankImpl {
+ public:
+  void write(uint8_t index, uint64_t v) {
+    dispatch(index, [v]<uint16_t csr>() {
+      asm volatile ("csrw %0, %1" : : "i" (csr), "r" (v));
+    }, Indexes{});
+  }
+
+  uint64_t read(uint8_t index) {
+    uint64_t v = 0;
+    dispatch(index, [&v]<uint16_t csr>() {
+      asm volatile ("csrr %0, %1" : "=r" (v) : "i" (csr));
+    }, Indexes{});
+    return v;
+  }
+
+ private:
+  using Indexes = std::make_integer_sequence<uint16_t, MAX_HPM_COUNTER - MIN_HPM_COUNTER + 1>;
+
+  template <typename F, uint16_t... I>
+  static void dispatch(uint8_t index, F&& f, std::integer_sequence<uint16_t, I...>) {
+    ((index == I + MIN_HPM_COUNTER ? (f.template operator()<base + I>(), true) : false) || ...);
+  }
+};
+
 class PMPAddrImpl {
  public:
   void write(uint8_t index, uint64_t v) {
@@ -357,6 +454,12 @@ using mscratch = GeneralReg<mscratch_op>;
 using mcause = McauseImpl;
 using mtval = ReadOnlyReg<mtval_op>;
 using mhartid = ReadOnlyReg<mhartid_op>;
+using mcycle = GeneralReg<mcycle_op>;
+using minstret = GeneralReg<minstret_op>;
+using mhpmcounter = HpmBankImpl<CSR_MHPMCOUNTER3>;
+using mhpmevent = HpmBankImpl<CSR_MHPMEVENT3>;
+using mcounteren = GeneralReg<mcounteren_op>;
+using scounteren = GeneralReg<scounteren_op>;
 using mie = MieImpl;
 
 using satp = SatpImpl;
@@ -380,6 +483,12 @@ namespace regs {
   inline details::mcause mcause;
   inline details::mtval mtval;
   inline details::mhartid mhartid;
+  inline details::mcycle mcycle;
+  inline details::minstret minstret;
+  inline details::mhpmcounter mhpmcounter;
+  inline details::mhpmevent mhpmevent;
+  inline details::mcounteren mcounteren;
+  inline details::scounteren scounteren;
   inline details::mie mie;
 
   inline details::satp satp;
@@ -21,6 +21,7 @@ constexpr inline auto enum_range = [](auto front, auto back) {
 struct DeviceInfo {
   uint64_t device_addr;
   riscv::plic::irq irq;
+  const char* name;
 };
 
 template <class T, std::size_t N>
@@ -38,19 +39,13 @@ struct EnumArray : std::array<T, N> {
 
 EnumArray<DeviceInfo, static_cast<std::underlying_type_t<DeviceList>>(DeviceList::device_list_end)> device_info = {
   // begin
-  DeviceInfo{0, riscv::plic::irq::NONE},
-  // disk0
-  DeviceInfo{memory_layout::VIRTIO0, riscv::plic::irq::VIRTIO0_IRQ},
-  // disk1
-  DeviceInfo{memory_layout::VIRTIO1, riscv::plic::irq::VIRTIO1_IRQ},
-  // gpu0
-  DeviceInfo{memory_layout::VIRTIO2, riscv::plic::irq::VIRTIO2_IRQ},
-  // mouse0
-  DeviceInfo{memory_layout::VIRTIO3, riscv::plic::irq::VIRTIO3_IRQ},
-  // net0
-  DeviceInfo{memory_layout::VIRTIO4, riscv::plic::irq::VIRTIO4_IRQ},
-  // uart0
-  DeviceInfo{memory_layout::UART0, riscv::plic::irq::UARRT0_IRQ},
+  DeviceInfo{0, riscv::plic::irq::NONE, nullptr},
+  DeviceInfo{memory_layout::VIRTIO0, riscv::plic::irq::VIRTIO0_IRQ, "disk0"},
+  DeviceInfo{memory_layout::VIRTIO1, riscv::plic::irq::VIRTIO1_IRQ, "disk1"},
+  DeviceInfo{memory_layout::VIRTIO2, riscv::plic::irq::VIRTIO2_IRQ, "gpu0"},
+  DeviceInfo{memory_layout::VIRTIO3, riscv::plic::irq::VIRTIO3_IRQ, "mouse0"},
+  DeviceInfo{memory_layout::VIRTIO4, riscv::plic::irq::VIRTIO4_IRQ, "net0"},
+  DeviceInfo{memory_layout::UART0, riscv::plic::irq::UARRT0_IRQ, "uart0"},
 };
 
 void DeviceFactory::InitDevices() {
@@ -64,7 +59,7 @@ void DeviceFactory::InitDevices() {
     }
     riscv::plic::irq target_irq = device_info[device_enum].irq;
     if (target_irq != riscv::plic::irq::NONE) {
-      kernel::ExternController::Instance()->Register(target_irq, device);
+      kernel::ExternController::Instance()->Register(target_irq, device, device_info[device_enum].name);
     }
   }
 }
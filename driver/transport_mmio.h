@@ -3,6 +3,7 @@
 #include "driver/virtio.h"
 #include "kernel/printf.h"
 #include "kernel/scheduler.h"
+#include "kernel/trace.h"
 #include <array>
 #include <type_traits>
 #include <utility>
@@ -46,6 +47,7 @@ class mmio_transport {
     queue_->avail.idx += 1;
     device_->internal_data_[descs_[0]].waiting_flag = true;
     __sync_synchronize();
+    kernel::Tracer::Instance()->Record(trace_def::virtio_submit, addr_, descs_[0]);
     MEMORY_MAPPED_IO_W_WORD(addr_ + mmio_addr::QueueNotify, queue_index_);
   }
 
@@ -1,6 +1,7 @@
 #include "driver/virtio.h"
 
 #include "kernel/printf.h"
+#include "kernel/trace.h"
 #include "kernel/utils.h"
 #include "lib/string.h"
 
@@ -21,6 +22,14 @@ Device::Device() : channel_(this) {
 
 }
 
+uint32_t Device::DescInUse(int queue_index) const {
+  uint32_t num = 0;
+  for (uint8_t bits : bit_map_[queue_index]) {
+    num += __builtin_popcount(bits);
+  }
+  return num;
+}
+
 void Device::FreeDesc(uint32_t desc_index, int queue_index) {
   if (desc_index >= queue_buffer_size) {
     kernel::panic("Invalid desc_index[%d] in virt-io: too bigger", desc_index);
@@ -52,6 +61,7 @@ bool DeviceViaMMIO::Validate() {
 void DeviceViaMMIO::ProcessInterrupt() {
   auto interrupt_status = MEMORY_MAPPED_IO_R_WORD(addr_ + mmio_addr::InterruptStatus);
   MEMORY_MAPPED_IO_W_WORD(addr_ + mmio_addr::InterruptACK, interrupt_status & 0x3);
+  kernel::Tracer::Instance()->Record(trace_def::virtio_complete, addr_, interrupt_status);
   if (interrupt_status & interrupt_status::used_buffer_notification) {
     UsedBufferNotify();
   }
@@ -7,7 +7,7 @@
 #include "driver/basic_device.h"
 #include "kernel/config/memory_layout.h"
 #include "kernel/lock/critical_guard.h"
-#include "kernel/lock/spin_lock.h"
+#include "kernel/lock/ticket_lock.h"
 #include "kernel/process.h"
 #include "lib/types.h"
 
@@ -202,6 +202,8 @@ class Device : public BasicDevice {
  public:
   Device();
   virtual device_id GetDeviceId() = 0;
+  // descriptors of the queue handed to the device and not yet returned
+  uint32_t DescInUse(int queue_index) const;
 
  protected:
   int AllocDesc(int queue_index);
@@ -229,7 +231,7 @@ class Device : public BasicDevice {
   };
   InternalData internal_data_[queue_buffer_size];
   uint32_t last_seen_used_idx_[max_queue_num] = {0};
-  kernel::SpinLock lk_[max_queue_num];
+  kernel::TicketLock lk_[max_queue_num];
   kernel::Channel channel_;
 };
 
@@ -11,6 +11,29 @@ BlockDevice::BlockDevice() : DeviceViaMMIO(0)  {
 
 }
 
+void BlockDevice::AccountIo(bool write, uint64_t ticks) {
+  {
+    kernel::CriticalGuard guard(&lk_[0]);
+    if (write) {
+      stats_.writes += 1;
+      stats_.write_ticks += ticks;
+    } else {
+      stats_.reads += 1;
+      stats_.read_ticks += ticks;
+    }
+  }
+  // nobody to charge while the kernel boots
+  auto* task = kernel::Schedueler::Instance()->ThisProcess();
+  if (!task) {
+    return;
+  }
+  if (write) {
+    task->usage.oublock += 1;
+  } else {
+    task->usage.inblock += 1;
+  }
+}
+
 bool BlockDevice::Init(uint64_t virtio_addr) {
   addr_  = virtio_addr;
   if (!Validate()) {
@@ -3,6 +3,7 @@
 #include "driver/transport_mmio.h"
 #include "driver/virtio.h"
 #include "kernel/printf.h"
+#include "kernel/timer.h"
 #include "kernel/utils.h"
 #include "lib/types.h"
 #include <array>
@@ -87,6 +88,14 @@ struct virtio_blk_config {
 
 }  // namespace blk
 
+struct BlockStats {
+  uint64_t reads = 0;
+  uint64_t writes = 0;
+  // mtime from submitting a request until it completed
+  uint64_t read_ticks = 0;
+  uint64_t write_ticks = 0;
+};
+
 template <typename T>
 struct MetaData {
   T* buf = nullptr;
@@ -117,24 +126,34 @@ class BlockDevice : public DeviceViaMMIO {
     }
     const blk::virtio_blk_req req{op == Operation::read ? blk::req_type::VIRTIO_BLK_T_IN : blk::req_type::VIRTIO_BLK_T_OUT, 0, meta_data->block_index};
     blk::virtio_blk_resp resp;
+    uint64_t submit = kernel::TimerManager::Now();
     mmio_transport transport(this, 0, &req, wrap_blk_data<op>(meta_data->buf), &resp);
     transport.trigger_notify();
     transport.wait_complete();
+    uint64_t ticks = kernel::TimerManager::Now() - submit;
     if (resp.status != blk::status_type::VIRTIO_BLK_S_OK) {
       const char* status_msg = resp.status == blk::status_type::VIRTIO_BLK_S_IOERR ? "io error" : "unsupported operation";
       kernel::printf("BlkDevice Operate failed: %s", status_msg);
       return false;
     }
+    AccountIo(op == Operation::write, ticks);
     return true;
   }
 
   uint64_t Capacity();
+  const BlockStats& Stats() const {
+    return stats_;
+  }
   auto GetSupportedOperation() {
     return std::array<Operation, 2>{Operation::read, Operation::write};
   }
 
  private:
+  // charge one block to the device and to the task which issued the request
+  void AccountIo(bool write, uint64_t ticks);
+
   uint64_t capacity_ = 0;
+  BlockStats stats_;
 };
 
 }
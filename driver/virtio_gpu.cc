@@ -6,6 +6,8 @@
 #include "kernel/printf.h"
 #include "kernel/process.h"
 #include "kernel/scheduler.h"
+#include "kernel/slab.h"
+#include "kernel/uaccess.h"
 #include "kernel/utils.h"
 #include "kernel/virtual_memory.h"
 #include "lib/common.h"
@@ -176,15 +178,18 @@ void GPUDevice::ResourceAttachBacking(uint32_t resource_id, uint64_t addr, size_
   };
   fill_desc(&indirect_desc_[0], &backing, virtq_desc_flag::VIRTQ_DESC_F_NEXT, 1);
 
-  uint32_t need_entry_mem = (sizeof(gpu::virtio_gpu_mem_entry) * page_num + memory_layout::PGSIZE - 1) / memory_layout::PGSIZE;
-  auto* entrys = reinterpret_cast<gpu::virtio_gpu_mem_entry*>(kernel::VirtualMemory::Instance()->AllocContinuousPage(need_entry_mem));
+  auto* entrys = reinterpret_cast<gpu::virtio_gpu_mem_entry*>(kernel::kmalloc(sizeof(gpu::virtio_gpu_mem_entry) * page_num));
+  if (!entrys) {
+    kernel::printf("GPUDevice: no memory for %d backing entries\n", page_num);
+    return;
+  }
 
-  std::generate(entrys, entrys + page_num, [size, addr]() mutable {
-    auto* process = kernel::Schedueler::Instance()->ThisProcess();
+  kernel::UserTranslator translator(kernel::Schedueler::Instance()->ThisProcess()->mm->page_table);
+  std::generate(entrys, entrys + page_num, [size, addr, &translator]() mutable {
     uint64_t remain_size = memory_layout::PGSIZE - addr % memory_layout::PGSIZE;
     uint64_t len = std::min(size, remain_size);
     gpu::virtio_gpu_mem_entry entry{
-      kernel::VirtualMemory::Instance()->VAToPA(process->page_table, addr),
+      translator.Translate(addr),
       static_cast<uint32_t>(len),
       0
     };
@@ -213,9 +218,7 @@ void GPUDevice::ResourceAttachBacking(uint32_t resource_id, uint64_t addr, size_
     CHECK_FENCE(&header, (uint64_t)&flags);
   }
 
-  for (uint32_t i =0; i < need_entry_mem; i++) {
-    kernel::VirtualMemory::Instance()->FreePage((uint64_t*)(((uint64_t)entrys) + i * memory_layout::PGSIZE));
-  }
+  kernel::kfree(entrys);
 }
 
 void GPUDevice::ResourceDetachBacking(uint32_t resource_id) {
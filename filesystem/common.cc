@@ -7,6 +7,9 @@
 #include "driver/virtio.h"
 #include "driver/virtio_blk.h"
 #include "filesystem/inode_def.h"
+#include "filesystem/path.h"
+#include "kernel/lock/mutex.h"
+#include "kernel/lock/rw_lock.h"
 #include "kernel/printf.h"
 #include "kernel/scheduler.h"
 #include "kernel/utils.h"
@@ -14,6 +17,11 @@
 
 namespace fs {
 
+// lookups share the directory tree, creating entries and writing files excludes them
+static kernel::RwLock tree_lock;
+// read-modify-write of the block bitmap and of inode table blocks
+static kernel::Mutex meta_lock;
+
 bool GetInode(uint32_t inode_index, fs::InodeDef* inode) {
   uint8_t buf[BLOCK_SIZE];
   driver::virtio::MetaData meta_data{buf, inode_index * fs::INODE_ELEMENT_SIZE / fs::BLOCK_SIZE + 1};
@@ -24,6 +32,7 @@ bool GetInode(uint32_t inode_index, fs::InodeDef* inode) {
 }
 
 bool UpdateInode(uint32_t inode_index, fs::InodeDef* inode) {
+  kernel::LockGuard<kernel::Mutex> guard(&meta_lock);
   uint8_t buf[BLOCK_SIZE];
   driver::virtio::MetaData meta_data{buf, inode_index * fs::INODE_ELEMENT_SIZE / fs::BLOCK_SIZE + 1};
   auto* device = reinterpret_cast<driver::virtio::BlockDevice*>(driver::DeviceFactory::Instance()->GetDevice(driver::DeviceList::disk0));
@@ -67,49 +76,15 @@ int IteratorDir(fs::InodeDef* inode,
   return -1;
 }
 
-static int ParsePathImpl(const char* p, char out_paths[][fs::MAX_FILE_NAME_LEN], bool is_relative = false) {
-  int path_level = -1;
-  const char* paths[16] = {nullptr};
-  if (is_relative) {
-    paths[++path_level] = p;
-  }
-  while (true) {
-    while (*p && *p != '/') {
-      ++p;
-    }
-    if (!*p || !*(p + 1)) {
-      break;
-    } else {
-      ++p;
-      // patten like: "xx//xxx"
-      if (*p == '/') {
-        return -1;
-      }
-      paths[++path_level] = p;
-    }
-  }
-  for (auto i = 0; i <= path_level; i++) {
-    size_t len = (i < path_level) ? paths[i + 1] - paths[i] : strlen(paths[i]);
-    if (len >= fs::MAX_FILE_NAME_LEN) {
-      return -1;
-    }
-    if (paths[i][len - 1] == '/') {
-      len -= 1;
-    }
-    std::copy(paths[i], paths[i] + len, out_paths[i]);
-  }
-  return path_level + 1;
-}
-
 int ParsePath(const char* path_name, char out_paths[][fs::MAX_FILE_NAME_LEN]) {
   if (!path_name || strlen(path_name) == 0) {
     return -1;
   }
   if (path_name[0] != '/') {
-    int level = ParsePathImpl(kernel::Schedueler::Instance()->ThisProcess()->current_path, out_paths);
-    return ParsePathImpl(path_name, out_paths + level, true) + level;
+    int level = SplitPath(kernel::Schedueler::Instance()->ThisProcess()->current_path, out_paths);
+    return SplitPath(path_name, out_paths + level, true) + level;
   } else {
-    return ParsePathImpl(path_name, out_paths);
+    return SplitPath(path_name, out_paths);
   }
 }
 
@@ -136,6 +111,7 @@ ssize_t OpenImpl(const char paths[][fs::MAX_FILE_NAME_LEN], int path_level, Inod
 }
 
 ssize_t Open(const char* path_name, InodeDef* inode) {
+  kernel::ReadGuard guard(&tree_lock);
   char paths[16][fs::MAX_FILE_NAME_LEN] = {0};
   int path_level = ParsePath(path_name, paths);
   if (path_level < 0) {
@@ -145,6 +121,7 @@ ssize_t Open(const char* path_name, InodeDef* inode) {
 }
 
 std::pair<bool, uint32_t> AllocDataBlock() {
+  kernel::LockGuard<kernel::Mutex> guard(&meta_lock);
   fs::SuperBlock super_block{};
   GetSuperNode(&super_block);
   std::array<uint8_t, BLOCK_SIZE> buf;
@@ -197,6 +174,8 @@ std::pair<bool, uint32_t> AllocInode() {
   return {false, 0};
 }
 
+static size_t WriteRange(InodeDef* inode, const char* buf, size_t size, size_t pos);
+
 std::pair<bool, InodeDef> CreateImpl(uint32_t inode_index, FileType type, const char* name, uint8_t major, uint8_t minor) {
   if (strlen(name) > fs::MAX_FILE_NAME_LEN) {
     return {false, InodeDef{}};
@@ -213,7 +192,7 @@ std::pair<bool, InodeDef> CreateImpl(uint32_t inode_index, FileType type, const
   DirElement dir{};
   dir.inum = new_inode_pair.second;
   std::copy(name, name + strlen(name), dir.name);
-  Write(&inode, reinterpret_cast<const char*>(&dir), fs::DIR_ELEMENT_SIZE, inode.size);
+  WriteRange(&inode, reinterpret_cast<const char*>(&dir), fs::DIR_ELEMENT_SIZE, inode.size);
   InodeDef target_inode{};
   target_inode.size = 0;
   if (type == FileType::device) {
@@ -231,6 +210,9 @@ bool WriteImpl(InodeDef* inode, const char* buf, size_t size, size_t pos) {
   auto* device = reinterpret_cast<driver::virtio::BlockDevice*>(driver::DeviceFactory::Instance()->GetDevice(driver::DeviceList::disk0));
   uint32_t addr_index = pos / fs::BLOCK_SIZE;
   uint32_t target_data_block_index = 0;
+  if (pos >= fs::MAX_FILE_SIZE) {
+    return false;
+  }
   if (addr_index < fs::DIRECT_ADDR_SIZE) {
     if (!inode->addr[addr_index]) {
       auto new_block = AllocDataBlock();
@@ -287,7 +269,7 @@ bool WriteImpl(InodeDef* inode, const char* buf, size_t size, size_t pos) {
   return true;
 }
 
-size_t Write(InodeDef* inode, const char* buf, size_t size, size_t pos) {
+static size_t WriteRange(InodeDef* inode, const char* buf, size_t size, size_t pos) {
   if (pos > inode->size) {
     return 0;
   }
@@ -305,7 +287,14 @@ size_t Write(InodeDef* inode, const char* buf, size_t size, size_t pos) {
   return total_size;
 }
 
+size_t Write(InodeDef* inode, const char* buf, size_t size, size_t pos) {
+  // writers update the indirect block and the inode size in place
+  kernel::WriteGuard guard(&tree_lock);
+  return WriteRange(inode, buf, size, pos);
+}
+
 bool Create(const char* path_name, FileType type, uint8_t major, uint8_t minor, fs::InodeDef* target_inode) {
+  kernel::WriteGuard guard(&tree_lock);
   char paths[16][fs::MAX_FILE_NAME_LEN] = {0};
   int path_level = ParsePath(path_name, paths);
   if (path_level < 0) {
@@ -8,6 +8,9 @@ namespace fs {
 
 bool GetInode(uint32_t inode_index, fs::InodeDef* inode);
 ssize_t Open(const char* path, fs::InodeDef* inode);
+// split path into names, relative paths start from the current directory,
+// returns the number of names or -1
+int ParsePath(const char* path_name, char out_paths[][fs::MAX_FILE_NAME_LEN]);
 bool Create(const char* path, FileType type, uint8_t major = 0, uint8_t minor = 0, fs::InodeDef* target_inode = nullptr);
 size_t Write(InodeDef* inode, const char* buf, size_t size, size_t pos);
 
@@ -4,6 +4,11 @@
 #include "filesystem/inode_def.h"
 #include "lib/types.h"
 
+namespace kernel {
+class Pipe;
+class ShmSegment;
+}
+
 namespace fs {
 
 struct FileDescriptor {
@@ -11,6 +16,13 @@ struct FileDescriptor {
   uint64_t offset = 0;
   uint32_t inode_index = 0;
   InodeDef inode{};
+  // FileType::pipe only, the end is the write one if writable
+  kernel::Pipe* pipe = nullptr;
+  bool writable = false;
+  // FileType::shm only, the descriptor holds a reference of it
+  kernel::ShmSegment* shm = nullptr;
+  // slots of dup and fork share the descriptor, with its offset
+  uint32_t ref_count = 1;
 };
 
 }  // namespace fs
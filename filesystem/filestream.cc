@@ -20,20 +20,21 @@ void FileStream::Seek(size_t pos) {
 }
 
 size_t FileStream::Read(char* buf, size_t size) {
+  if (position_ >= inode_.size) {
+    return 0;
+  }
   size = std::min(inode_.size - position_, size);
   auto total_remain_size = size;
-  IndirectBlock indirect_block{};
   while (total_remain_size > 0) {
     size_t remain_size = fs::BLOCK_SIZE - position_ % fs::BLOCK_SIZE;
     size_t len = total_remain_size > remain_size ? remain_size : total_remain_size;
     auto data_block_index = position_ / fs::BLOCK_SIZE;
-    if (data_block_index >= DIRECT_ADDR_SIZE) {
-      if (!indirect_block[0]) {
-        driver::virtio::MetaData data_block_data{indirect_block.data(), ConvertFsBlockToDriveBlock(inode_.indirect_addr)};
-        device_->Operate<driver::virtio::Operation::read>(&data_block_data);
-      }
+    if (data_block_index >= DIRECT_ADDR_SIZE && !has_indirect_block_) {
+      driver::virtio::MetaData data_block_data{indirect_block_.data(), ConvertFsBlockToDriveBlock(inode_.indirect_addr)};
+      device_->Operate<driver::virtio::Operation::read>(&data_block_data);
+      has_indirect_block_ = true;
     }
-    uint64_t write_block_index = ConvertFsBlockToDriveBlock(data_block_index < DIRECT_ADDR_SIZE ? inode_.addr[data_block_index] : indirect_block[data_block_index - DIRECT_ADDR_SIZE]);
+    uint64_t write_block_index = ConvertFsBlockToDriveBlock(data_block_index < DIRECT_ADDR_SIZE ? inode_.addr[data_block_index] : indirect_block_[data_block_index - DIRECT_ADDR_SIZE]);
     if (len == BLOCK_SIZE) {
       driver::virtio::MetaData meta_data{buf, write_block_index};
       device_->Operate<driver::virtio::Operation::read>(&meta_data);
@@ -52,6 +53,9 @@ size_t FileStream::Read(char* buf, size_t size) {
 
 size_t FileStream::write(const char* buf, size_t size) {
   auto write_cnt = Write(&inode_, buf, size, position_);
+  position_ += write_cnt;
+  // the write may have added data blocks to the indirect block
+  has_indirect_block_ = false;
   return write_cnt;
 }
 
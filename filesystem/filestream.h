@@ -17,11 +17,15 @@ class FileStream : public lib::StreamBase {
   virtual size_t Read(char* buf, size_t size) override;
   virtual size_t Size() const override;
 
+  // writes at the position and moves it like Read
   size_t write(const char* buf, size_t size);
 
  private:
   driver::virtio::BlockDevice* device_;
   fs::InodeDef& inode_;
+  // kept across Read calls, so reading a file piece by piece loads it once
+  IndirectBlock indirect_block_{};
+  bool has_indirect_block_ = false;
 };
 
 }  // namespace fs
@@ -8,6 +8,9 @@ const char* FileTypeStr[] = {
   [1] = "directory",
   [2] = "regular_file",
   [3] = "device",
+  [4] = "proc",
+  [5] = "pipe",
+  [6] = "shm",
 };
 
 const char* FileTypeName(FileType type) {
@@ -12,9 +12,12 @@ constexpr uint32_t DIR_ELEMENT_SIZE = 16;
 constexpr uint32_t INODE_ELEMENT_SIZE = 64;
 constexpr uint32_t INODE_TABLE_SIZE = 320;
 constexpr uint32_t MAX_FILE_NAME_LEN = 14;
+constexpr uint32_t MAX_PATH_LEN = 128;
 constexpr uint32_t ROOT_INODE = 0;
 
 using IndirectBlock = std::array<uint32_t, fs::BLOCK_SIZE / sizeof(uint32_t)>;
+// the direct blocks and those of the indirect block
+constexpr uint64_t MAX_FILE_SIZE = (DIRECT_ADDR_SIZE + BLOCK_SIZE / sizeof(uint32_t)) * BLOCK_SIZE;
 
 constexpr const char* FSMAGIC = "oran";
 
@@ -37,6 +40,12 @@ enum class FileType : uint8_t {
   directory,
   regular_file,
   device,
+  // synthetic file under /proc, never stored on disk
+  proc,
+  // kernel buffer between two processes, never stored on disk
+  pipe,
+  // shared memory segment, only good for mmap
+  shm,
 };
 
 const char* FileTypeName(FileType type);
@@ -0,0 +1,44 @@
+#include "filesystem/path.h"
+
+#include <algorithm>
+
+#include "lib/string.h"
+
+namespace fs {
+
+int SplitPath(const char* p, char out_paths[][fs::MAX_FILE_NAME_LEN], bool is_relative) {
+  int path_level = -1;
+  const char* paths[16] = {nullptr};
+  // an empty relative path names no directory at all
+  if (is_relative && *p) {
+    paths[++path_level] = p;
+  }
+  while (true) {
+    while (*p && *p != '/') {
+      ++p;
+    }
+    if (!*p || !*(p + 1)) {
+      break;
+    } else {
+      ++p;
+      // patten like: "xx//xxx"
+      if (*p == '/') {
+        return -1;
+      }
+      paths[++path_level] = p;
+    }
+  }
+  for (auto i = 0; i <= path_level; i++) {
+    size_t len = (i < path_level) ? paths[i + 1] - paths[i] : strlen(paths[i]);
+    if (len >= fs::MAX_FILE_NAME_LEN) {
+      return -1;
+    }
+    if (paths[i][len - 1] == '/') {
+      len -= 1;
+    }
+    std::copy(paths[i], paths[i] + len, out_paths[i]);
+  }
+  return path_level + 1;
+}
+
+}  // namespace fs
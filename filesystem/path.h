@@ -0,0 +1,15 @@
+#ifndef FILESYSTEM_PATH_H
+#define FILESYSTEM_PATH_H
+
+#include "filesystem/inode_def.h"
+
+namespace fs {
+
+// split p at '/' into names, p is taken as the first name when relative,
+// returns the number of names or -1. Free of kernel state so that it can
+// be built for the host.
+int SplitPath(const char* p, char out_paths[][fs::MAX_FILE_NAME_LEN], bool is_relative = false);
+
+}  // namespace fs
+
+#endif  // FILESYSTEM_PATH_H
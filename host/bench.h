@@ -0,0 +1,64 @@
+#pragma once
+
+#include "lib/types.h"
+
+// A small microbenchmark harness for code that does not depend on the
+// hardware, built and run on the host. Every benchmark loops while
+// state.KeepRunning(), the runner grows the iteration count until a run
+// takes long enough to time and prints the cost of one iteration.
+namespace host {
+
+class State {
+ public:
+  explicit State(uint64_t iterations) : iterations_(iterations), remaining_(iterations) {}
+
+  bool KeepRunning() {
+    if (remaining_ == 0) {
+      return false;
+    }
+    remaining_ -= 1;
+    return true;
+  }
+
+  uint64_t iterations() const {
+    return iterations_;
+  }
+
+  // bytes moved by one iteration, adds throughput to the report
+  void SetBytesPerIteration(uint64_t bytes) {
+    bytes_ = bytes;
+  }
+
+  uint64_t bytes() const {
+    return bytes_;
+  }
+
+ private:
+  uint64_t iterations_;
+  uint64_t remaining_;
+  uint64_t bytes_ = 0;
+};
+
+using BenchFunc = void (*)(State& state);
+
+bool Register(const char* name, BenchFunc fn);
+
+// report a benchmark that computed a wrong result and stop
+[[noreturn]] void Fail(const char* file, int line, const char* cond);
+
+// keep the compiler from dropping a computation whose result is unused
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace host
+
+#define HOST_BENCHMARK(fn) static const bool fn##_registered = ::host::Register(#fn, fn)
+
+#define HOST_CHECK(cond)                      \
+  do {                                        \
+    if (!(cond)) {                            \
+      ::host::Fail(__FILE__, __LINE__, #cond); \
+    }                                         \
+  } while (0)
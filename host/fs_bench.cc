@@ -0,0 +1,46 @@
+#include "filesystem/inode_def.h"
+#include "filesystem/path.h"
+#include "host/bench.h"
+#include "lib/string.h"
+
+// the on-disk layout mkfs writes and the kernel reads
+static_assert(sizeof(fs::InodeDef) == fs::INODE_ELEMENT_SIZE);
+static_assert(sizeof(fs::DirElement) == fs::DIR_ELEMENT_SIZE);
+static_assert(fs::BLOCK_SIZE % sizeof(fs::InodeDef) == 0);
+static_assert(fs::BLOCK_SIZE % sizeof(fs::DirElement) == 0);
+static_assert(sizeof(fs::IndirectBlock) == fs::BLOCK_SIZE);
+
+static void SplitPathAbsolute(host::State& state) {
+  char paths[16][fs::MAX_FILE_NAME_LEN];
+  int level = 0;
+  while (state.KeepRunning()) {
+    memset(paths, 0, sizeof(paths));
+    level = fs::SplitPath("/usr/share/doc/readme.txt", paths);
+    host::DoNotOptimize(level);
+  }
+  HOST_CHECK(level == 4);
+  HOST_CHECK(strcmp(paths[0], "usr") == 0 && strcmp(paths[3], "readme.txt") == 0);
+}
+HOST_BENCHMARK(SplitPathAbsolute);
+
+static void SplitPathRelative(host::State& state) {
+  char paths[16][fs::MAX_FILE_NAME_LEN];
+  int level = 0;
+  while (state.KeepRunning()) {
+    memset(paths, 0, sizeof(paths));
+    level = fs::SplitPath("bin/sh/", paths, true);
+    host::DoNotOptimize(level);
+  }
+  HOST_CHECK(level == 2);
+  HOST_CHECK(strcmp(paths[0], "bin") == 0 && strcmp(paths[1], "sh") == 0);
+}
+HOST_BENCHMARK(SplitPathRelative);
+
+static void SplitPathInvalid(host::State& state) {
+  char paths[16][fs::MAX_FILE_NAME_LEN];
+  while (state.KeepRunning()) {
+    HOST_CHECK(fs::SplitPath("/usr//bin", paths) == -1);
+    HOST_CHECK(fs::SplitPath("/a_name_longer_than_fourteen", paths) == -1);
+  }
+}
+HOST_BENCHMARK(SplitPathInvalid);
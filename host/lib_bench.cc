@@ -0,0 +1,85 @@
+#include <stdarg.h>
+
+#include "host/bench.h"
+#include "lib/memory.h"
+#include "lib/printk.h"
+#include "lib/stl/vector.h"
+#include "lib/string.h"
+
+// lib::malloc takes small sizes from spans and the rest from MemManager.
+
+static void MallocFreeSmall(host::State& state) {
+  while (state.KeepRunning()) {
+    void* p = lib::malloc(64);
+    HOST_CHECK(p != nullptr);
+    host::DoNotOptimize(p);
+    lib::free(p);
+  }
+}
+HOST_BENCHMARK(MallocFreeSmall);
+
+static void MallocFreeLarge(host::State& state) {
+  while (state.KeepRunning()) {
+    void* p = lib::malloc(8192);
+    HOST_CHECK(p != nullptr);
+    host::DoNotOptimize(p);
+    lib::free(p);
+  }
+}
+HOST_BENCHMARK(MallocFreeLarge);
+
+// a window of live blocks of mixed sizes, closer to what programs do
+static void MallocFreeMixed(host::State& state) {
+  constexpr int WINDOW = 64;
+  constexpr uint32_t sizes[] = {16, 24, 48, 100, 256, 600, 1500, 4000};
+  void* live[WINDOW] = {nullptr};
+  uint64_t i = 0;
+  while (state.KeepRunning()) {
+    void*& slot = live[i % WINDOW];
+    if (slot) {
+      lib::free(slot);
+    }
+    uint32_t size = sizes[(i * 7) % std::size(sizes)];
+    slot = lib::malloc(size);
+    HOST_CHECK(slot != nullptr && reinterpret_cast<uint64_t>(slot) % 8 == 0);
+    // the block must be writable in full
+    static_cast<char*>(slot)[size - 1] = 1;
+    i += 1;
+  }
+  for (void* p : live) {
+    if (p) {
+      lib::free(p);
+    }
+  }
+}
+HOST_BENCHMARK(MallocFreeMixed);
+
+static void VectorPushBack(host::State& state) {
+  constexpr int NUM = 1024;
+  while (state.KeepRunning()) {
+    lib::vector<int> v;
+    for (int i = 0; i < NUM; ++i) {
+      v.push_back(i);
+    }
+    HOST_CHECK(v.size() == NUM && v[NUM - 1] == NUM - 1);
+  }
+  state.SetBytesPerIteration(NUM * sizeof(int));
+}
+HOST_BENCHMARK(VectorPushBack);
+
+static int Format(char* out, const char* fmt, ...) {
+  va_list va;
+  va_start(va, fmt);
+  int len = simple_vsprintf(&out, fmt, va, nullptr);
+  va_end(va);
+  return len;
+}
+
+static void Vsprintf(host::State& state) {
+  char buf[128];
+  while (state.KeepRunning()) {
+    host::DoNotOptimize(Format(buf, "%s pid %d at %lx %-8s|", "task", 42, 0x8020'0000uL, "run"));
+  }
+  HOST_CHECK(strcmp(buf, "task pid 42 at 80200000 run     |") == 0);
+}
+HOST_BENCHMARK(Vsprintf);
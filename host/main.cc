@@ -0,0 +1,97 @@
+#include <time.h>
+
+#include "host/bench.h"
+#include "lib/lib.h"
+#include "lib/string.h"
+
+namespace host {
+
+namespace {
+
+struct Benchmark {
+  const char* name;
+  BenchFunc fn;
+};
+
+constexpr int MAX_BENCHMARKS = 64;
+Benchmark benchmarks[MAX_BENCHMARKS];
+int benchmark_num = 0;
+
+// a run shorter than this is repeated with more iterations
+constexpr uint64_t MIN_RUN_NS = 200'000'000;
+constexpr uint64_t MAX_ITERATIONS = 1'000'000'000;
+
+uint64_t NowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1'000'000'000 + ts.tv_nsec;
+}
+
+void Run(const Benchmark& benchmark) {
+  uint64_t iterations = 1;
+  while (true) {
+    State state(iterations);
+    uint64_t start = NowNs();
+    benchmark.fn(state);
+    uint64_t elapsed = NowNs() - start;
+    if (elapsed >= MIN_RUN_NS || iterations >= MAX_ITERATIONS) {
+      // hundredths of a nanosecond without floating point
+      uint64_t centi_ns = elapsed * 100 / iterations;
+      printf("%-36s %10lu iters %8lu.%02lu ns/op", benchmark.name, iterations, centi_ns / 100, centi_ns % 100);
+      if (state.bytes() && elapsed) {
+        printf(" %8lu MB/s", state.bytes() * iterations * 1000 / elapsed);
+      }
+      printf("\n");
+      return;
+    }
+    // aim a bit past the minimum so that the next run is likely the last
+    uint64_t next = elapsed ? iterations * MIN_RUN_NS * 3 / 2 / elapsed : iterations * 100;
+    iterations = next > iterations * 100 ? iterations * 100 : (next > iterations ? next : iterations * 2);
+  }
+}
+
+bool Contains(const char* s, const char* part) {
+  size_t len = strlen(part);
+  for (size_t left = strlen(s); left >= len; --left, ++s) {
+    if (memcmp(s, part, len) == 0) {
+      return true;
+    }
+    if (left == 0) {
+      break;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool Register(const char* name, BenchFunc fn) {
+  if (benchmark_num == MAX_BENCHMARKS) {
+    printf(PrintLevel::error, "host_bench: too many benchmarks, raise MAX_BENCHMARKS\n");
+    return false;
+  }
+  benchmarks[benchmark_num++] = {name, fn};
+  return true;
+}
+
+void Fail(const char* file, int line, const char* cond) {
+  printf(PrintLevel::error, "%s:%d: check failed: %s\n", file, line, cond);
+  syscall::exit(1);
+  __builtin_unreachable();
+}
+
+}  // namespace host
+
+// host_bench [filter...], runs the benchmarks whose name contains a filter
+int main(int argc, char** argv) {
+  for (int i = 0; i < host::benchmark_num; ++i) {
+    bool selected = argc == 1;
+    for (int j = 1; j < argc; ++j) {
+      selected |= host::Contains(host::benchmarks[i].name, argv[j]);
+    }
+    if (selected) {
+      host::Run(host::benchmarks[i]);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,43 @@
+#include "host/test.h"
+#include "kernel/virtual_memory.h"
+
+static kernel::MemoryChunk chunks[4];
+
+HOST_TEST(MemoryListPopsLastPushed) {
+  kernel::MemoryList list;
+  HOST_EXPECT(list.Pop() == nullptr);
+  for (auto& chunk : chunks) {
+    list.Push(&chunk);
+  }
+  HOST_EXPECT(list.Size() == 4);
+  for (int i = 3; i >= 0; --i) {
+    HOST_EXPECT(list.Pop() == &chunks[i]);
+  }
+  HOST_EXPECT(list.Size() == 0 && list.Pop() == nullptr);
+}
+
+HOST_TEST(MemoryListEraseHeadMiddleTail) {
+  kernel::MemoryList list;
+  for (auto& chunk : chunks) {
+    list.Push(&chunk);
+  }
+  // chunks[3] is the head, chunks[0] the tail
+  HOST_EXPECT(list.Erase(&chunks[1]));
+  HOST_EXPECT(list.Erase(&chunks[3]));
+  HOST_EXPECT(list.Erase(&chunks[0]));
+  HOST_EXPECT(list.Size() == 1);
+  HOST_EXPECT(list.Pop() == &chunks[2]);
+  HOST_EXPECT(list.Pop() == nullptr);
+}
+
+HOST_TEST(MemoryListRejectsForeignChunks) {
+  kernel::MemoryList list;
+  kernel::MemoryList other;
+  list.Push(&chunks[0]);
+  other.Push(&chunks[1]);
+  HOST_EXPECT(!list.Erase(&chunks[1]));
+  HOST_EXPECT(list.Erase(&chunks[0]));
+  // already erased
+  HOST_EXPECT(!list.Erase(&chunks[0]));
+  HOST_EXPECT(list.Size() == 0 && other.Size() == 1);
+}
@@ -0,0 +1,111 @@
+#include "host/test.h"
+#include "lib/memory.h"
+#include "lib/string.h"
+
+// lib::malloc takes sizes up to the largest size class from spans and the
+// rest from MemManager, the tests cross that boundary on purpose.
+
+static bool Filled(const void* p, char c, size_t len) {
+  auto* bytes = static_cast<const char*>(p);
+  for (size_t i = 0; i < len; ++i) {
+    if (bytes[i] != c) {
+      return false;
+    }
+  }
+  return true;
+}
+
+HOST_TEST(CallocOverflowReturnsNull) {
+  HOST_EXPECT(lib::calloc(0x10000, 0x10000) == nullptr);
+  HOST_EXPECT(lib::calloc(UINT32_MAX, 2) == nullptr);
+  HOST_EXPECT(lib::calloc(2, UINT32_MAX) == nullptr);
+}
+
+HOST_TEST(CallocZeroesReusedMemory) {
+  void* dirty = lib::malloc(100);
+  memset(dirty, 0x5a, 100);
+  lib::free(dirty);
+  void* p = lib::calloc(10, 10);
+  HOST_EXPECT(p != nullptr);
+  HOST_EXPECT(Filled(p, 0, 100));
+  lib::free(p);
+}
+
+HOST_TEST(ReallocGrowKeepsContents) {
+  // from a span into MemManager
+  auto* p = static_cast<char*>(lib::malloc(16));
+  memset(p, 'a', 16);
+  p = static_cast<char*>(lib::realloc(p, 4000));
+  HOST_EXPECT(p != nullptr);
+  HOST_EXPECT(Filled(p, 'a', 16));
+  memset(p, 'b', 4000);
+  p = static_cast<char*>(lib::realloc(p, 9000));
+  HOST_EXPECT(p != nullptr);
+  HOST_EXPECT(Filled(p, 'b', 4000));
+  lib::free(p);
+}
+
+HOST_TEST(ReallocShrinkKeepsContents) {
+  auto* p = static_cast<char*>(lib::malloc(4000));
+  for (int i = 0; i < 4000; ++i) {
+    p[i] = static_cast<char>(i);
+  }
+  p = static_cast<char*>(lib::realloc(p, 10));
+  HOST_EXPECT(p != nullptr);
+  for (int i = 0; i < 10; ++i) {
+    HOST_EXPECT(p[i] == static_cast<char>(i));
+  }
+  lib::free(p);
+}
+
+HOST_TEST(ReallocNullAllocates) {
+  void* p = lib::realloc(nullptr, 48);
+  HOST_EXPECT(p != nullptr);
+  memset(p, 1, 48);
+  lib::free(p);
+}
+
+HOST_TEST(AlignedAllocAligns) {
+  constexpr uint32_t sizes[] = {1, 100, 2048, 3000};
+  for (uint32_t alignment = 8; alignment <= 8192; alignment *= 2) {
+    for (uint32_t size : sizes) {
+      auto* p = static_cast<char*>(lib::aligned_alloc(alignment, size));
+      HOST_EXPECT(p != nullptr);
+      HOST_EXPECT(reinterpret_cast<uint64_t>(p) % alignment == 0);
+      memset(p, 0x7e, size);
+      // free exits the process if it does not recognize the pointer
+      lib::free(p);
+    }
+  }
+}
+
+HOST_TEST(AlignedAllocRejectsBadArgs) {
+  HOST_EXPECT(lib::aligned_alloc(0, 16) == nullptr);
+  HOST_EXPECT(lib::aligned_alloc(24, 16) == nullptr);
+  HOST_EXPECT(lib::aligned_alloc(4096, UINT32_MAX - 100) == nullptr);
+}
+
+// blocks on both sides of every size class and of the span limit do not overlap
+HOST_TEST(SizeClassBoundaries) {
+  constexpr uint32_t sizes[] = {1, 15, 16, 17, 32, 33, 127, 128, 129, 1024, 1025,
+                                2047, 2048, 2049, 2050, 4096, 16 * 1024, 16 * 1024 + 1};
+  constexpr int NUM = sizeof(sizes) / sizeof(sizes[0]);
+  void* blocks[NUM];
+  for (int i = 0; i < NUM; ++i) {
+    blocks[i] = lib::malloc(sizes[i]);
+    HOST_EXPECT(blocks[i] != nullptr);
+    HOST_EXPECT(reinterpret_cast<uint64_t>(blocks[i]) % 8 == 0);
+    memset(blocks[i], 'A' + i, sizes[i]);
+  }
+  for (int i = 0; i < NUM; ++i) {
+    HOST_EXPECT(Filled(blocks[i], 'A' + i, sizes[i]));
+    lib::free(blocks[i]);
+  }
+}
+
+HOST_TEST(FreedBlocksAreReused) {
+  void* small = lib::malloc(64);
+  lib::free(small);
+  HOST_EXPECT(lib::malloc(64) == small);
+  lib::free(small);
+}
@@ -0,0 +1,47 @@
+#include "filesystem/path.h"
+#include "host/test.h"
+#include "lib/string.h"
+
+static char paths[16][fs::MAX_FILE_NAME_LEN];
+
+// names are copied without a terminator, start from a clean table
+static int Split(const char* p, bool is_relative = false) {
+  memset(paths, 0, sizeof(paths));
+  return fs::SplitPath(p, paths, is_relative);
+}
+
+HOST_TEST(SplitPathNames) {
+  HOST_EXPECT(Split("/usr/share/readme.txt") == 3);
+  HOST_EXPECT(strcmp(paths[0], "usr") == 0);
+  HOST_EXPECT(strcmp(paths[1], "share") == 0);
+  HOST_EXPECT(strcmp(paths[2], "readme.txt") == 0);
+  HOST_EXPECT(Split("bin/sh", true) == 2);
+  HOST_EXPECT(strcmp(paths[0], "bin") == 0 && strcmp(paths[1], "sh") == 0);
+}
+
+HOST_TEST(SplitPathDoubleSlash) {
+  HOST_EXPECT(Split("//") == -1);
+  HOST_EXPECT(Split("/usr//bin") == -1);
+  HOST_EXPECT(Split("usr//bin", true) == -1);
+}
+
+HOST_TEST(SplitPathTrailingSlash) {
+  HOST_EXPECT(Split("/") == 0);
+  HOST_EXPECT(Split("/usr/bin/") == 2);
+  HOST_EXPECT(strcmp(paths[1], "bin") == 0);
+  HOST_EXPECT(Split("bin/", true) == 1);
+  HOST_EXPECT(strcmp(paths[0], "bin") == 0);
+}
+
+HOST_TEST(SplitPathEmpty) {
+  HOST_EXPECT(Split("") == 0);
+  HOST_EXPECT(Split("", true) == 0);
+}
+
+HOST_TEST(SplitPathNameLength) {
+  // the longest name leaves room for a terminator
+  HOST_EXPECT(Split("/abcdefghijklm") == 1);
+  HOST_EXPECT(strcmp(paths[0], "abcdefghijklm") == 0);
+  HOST_EXPECT(Split("/abcdefghijklmn") == -1);
+  HOST_EXPECT(Split("/abcdefghijklmn/x") == -1);
+}
@@ -0,0 +1,56 @@
+#include <stdarg.h>
+
+#include "host/test.h"
+#include "lib/printk.h"
+#include "lib/string.h"
+
+static char buf[128];
+
+// formats into buf, true if the output and the returned length are as expected
+static bool Formats(const char* expected, const char* fmt, ...) {
+  va_list va;
+  va_start(va, fmt);
+  char* out = buf;
+  int len = simple_vsprintf(&out, fmt, va, nullptr);
+  va_end(va);
+  return strcmp(buf, expected) == 0 && len == static_cast<int>(strlen(expected));
+}
+
+HOST_TEST(VsprintfWidth) {
+  HOST_EXPECT(Formats("   42", "%5d", 42));
+  HOST_EXPECT(Formats("42   |", "%-5d|", 42));
+  HOST_EXPECT(Formats("00042", "%05d", 42));
+  HOST_EXPECT(Formats("  abc", "%5s", "abc"));
+  HOST_EXPECT(Formats("   ff", "%*x", 5, 0xff));
+}
+
+HOST_TEST(VsprintfNegative) {
+  HOST_EXPECT(Formats("-1", "%d", -1));
+  HOST_EXPECT(Formats("-2147483648", "%d", INT32_MIN));
+  HOST_EXPECT(Formats("-0042", "%05d", -42));
+  HOST_EXPECT(Formats("  -42", "%5d", -42));
+  HOST_EXPECT(Formats("-9223372036854775807", "%ld", -INT64_MAX));
+}
+
+HOST_TEST(VsprintfUnsignedLong) {
+  HOST_EXPECT(Formats("0", "%lu", 0uL));
+  HOST_EXPECT(Formats("18446744073709551615", "%lu", UINT64_MAX));
+  HOST_EXPECT(Formats("4294967296", "%lu", 1uL << 32));
+  HOST_EXPECT(Formats("ffffffffffffffff", "%lx", UINT64_MAX));
+  HOST_EXPECT(Formats("4294967295", "%u", UINT32_MAX));
+}
+
+// a width narrower than the value never cuts it short
+HOST_TEST(VsprintfNoTruncation) {
+  HOST_EXPECT(Formats("123456", "%3d", 123456));
+  HOST_EXPECT(Formats("abcdef", "%2s", "abcdef"));
+  HOST_EXPECT(Formats("-123", "%2d", -123));
+}
+
+HOST_TEST(VsprintfMisc) {
+  HOST_EXPECT(Formats("100%", "100%%"));
+  HOST_EXPECT(Formats("(null)", "%s", static_cast<char*>(nullptr)));
+  HOST_EXPECT(Formats("0x1f", "%#x", 0x1f));
+  HOST_EXPECT(Formats("c", "%c", 'c'));
+  HOST_EXPECT(Formats("", ""));
+}
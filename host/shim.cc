@@ -0,0 +1,50 @@
+#include <stdlib.h>
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/sys_def/descriptor_def.h"
+#include "lib/syscall.h"
+
+// The few syscalls the lib code under test makes, served by the host.
+
+extern "C" long write(int fd, const void* buf, unsigned long count);
+
+namespace syscall {
+
+namespace {
+
+// what sbrk hands out, the lib allocator expects a heap that only grows
+constexpr size_t HEAP_SIZE = 256 * 1024 * 1024;
+alignas(memory_layout::PGSIZE) char heap[HEAP_SIZE];
+size_t heap_top = 0;
+
+}  // namespace
+
+int write(int fd, const void* src, int size) {
+  return ::write(fd == descriptor_def::io::console ? 1 : fd, src, size);
+}
+
+// like the kernel every grow starts on a page boundary
+char* sbrk(uint32_t bytes) {
+  heap_top = (heap_top + memory_layout::PGSIZE - 1) & ~(memory_layout::PGSIZE - 1);
+  if (bytes > HEAP_SIZE - heap_top) {
+    return nullptr;
+  }
+  char* p = heap + heap_top;
+  heap_top += bytes;
+  return p;
+}
+
+int exit(int code) {
+  ::exit(code);
+}
+
+// the host runs a single thread, the heap lock is never contended
+int futex_wait(uint32_t*, uint32_t) {
+  return 0;
+}
+
+int futex_wake(uint32_t*, int) {
+  return 0;
+}
+
+}  // namespace syscall
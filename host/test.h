@@ -0,0 +1,29 @@
+#pragma once
+
+#include "lib/types.h"
+
+// A small unit test harness for code that does not depend on the hardware,
+// built and run on the host next to the benchmarks. A test is a function
+// registered with HOST_TEST, HOST_EXPECT records a failure and lets the
+// test go on so that one run reports every broken expectation.
+namespace host {
+
+using TestFunc = void (*)();
+
+bool RegisterTest(const char* name, TestFunc fn);
+
+void ExpectFailed(const char* file, int line, const char* cond);
+
+}  // namespace host
+
+#define HOST_TEST(fn)                                                       \
+  static void fn();                                                         \
+  static const bool fn##_registered = ::host::RegisterTest(#fn, fn);        \
+  static void fn()
+
+#define HOST_EXPECT(cond)                               \
+  do {                                                  \
+    if (!(cond)) {                                      \
+      ::host::ExpectFailed(__FILE__, __LINE__, #cond);  \
+    }                                                   \
+  } while (0)
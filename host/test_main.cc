@@ -0,0 +1,50 @@
+#include "host/test.h"
+#include "lib/lib.h"
+
+namespace host {
+
+namespace {
+
+struct Test {
+  const char* name;
+  TestFunc fn;
+};
+
+constexpr int MAX_TESTS = 128;
+Test tests[MAX_TESTS];
+int test_num = 0;
+// failed expectations of the running test
+int failures = 0;
+
+}  // namespace
+
+bool RegisterTest(const char* name, TestFunc fn) {
+  if (test_num == MAX_TESTS) {
+    printf(PrintLevel::error, "host_tests: too many tests, raise MAX_TESTS\n");
+    return false;
+  }
+  tests[test_num++] = {name, fn};
+  return true;
+}
+
+void ExpectFailed(const char* file, int line, const char* cond) {
+  printf(PrintLevel::error, "%s:%d: expected: %s\n", file, line, cond);
+  failures += 1;
+}
+
+}  // namespace host
+
+// runs every test, exits with 1 if any of them failed
+int main() {
+  int failed_tests = 0;
+  for (int i = 0; i < host::test_num; ++i) {
+    host::failures = 0;
+    host::tests[i].fn();
+    printf("%-40s %s\n", host::tests[i].name, host::failures ? "FAILED" : "ok");
+    if (host::failures) {
+      failed_tests += 1;
+    }
+  }
+  printf("%d tests, %d failed\n", host::test_num, failed_tests);
+  return failed_tests ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#include "host/bench.h"
+#include "kernel/virtual_memory.h"
+
+// The free page lists of VirtualMemory, run over heap memory instead of
+// physical pages.
+
+static constexpr int CHUNK_NUM = 512;
+static kernel::MemoryChunk chunks[CHUNK_NUM];
+
+static void MemoryListPushPop(host::State& state) {
+  kernel::MemoryList list;
+  while (state.KeepRunning()) {
+    for (auto& chunk : chunks) {
+      list.Push(&chunk);
+    }
+    for (int i = 0; i < CHUNK_NUM; ++i) {
+      host::DoNotOptimize(list.Pop());
+    }
+  }
+  HOST_CHECK(list.Size() == 0 && list.Pop() == nullptr);
+}
+HOST_BENCHMARK(MemoryListPushPop);
+
+// taking a page out of the middle, like allocating a given physical page
+static void MemoryListErase(host::State& state) {
+  kernel::MemoryList list;
+  while (state.KeepRunning()) {
+    for (auto& chunk : chunks) {
+      list.Push(&chunk);
+    }
+    for (int i = 0; i < CHUNK_NUM; i += 2) {
+      HOST_CHECK(list.Erase(&chunks[i]));
+    }
+    for (int i = 1; i < CHUNK_NUM; i += 2) {
+      HOST_CHECK(list.Erase(&chunks[i]));
+    }
+  }
+  HOST_CHECK(list.Size() == 0 && !list.Erase(&chunks[0]));
+}
+HOST_BENCHMARK(MemoryListErase);
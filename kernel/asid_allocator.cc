@@ -0,0 +1,103 @@
+#include "kernel/asid_allocator.h"
+
+#include "arch/riscv_isa.h"
+#include "arch/riscv_reg.h"
+#include "kernel/cpu.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/printf.h"
+#include "kernel/memory_space.h"
+#include "kernel/scheduler.h"
+#include "lib/common.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+void AsidAllocator::Init() {
+  // probe implemented asid bits, satp has no effect on machine mode accesses
+  uint64_t origin = riscv::regs::satp.read();
+  riscv::regs::satp.write(lib::common::literal(riscv::virtual_addresing::Sv39) | (riscv::SATP_ASID_MASK << riscv::SATP_ASID_OFFSET));
+  uint64_t asid_mask = (riscv::regs::satp.read() >> riscv::SATP_ASID_OFFSET) & riscv::SATP_ASID_MASK;
+  riscv::regs::satp.write(origin);
+  asid_bits_ = 0;
+  while (asid_bits_ < MAX_ASID_BITS && (asid_mask & (1uL << asid_bits_))) {
+    asid_bits_ += 1;
+  }
+  // asid 0 is never handed out
+  bit_map_[0] |= 1u;
+  riscv::isa::sfence();
+  printf("[asid] supported asid bits: %d\n", asid_bits_);
+}
+
+bool AsidAllocator::IsValid(uint64_t asid) const {
+  return (asid >> MAX_ASID_BITS) == generation_;
+}
+
+uint16_t AsidAllocator::Alloc() {
+  uint32_t asid_num = 1u << asid_bits_;
+  for (uint32_t i = 0; i < asid_num; ++i) {
+    uint16_t asid = (next_hint_ + i) % asid_num;
+    if ((bit_map_[asid / 8] & (1u << (asid % 8))) == 0) {
+      bit_map_[asid / 8] |= 1u << (asid % 8);
+      next_hint_ = asid + 1;
+      return asid;
+    }
+  }
+  // run out of asid, start a new generation and drop all stale translations
+  generation_ += 1;
+  memset(bit_map_, 0, sizeof(bit_map_));
+  bit_map_[0] |= 1u | (1u << 1);
+  next_hint_ = 2;
+  Schedueler::Instance()->ThisCpu()->satp = 0;
+  riscv::isa::sfence();
+  return 1;
+}
+
+void AsidAllocator::Activate(MemorySpace* mm) {
+  CpuTask* cpu = Schedueler::Instance()->ThisCpu();
+  if (asid_bits_ == 0) {
+    uint64_t satp = riscv::regs::satp.make(riscv::virtual_addresing::Sv39, 0, mm->page_table);
+    if (cpu->satp != satp) {
+      riscv::regs::satp.write(satp);
+      riscv::isa::sfence();
+      cpu->satp = satp;
+    }
+    return;
+  }
+  {
+    CriticalGuard guard(&lk_);
+    if (!IsValid(mm->asid)) {
+      uint16_t asid = Alloc();
+      mm->asid = (generation_ << MAX_ASID_BITS) | asid;
+      // previous owner of this asid may still have translations cached
+      riscv::isa::sfence_asid(asid);
+    }
+  }
+  uint16_t asid = mm->asid & riscv::SATP_ASID_MASK;
+  uint64_t satp = riscv::regs::satp.make(riscv::virtual_addresing::Sv39, asid, mm->page_table);
+  if (cpu->satp != satp) {
+    riscv::regs::satp.write(satp);
+    cpu->satp = satp;
+  }
+}
+
+void AsidAllocator::Release(MemorySpace* mm) {
+  CriticalGuard guard(&lk_);
+  if (IsValid(mm->asid)) {
+    uint16_t asid = mm->asid & riscv::SATP_ASID_MASK;
+    bit_map_[asid / 8] &= ~(1u << (asid % 8));
+  }
+  mm->asid = 0;
+}
+
+void AsidAllocator::Flush(MemorySpace* mm) {
+  if (asid_bits_ == 0) {
+    riscv::isa::sfence();
+    return;
+  }
+  CriticalGuard guard(&lk_);
+  if (IsValid(mm->asid)) {
+    riscv::isa::sfence_asid(mm->asid & riscv::SATP_ASID_MASK);
+  }
+}
+
+}  // namespace kernel
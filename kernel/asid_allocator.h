@@ -0,0 +1,45 @@
+#ifndef KERNEL_ASID_ALLOCATOR_H
+#define KERNEL_ASID_ALLOCATOR_H
+
+#include "kernel/lock/spin_lock.h"
+#include "lib/singleton.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+struct MemorySpace;
+
+// Hands out address space identifiers so that switching satp between
+// processes does not require a global tlb flush. An asid stored in a
+// process is tagged with the generation it was allocated in, once all
+// asids are used up the generation is bumped and every process picks
+// up a fresh one on its next return to user mode.
+class AsidAllocator : public lib::Singleton<AsidAllocator> {
+ public:
+  friend class lib::Singleton<AsidAllocator>;
+  static constexpr int MAX_ASID_BITS = 16;
+
+  void Init();
+  // program satp with the address space mm
+  void Activate(MemorySpace* mm);
+  // give back the asid, translations are flushed when it gets reused
+  void Release(MemorySpace* mm);
+  // drop every cached translation of mm, e.g. after its page table was replaced
+  void Flush(MemorySpace* mm);
+
+ private:
+  AsidAllocator() {}
+
+  uint16_t Alloc();
+  bool IsValid(uint64_t asid) const;
+
+  uint8_t asid_bits_ = 0;
+  uint64_t generation_ = 1;
+  uint16_t next_hint_ = 1;
+  uint8_t bit_map_[(1 << MAX_ASID_BITS) / 8] = {0};
+  SpinLock lk_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_ASID_ALLOCATOR_H
@@ -1,10 +1,15 @@
 #ifndef KERNEL_CONFIG_SYSTEM_PARAM_H
 #define KERNEL_CONFIG_SYSTEM_PARAM_H
 
+#include "lib/types.h"
+
 namespace system_param {
 
 constexpr int CPU_NUM = 1;
-constexpr int MAX_PROCESS_NUM = 64;
+constexpr int MAX_FD_NUM = 1024;
+// mtime runs at 10MHz on qemu virt
+constexpr uint64_t MTIME_FREQ = 10'000'000;
+// length of a scheduling slice and of one SystemTick, in mtime units
 constexpr int TIMER_INTERVAL = 1000000;
 
 }  // namespace system_param
@@ -23,10 +23,15 @@ Console::Console(driver::BasicDevice* device) : device_(device) {
 }
 
 size_t Console::read(char* p, size_t len) {
+  auto* process = Schedueler::Instance()->ThisProcess();
   CriticalGuard guard(&context.lock);
   size_t read_cnt = 0;
   while (read_cnt < len) {
     while (context.read_index == context.write_index) {
+      // a killed reader leaves with what it has, its group may be waiting to reap it
+      if (process->killed) {
+        return read_cnt;
+      }
       Schedueler::Instance()->Sleep(GlobalChannel::console_channel(), &context.lock);
     }
     char c = context.buf[(context.read_index % buf_len)];
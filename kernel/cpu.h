@@ -9,6 +9,10 @@ struct CpuTask {
   // current process run on this cpu
   ProcessTask* process_task = nullptr;
   SavedContext saved_context;
+  // satp value currently programmed on this cpu
+  uint64_t satp = 0;
+  // the running task should give up the cpu on the way out of the current trap
+  bool need_resched = false;
 };
 
 }  // namespace kernel
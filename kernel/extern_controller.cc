@@ -7,10 +7,10 @@
 
 namespace kernel {
 
-driver::BasicDevice* ExternController::GetDeviceByIRQ(uint32_t irq) {
+ExternController::IrqInfo* ExternController::GetIrqInfoByIRQ(uint32_t irq) {
   for (uint32_t i = 0; i < device_list_size_; ++i) {
-    if (lib::common::literal(device_list_[i].first) == irq) {
-      return device_list_[i].second;
+    if (lib::common::literal(device_list_[i].irq) == irq) {
+      return &device_list_[i];
     }
   }
   return nullptr;
@@ -18,17 +18,19 @@ driver::BasicDevice* ExternController::GetDeviceByIRQ(uint32_t irq) {
 
 void ExternController::DoWork() {
   uint32_t irq = MEMORY_MAPPED_IO_R_WORD(memory_layout::PLIC_CLAIM(cpu_id()));
-  driver::BasicDevice* device = GetDeviceByIRQ(irq);
-  if (!device) {
+  IrqInfo* info = GetIrqInfoByIRQ(irq);
+  if (!info) {
     panic("No device satisfied irq: %d", irq);
   }
-  device->ProcessInterrupt();
+  info->count[cpu_id()] += 1;
+  info->device->ProcessInterrupt();
   MEMORY_MAPPED_IO_W_WORD(memory_layout::PLIC_CLAIM(cpu_id()), irq);
 }
 
-void ExternController::Register(riscv::plic::irq e, driver::BasicDevice* device) {
-  device_list_[device_list_size_].first = e;
-  device_list_[device_list_size_].second = device;
+void ExternController::Register(riscv::plic::irq e, driver::BasicDevice* device, const char* name) {
+  device_list_[device_list_size_].irq = e;
+  device_list_[device_list_size_].device = device;
+  device_list_[device_list_size_].name = name;
   device_list_size_ += 1;
 }
 
@@ -5,6 +5,7 @@
 #include <utility>
 
 #include "arch/riscv_plic.h"
+#include "kernel/config/system_param.h"
 #include "lib/singleton.h"
 #include "lib/types.h"
 
@@ -17,14 +18,27 @@ namespace kernel {
 class ExternController : public lib::Singleton<ExternController> {
  public:
   friend class lib::Singleton<ExternController>;
-  void Register(riscv::plic::irq e, driver::BasicDevice* device);
+  struct IrqInfo {
+    riscv::plic::irq irq;
+    driver::BasicDevice* device;
+    const char* name;
+    // interrupts taken on each hart
+    uint64_t count[system_param::CPU_NUM];
+  };
+
+  void Register(riscv::plic::irq e, driver::BasicDevice* device, const char* name);
   void DoWork();
+  uint32_t IrqNum() const {
+    return device_list_size_;
+  }
+  const IrqInfo& GetIrqInfo(uint32_t index) const {
+    return device_list_[index];
+  }
 
  private:
-  driver::BasicDevice* GetDeviceByIRQ(uint32_t irq);
+  IrqInfo* GetIrqInfoByIRQ(uint32_t irq);
 
-  // irq <--> device
-  std::array<std::pair<riscv::plic::irq, driver::BasicDevice*>, 8> device_list_;
+  std::array<IrqInfo, 8> device_list_{};
   uint32_t device_list_size_ = 0;
 };
 
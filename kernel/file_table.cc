@@ -0,0 +1,227 @@
+#include "kernel/file_table.h"
+
+#include <new>
+
+#include "kernel/config/system_param.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/pipe.h"
+#include "kernel/shm.h"
+#include "kernel/slab.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+// FileTable is only constructed through Create, so its cache is used untyped
+static KmemCache table_cache("file_table", sizeof(FileTable));
+static ObjectCache<fs::FileDescriptor> fd_cache("file_descriptor");
+
+FileTable* FileTable::Create() {
+  void* mem = table_cache.Alloc();
+  if (!mem) {
+    return nullptr;
+  }
+  auto* table = new (mem) FileTable;
+  if (!table->Grow()) {
+    Put(table);
+    return nullptr;
+  }
+  return table;
+}
+
+void FileTable::Get() {
+  CriticalGuard guard(&lk_);
+  ref_count_ += 1;
+}
+
+void FileTable::Put(FileTable* table) {
+  {
+    CriticalGuard guard(&table->lk_);
+    table->ref_count_ -= 1;
+    if (table->ref_count_ > 0) {
+      return;
+    }
+  }
+  table->~FileTable();
+  table_cache.Free(table);
+}
+
+FileTable::~FileTable() {
+  for (int i = 0; i < capacity_; ++i) {
+    if (files_[i]) {
+      Release(files_[i]);
+    }
+  }
+  kfree(files_);
+  kfree(open_map_);
+}
+
+bool FileTable::Grow() {
+  int capacity = capacity_ ? capacity_ * 2 : INIT_FD_NUM;
+  if (capacity > system_param::MAX_FD_NUM) {
+    return false;
+  }
+  auto** files = reinterpret_cast<fs::FileDescriptor**>(kzalloc(capacity * sizeof(fs::FileDescriptor*)));
+  auto* open_map = reinterpret_cast<uint64_t*>(kzalloc((capacity + 63) / 64 * sizeof(uint64_t)));
+  if (!files || !open_map) {
+    kfree(files);
+    kfree(open_map);
+    return false;
+  }
+  if (capacity_) {
+    memcpy(files, files_, capacity_ * sizeof(fs::FileDescriptor*));
+    memcpy(open_map, open_map_, (capacity_ + 63) / 64 * sizeof(uint64_t));
+  }
+  kfree(files_);
+  kfree(open_map_);
+  files_ = files;
+  open_map_ = open_map;
+  capacity_ = capacity;
+  return true;
+}
+
+int FileTable::OpenNum() {
+  CriticalGuard guard(&lk_);
+  int num = 0;
+  for (int word = 0; word < (capacity_ + 63) / 64; ++word) {
+    num += __builtin_popcountl(open_map_[word]);
+  }
+  return num;
+}
+
+void FileTable::Release(fs::FileDescriptor* file) {
+  if (__atomic_sub_fetch(&file->ref_count, 1, __ATOMIC_ACQ_REL) > 0) {
+    return;
+  }
+  if (file->file_type == fs::FileType::pipe) {
+    file->pipe->Close(file->writable);
+  } else if (file->file_type == fs::FileType::shm) {
+    ShmSegment::Put(file->shm);
+  }
+  fd_cache.Free(file);
+}
+
+int FileTable::InstallLocked(fs::FileDescriptor* file) {
+  while (true) {
+    for (int word = 0; word < (capacity_ + 63) / 64; ++word) {
+      if (open_map_[word] == ~0uL) {
+        continue;
+      }
+      int index = word * 64 + __builtin_ctzl(~open_map_[word]);
+      if (index >= capacity_) {
+        break;
+      }
+      open_map_[word] |= 1uL << (index % 64);
+      files_[index] = file;
+      return index;
+    }
+    if (!Grow()) {
+      return -1;
+    }
+  }
+}
+
+int FileTable::Install(const fs::FileDescriptor& fd) {
+  fs::FileDescriptor* file = fd_cache.Alloc(fd);
+  if (!file) {
+    return -1;
+  }
+  file->ref_count = 1;
+  int index;
+  {
+    CriticalGuard guard(&lk_);
+    index = InstallLocked(file);
+  }
+  if (index < 0) {
+    fd_cache.Free(file);
+  }
+  return index;
+}
+
+int FileTable::Dup(int fd) {
+  CriticalGuard guard(&lk_);
+  if (fd < 0 || fd >= capacity_ || !files_[fd]) {
+    return -1;
+  }
+  fs::FileDescriptor* file = files_[fd];
+  int index = InstallLocked(file);
+  if (index >= 0) {
+    __atomic_add_fetch(&file->ref_count, 1, __ATOMIC_ACQ_REL);
+  }
+  return index;
+}
+
+int FileTable::Dup2(int fd, int new_fd) {
+  fs::FileDescriptor* old = nullptr;
+  {
+    CriticalGuard guard(&lk_);
+    if (fd < 0 || fd >= capacity_ || !files_[fd] || new_fd < 0 || new_fd >= system_param::MAX_FD_NUM) {
+      return -1;
+    }
+    if (fd == new_fd) {
+      return new_fd;
+    }
+    while (new_fd >= capacity_) {
+      if (!Grow()) {
+        return -1;
+      }
+    }
+    old = files_[new_fd];
+    files_[new_fd] = files_[fd];
+    open_map_[new_fd / 64] |= 1uL << (new_fd % 64);
+    __atomic_add_fetch(&files_[fd]->ref_count, 1, __ATOMIC_ACQ_REL);
+  }
+  if (old) {
+    Release(old);
+  }
+  return new_fd;
+}
+
+bool FileTable::CopyFrom(FileTable* src) {
+  for (int i = 0; i < capacity_; ++i) {
+    if (files_[i]) {
+      Close(i);
+    }
+  }
+  CriticalGuard guard(&src->lk_);
+  while (capacity_ < src->capacity_) {
+    if (!Grow()) {
+      return false;
+    }
+  }
+  for (int i = 0; i < src->capacity_; ++i) {
+    fs::FileDescriptor* file = src->files_[i];
+    if (!file) {
+      continue;
+    }
+    __atomic_add_fetch(&file->ref_count, 1, __ATOMIC_ACQ_REL);
+    files_[i] = file;
+    open_map_[i / 64] |= 1uL << (i % 64);
+  }
+  return true;
+}
+
+fs::FileDescriptor* FileTable::Lookup(int fd) {
+  CriticalGuard guard(&lk_);
+  if (fd < 0 || fd >= capacity_ || !files_[fd]) {
+    return nullptr;
+  }
+  __atomic_add_fetch(&files_[fd]->ref_count, 1, __ATOMIC_ACQ_REL);
+  return files_[fd];
+}
+
+bool FileTable::Close(int fd) {
+  fs::FileDescriptor* file = nullptr;
+  {
+    CriticalGuard guard(&lk_);
+    if (fd < 0 || fd >= capacity_ || !files_[fd]) {
+      return false;
+    }
+    file = files_[fd];
+    files_[fd] = nullptr;
+    open_map_[fd / 64] &= ~(1uL << (fd % 64));
+  }
+  Release(file);
+  return true;
+}
+
+}  // namespace kernel
@@ -0,0 +1,53 @@
+#ifndef KERNEL_FILE_TABLE_H
+#define KERNEL_FILE_TABLE_H
+
+#include "filesystem/file_descriptor.h"
+#include "kernel/lock/spin_lock.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Open files of a process. Slots grow on demand up to MAX_FD_NUM and the
+// lowest free descriptor is found through a bitmap, one bit per slot.
+class FileTable {
+ public:
+  static constexpr int INIT_FD_NUM = 16;
+
+  static FileTable* Create();
+  // drop one reference, the table and its files are freed with the last one
+  static void Put(FileTable* table);
+  void Get();
+
+  // install fd at the lowest free slot, -1 if the table is full
+  int Install(const fs::FileDescriptor& fd);
+  // nullptr if fd is not open, the caller holds a reference of the result
+  // until Release, so a concurrent close or dup2 cannot free it
+  fs::FileDescriptor* Lookup(int fd);
+  // drop one reference, the last one closes a pipe end or segment and frees file
+  static void Release(fs::FileDescriptor* file);
+  bool Close(int fd);
+  int OpenNum();
+  // the lowest free slot shares the descriptor of fd, -1 on failure
+  int Dup(int fd);
+  // new_fd shares the descriptor of fd, whatever it held before is closed
+  int Dup2(int fd, int new_fd);
+  // share every open descriptor of src, the ones held so far are closed
+  bool CopyFrom(FileTable* src);
+
+ private:
+  FileTable() {}
+  ~FileTable();
+  bool Grow();
+  // lk_ is held, -1 if the table cannot grow
+  int InstallLocked(fs::FileDescriptor* file);
+
+  int ref_count_ = 1;
+  int capacity_ = 0;
+  fs::FileDescriptor** files_ = nullptr;
+  uint64_t* open_map_ = nullptr;
+  SpinLock lk_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_FILE_TABLE_H
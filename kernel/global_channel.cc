@@ -2,7 +2,6 @@
 
 namespace kernel {
 
-Channel GlobalChannel::sleep_channel_("sleep_channel");
 Channel GlobalChannel::console_channel_("console_channel");
 
 }  // namespace kernel
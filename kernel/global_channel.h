@@ -7,16 +7,11 @@ namespace kernel {
 
 class GlobalChannel {
  public:
-  static Channel* sleep_channel() {
-    return &sleep_channel_;
-  }
-
   static Channel* console_channel() {
     return &console_channel_;
   }
 
  private:
-  static Channel sleep_channel_;
   static Channel console_channel_;
 };
 
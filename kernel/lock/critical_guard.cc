@@ -1,29 +1,25 @@
 #include "kernel/lock/critical_guard.h"
 
 #include "arch/riscv_reg.h"
-#include "kernel/config/system_param.h"
 #include "kernel/utils.h"
 
 namespace kernel {
 
-CriticalGuard::CriticalGuard(SpinLock* lk) {
-  is_intr_on_ = riscv::regs::mstatus.read_bit(riscv::StatusBit::mie);
+bool InterruptPushOff() {
+  bool is_intr_on = riscv::regs::mstatus.read_bit(riscv::StatusBit::mie);
   global_interrunpt_off();
-  if constexpr (system_param::CPU_NUM != 1) {
-    if (!lk) {
-      panic("inpout lock is empty");
-    }
-    lk->Lock();
-    lk_ = lk;
-  }
+  return is_intr_on;
 }
 
-CriticalGuard::~CriticalGuard() {
-  if (is_intr_on_) {
+void InterruptPop(bool is_intr_on) {
+  if (is_intr_on) {
     global_interrunpt_on();
   }
-  if constexpr (system_param::CPU_NUM != 1) {
-    lk_->UnLock();
+}
+
+void LockMissing() {
+  panic("inpout lock is empty");
+  while (true) {
   }
 }
 
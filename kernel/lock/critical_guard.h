@@ -1,20 +1,44 @@
 #ifndef CRITICAL_GUARD_H
 #define CRITICAL_GUARD_H
 
+#include "kernel/config/system_param.h"
 #include "kernel/lock/spin_lock.h"
 
 namespace kernel {
 
+// turn off interrupts of this hart, returns whether they were on
+bool InterruptPushOff();
+void InterruptPop(bool is_intr_on);
+__attribute__((noreturn)) void LockMissing();
+
+// Disables interrupts for its lifetime and holds lk on multi-core builds.
+// Works with any lock providing Lock/UnLock, e.g. TicketLock or McsLock.
+template <typename LockType = SpinLock>
 class CriticalGuard {
  public:
-  CriticalGuard(SpinLock* lk = nullptr);
-  ~CriticalGuard();
+  CriticalGuard(const CriticalGuard&) = delete;
+  CriticalGuard& operator= (const CriticalGuard&) = delete;
+  CriticalGuard(LockType* lk = nullptr) : is_intr_on_(InterruptPushOff()) {
+    if constexpr (system_param::CPU_NUM != 1) {
+      if (!lk) {
+        LockMissing();
+      }
+      lk->Lock();
+      lk_ = lk;
+    }
+  }
+  ~CriticalGuard() {
+    if constexpr (system_param::CPU_NUM != 1) {
+      lk_->UnLock();
+    }
+    InterruptPop(is_intr_on_);
+  }
 
  private:
   bool is_intr_on_ = false;
-  SpinLock* lk_ = nullptr;
+  LockType* lk_ = nullptr;
 };
 
 }  // namespace kernel
 
-#endif  // CRITICAL_GUARD_H
\ No newline at end of file
+#endif  // CRITICAL_GUARD_H
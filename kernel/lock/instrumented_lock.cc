@@ -0,0 +1,27 @@
+#include "kernel/lock/instrumented_lock.h"
+
+#include "kernel/printf.h"
+
+namespace kernel {
+
+// locks are constructed by RunInitArray on a single hart, no locking needed
+static LockStatsNode* stats_head = nullptr;
+
+LockStatsNode::LockStatsNode(const char* name) : name_(name) {
+  next_ = stats_head;
+  stats_head = this;
+}
+
+LockStatsNode* LockStatsNode::Head() {
+  return stats_head;
+}
+
+void LockStatsNode::Dump() {
+  printf("[lock] name acquisitions contended spin_cycles max_hold_cycles\n");
+  for (auto* node = stats_head; node; node = node->next_) {
+    const auto& s = node->stats_;
+    printf("[lock] %s %lu %lu %lu %lu\n", node->name_, s.acquisitions, s.contended, s.spin_cycles, s.max_hold_cycles);
+  }
+}
+
+}  // namespace kernel
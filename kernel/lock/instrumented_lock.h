@@ -0,0 +1,89 @@
+#ifndef KERNEL_LOCK_INSTRUMENTED_LOCK_H
+#define KERNEL_LOCK_INSTRUMENTED_LOCK_H
+
+#include "arch/riscv_reg.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+struct LockStats {
+  uint64_t acquisitions = 0;
+  // acquisitions which found the lock taken
+  uint64_t contended = 0;
+  // cycles spent waiting in contended acquisitions
+  uint64_t spin_cycles = 0;
+  uint64_t max_hold_cycles = 0;
+};
+
+// Every instrumented lock links itself into a global list so that the
+// statistics of all of them can be dumped in one go.
+class LockStatsNode {
+ public:
+  explicit LockStatsNode(const char* name);
+  LockStatsNode(const LockStatsNode&) = delete;
+  LockStatsNode& operator= (const LockStatsNode&) = delete;
+
+  static LockStatsNode* Head();
+  static void Dump();
+
+  const char* name() const {
+    return name_;
+  }
+  const LockStats& stats() const {
+    return stats_;
+  }
+  LockStatsNode* next() const {
+    return next_;
+  }
+
+ protected:
+  LockStats stats_;
+
+ private:
+  const char* name_;
+  LockStatsNode* next_ = nullptr;
+};
+
+// Wraps one of SpinLock, TicketLock or McsLock and counts how it is used.
+// Counters are only written by the lock holder, so they need no atomics.
+template <typename LockType>
+class Instrumented : public LockStatsNode {
+ public:
+  explicit Instrumented(const char* name) : LockStatsNode(name) {}
+
+  void Lock() {
+    if (!lock_.TryLock()) {
+      uint64_t beg = riscv::regs::mcycle.read();
+      lock_.Lock();
+      stats_.contended += 1;
+      stats_.spin_cycles += riscv::regs::mcycle.read() - beg;
+    }
+    stats_.acquisitions += 1;
+    acquired_at_ = riscv::regs::mcycle.read();
+  }
+
+  bool TryLock() {
+    if (!lock_.TryLock()) {
+      return false;
+    }
+    stats_.acquisitions += 1;
+    acquired_at_ = riscv::regs::mcycle.read();
+    return true;
+  }
+
+  void UnLock() {
+    uint64_t hold = riscv::regs::mcycle.read() - acquired_at_;
+    if (hold > stats_.max_hold_cycles) {
+      stats_.max_hold_cycles = hold;
+    }
+    lock_.UnLock();
+  }
+
+ private:
+  LockType lock_;
+  uint64_t acquired_at_ = 0;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_LOCK_INSTRUMENTED_LOCK_H
@@ -0,0 +1,40 @@
+#include "kernel/lock/mcs_lock.h"
+
+#include "arch/riscv_reg.h"
+
+namespace kernel {
+
+void McsLock::Lock() {
+  Node* node = &nodes_[riscv::regs::tp.read()];
+  node->next.store(nullptr, std::memory_order_relaxed);
+  node->locked.store(true, std::memory_order_relaxed);
+  Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+  if (!prev) {
+    return;
+  }
+  prev->next.store(node, std::memory_order_release);
+  while (node->locked.load(std::memory_order_acquire));
+}
+
+bool McsLock::TryLock() {
+  Node* node = &nodes_[riscv::regs::tp.read()];
+  node->next.store(nullptr, std::memory_order_relaxed);
+  Node* expected = nullptr;
+  return tail_.compare_exchange_strong(expected, node, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void McsLock::UnLock() {
+  Node* node = &nodes_[riscv::regs::tp.read()];
+  Node* next = node->next.load(std::memory_order_acquire);
+  if (!next) {
+    Node* expected = node;
+    if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+      return;
+    }
+    // a successor swapped itself in but has not linked yet
+    while (!(next = node->next.load(std::memory_order_acquire)));
+  }
+  next->locked.store(false, std::memory_order_release);
+}
+
+}  // namespace kernel
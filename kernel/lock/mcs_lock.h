@@ -0,0 +1,36 @@
+#ifndef KERNEL_LOCK_MCS_LOCK_H
+#define KERNEL_LOCK_MCS_LOCK_H
+
+#include <atomic>
+
+#include "kernel/config/system_param.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Queued spin lock, every waiter spins on its own node instead of the
+// shared lock word. Nodes are per hart, so the lock must be taken with
+// interrupts off and never recursively, which CriticalGuard ensures.
+class McsLock {
+ public:
+  McsLock() = default;
+  McsLock(const McsLock&) = delete;
+  McsLock& operator= (const McsLock&) = delete;
+
+  void Lock();
+  bool TryLock();
+  void UnLock();
+
+ private:
+  struct alignas(64) Node {
+    std::atomic<Node*> next{nullptr};
+    std::atomic<bool> locked{false};
+  };
+
+  std::atomic<Node*> tail_{nullptr};
+  Node nodes_[system_param::CPU_NUM];
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_LOCK_MCS_LOCK_H
@@ -0,0 +1,41 @@
+#include "kernel/lock/mutex.h"
+
+#include "kernel/lock/critical_guard.h"
+#include "kernel/scheduler.h"
+
+namespace kernel {
+
+void Mutex::Lock() {
+  auto* scheduler = Schedueler::Instance();
+  CriticalGuard guard(&lk_);
+  Channel channel(this);
+  while (locked_) {
+    scheduler->Sleep(&channel, &lk_);
+  }
+  locked_ = true;
+  owner_ = scheduler->ThisProcess();
+}
+
+bool Mutex::TryLock() {
+  CriticalGuard guard(&lk_);
+  if (locked_) {
+    return false;
+  }
+  locked_ = true;
+  owner_ = Schedueler::Instance()->ThisProcess();
+  return true;
+}
+
+void Mutex::UnLock() {
+  CriticalGuard guard(&lk_);
+  locked_ = false;
+  owner_ = nullptr;
+  Channel channel(this);
+  Schedueler::Instance()->Wakeup(&channel, 1);
+}
+
+bool Mutex::IsHeld() const {
+  return locked_ && owner_ == Schedueler::Instance()->ThisProcess();
+}
+
+}  // namespace kernel
@@ -0,0 +1,32 @@
+#ifndef KERNEL_LOCK_MUTEX_H
+#define KERNEL_LOCK_MUTEX_H
+
+#include "kernel/lock/spin_lock.h"
+
+namespace kernel {
+
+struct ProcessTask;
+
+// Sleeping lock for long critical sections such as disk io. Waiters give
+// up the cpu through Schedueler::Sleep and interrupts stay enabled while
+// the mutex is held, so it must only be taken from task context.
+class Mutex {
+ public:
+  Mutex() = default;
+  Mutex(const Mutex&) = delete;
+  Mutex& operator= (const Mutex&) = delete;
+
+  void Lock();
+  bool TryLock();
+  void UnLock();
+  bool IsHeld() const;
+
+ private:
+  SpinLock lk_;
+  bool locked_ = false;
+  ProcessTask* owner_ = nullptr;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_LOCK_MUTEX_H
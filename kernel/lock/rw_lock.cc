@@ -0,0 +1,45 @@
+#include "kernel/lock/rw_lock.h"
+
+#include "kernel/lock/critical_guard.h"
+#include "kernel/scheduler.h"
+
+namespace kernel {
+
+void RwLock::ReadLock() {
+  CriticalGuard guard(&lk_);
+  Channel channel(this);
+  while (writer_ || waiting_writers_ > 0) {
+    Schedueler::Instance()->Sleep(&channel, &lk_);
+  }
+  readers_ += 1;
+}
+
+void RwLock::ReadUnLock() {
+  CriticalGuard guard(&lk_);
+  readers_ -= 1;
+  if (readers_ == 0 && waiting_writers_ > 0) {
+    Channel channel(this);
+    Schedueler::Instance()->Wakeup(&channel);
+  }
+}
+
+void RwLock::WriteLock() {
+  CriticalGuard guard(&lk_);
+  Channel channel(this);
+  waiting_writers_ += 1;
+  while (writer_ || readers_ > 0) {
+    Schedueler::Instance()->Sleep(&channel, &lk_);
+  }
+  waiting_writers_ -= 1;
+  writer_ = true;
+}
+
+void RwLock::WriteUnLock() {
+  CriticalGuard guard(&lk_);
+  writer_ = false;
+  // readers and writers share the channel, whoever loses the race sleeps again
+  Channel channel(this);
+  Schedueler::Instance()->Wakeup(&channel);
+}
+
+}  // namespace kernel
@@ -0,0 +1,60 @@
+#ifndef KERNEL_LOCK_RW_LOCK_H
+#define KERNEL_LOCK_RW_LOCK_H
+
+#include "kernel/lock/spin_lock.h"
+
+namespace kernel {
+
+// Sleeping reader-writer lock for read-mostly data. A waiting writer
+// blocks new readers, so a steady stream of readers cannot starve it.
+class RwLock {
+ public:
+  RwLock() = default;
+  RwLock(const RwLock&) = delete;
+  RwLock& operator= (const RwLock&) = delete;
+
+  void ReadLock();
+  void ReadUnLock();
+  void WriteLock();
+  void WriteUnLock();
+
+ private:
+  SpinLock lk_;
+  int readers_ = 0;
+  int waiting_writers_ = 0;
+  bool writer_ = false;
+};
+
+class ReadGuard {
+ public:
+  ReadGuard(const ReadGuard&) = delete;
+  ReadGuard& operator= (const ReadGuard&) = delete;
+  explicit ReadGuard(RwLock* lock) : lock_(lock) {
+    lock_->ReadLock();
+  }
+  ~ReadGuard() {
+    lock_->ReadUnLock();
+  }
+
+ private:
+  RwLock* lock_;
+};
+
+class WriteGuard {
+ public:
+  WriteGuard(const WriteGuard&) = delete;
+  WriteGuard& operator= (const WriteGuard&) = delete;
+  explicit WriteGuard(RwLock* lock) : lock_(lock) {
+    lock_->WriteLock();
+  }
+  ~WriteGuard() {
+    lock_->WriteUnLock();
+  }
+
+ private:
+  RwLock* lock_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_LOCK_RW_LOCK_H
@@ -6,6 +6,10 @@ void SpinLock::Lock() {
   while(flag_.test_and_set());
 }
 
+bool SpinLock::TryLock() {
+  return !flag_.test_and_set();
+}
+
 void SpinLock::UnLock() {
   flag_.clear();
 }
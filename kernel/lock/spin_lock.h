@@ -12,6 +12,7 @@ class SpinLock {
   SpinLock& operator= (const SpinLock&) = delete;
 
   void Lock();
+  bool TryLock();
   void UnLock();
 
  private:
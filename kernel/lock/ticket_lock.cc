@@ -0,0 +1,20 @@
+#include "kernel/lock/ticket_lock.h"
+
+namespace kernel {
+
+void TicketLock::Lock() {
+  uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+  while (owner_.load(std::memory_order_acquire) != ticket);
+}
+
+bool TicketLock::TryLock() {
+  uint32_t owner = owner_.load(std::memory_order_relaxed);
+  uint32_t expected = owner;
+  return next_.compare_exchange_strong(expected, owner + 1, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+void TicketLock::UnLock() {
+  owner_.store(owner_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+}  // namespace kernel
@@ -0,0 +1,28 @@
+#ifndef KERNEL_LOCK_TICKET_LOCK_H
+#define KERNEL_LOCK_TICKET_LOCK_H
+
+#include <atomic>
+
+#include "lib/types.h"
+
+namespace kernel {
+
+// FIFO spin lock, waiters are served in the order they took a ticket.
+class TicketLock {
+ public:
+  TicketLock() = default;
+  TicketLock(const TicketLock&) = delete;
+  TicketLock& operator= (const TicketLock&) = delete;
+
+  void Lock();
+  bool TryLock();
+  void UnLock();
+
+ private:
+  std::atomic<uint32_t> next_{0};
+  std::atomic<uint32_t> owner_{0};
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_LOCK_TICKET_LOCK_H
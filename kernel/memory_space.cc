@@ -0,0 +1,296 @@
+#include "kernel/memory_space.h"
+
+#include <new>
+
+#include "kernel/asid_allocator.h"
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/shm.h"
+#include "kernel/slab.h"
+#include "kernel/sys_def/time_def.h"
+#include "kernel/timer.h"
+#include "kernel/uaccess.h"
+#include "kernel/virtual_memory.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+static ObjectCache<MemorySpace> mm_cache("memory_space");
+
+static constexpr uint64_t STACK_SLOT_STRIDE = (MemorySpace::THREAD_STACK_PAGES + 1) * memory_layout::PGSIZE;
+
+// the window ends a guard page below the last stack slot
+static uint64_t ShmTop() {
+  return MemorySpace::StackSlotTop(MemorySpace::MAX_STACK_SLOT);
+}
+
+static riscv::PTE ShmPrivilege(bool writable) {
+  return writable ? riscv::PTE::R | riscv::PTE::W | riscv::PTE::U : riscv::PTE::R | riscv::PTE::U;
+}
+
+// the clock page sits right above the main stack and shares its page tables
+static_assert(time_def::CLOCK_PAGE_VA == (memory_layout::MAX_SUPPORT_VA & ~(memory_layout::PGSIZE - 1)));
+
+MemorySpace* MemorySpace::Create() {
+  MemorySpace* mm = mm_cache.Alloc();
+  if (!mm) {
+    return nullptr;
+  }
+  mm->page_table = VirtualMemory::Instance()->Alloc();
+  if (!mm->page_table) {
+    mm_cache.Free(mm);
+    return nullptr;
+  }
+  if (!VirtualMemory::Instance()->MapPage(mm->page_table, time_def::CLOCK_PAGE_VA, TimerManager::ClockPage(), riscv::PTE::R | riscv::PTE::U)) {
+    Put(mm);
+    return nullptr;
+  }
+  return mm;
+}
+
+void MemorySpace::Get() {
+  CriticalGuard guard(&lock);
+  ref_count += 1;
+}
+
+void MemorySpace::Put(MemorySpace* mm) {
+  {
+    CriticalGuard guard(&mm->lock);
+    mm->ref_count -= 1;
+    if (mm->ref_count > 0) {
+      return;
+    }
+  }
+  auto* vm = VirtualMemory::Instance();
+  // the clock page belongs to the kernel, its page tables go with the main stack
+  vm->UnMapPage(mm->page_table, time_def::CLOCK_PAGE_VA);
+  // leaf pages first, then the page tables which referenced them
+  for (int level = 3; level > 0; level--) {
+    for (size_t i = 0; i < mm->used_address_size; i++) {
+      vm->FreeMemory(mm->page_table, mm->used_address[i].first, mm->used_address[i].second, level);
+    }
+    vm->FreeMemory(mm->page_table, VirtualMemory::GetUserSpVa() - memory_layout::PGSIZE, VirtualMemory::GetUserSpVa(), level);
+    // released slots may still own page tables, unmapped entries are skipped
+    for (int slot = 0; slot < MAX_STACK_SLOT; ++slot) {
+      uint64_t top = StackSlotTop(slot);
+      vm->FreeMemory(mm->page_table, top - THREAD_STACK_PAGES * memory_layout::PGSIZE, top, level);
+    }
+    // shared pages only lose this reference, the page tables of the window
+    // are swept as a whole since unmapped segments may have left some behind
+    if (level == 3) {
+      for (const ShmMapping& mapping : mm->shm_mappings) {
+        if (mapping.segment) {
+          vm->FreeMemory(mm->page_table, mapping.va, mapping.va + mapping.pages * memory_layout::PGSIZE, level);
+        }
+      }
+    } else {
+      uint64_t stride = memory_layout::PGSIZE << ((3 - level) * 9);
+      for (uint64_t va = (ShmTop() - SHM_WINDOW) & ~(stride - 1); va < ShmTop(); va += stride) {
+        vm->FreePage(mm->page_table, va, level);
+      }
+    }
+  }
+  for (const ShmMapping& mapping : mm->shm_mappings) {
+    if (mapping.segment) {
+      ShmSegment::Put(mapping.segment);
+    }
+  }
+  vm->FreePage(mm->page_table);
+  AsidAllocator::Instance()->Release(mm);
+  mm_cache.Free(mm);
+}
+
+static bool CopyMemory(uint64_t* src_root_page, uint64_t* dst_root_page, uint64_t va_beg, uint64_t va_end) {
+  UserTranslator dst_translator(dst_root_page);
+  riscv::PTE pte = riscv::PTE::None;
+  auto size = va_end - va_beg;
+  while (size > 0) {
+    uint64_t src_pa = VirtualMemory::Instance()->VAToPA(src_root_page, va_beg, &pte);
+    uint64_t remain_size = memory_layout::PGSIZE - src_pa % memory_layout::PGSIZE;
+    size_t len = size > remain_size ? remain_size : size;
+    if (!VirtualMemory::Instance()->MapMemory(dst_root_page, va_beg, va_beg + len, pte)) {
+      return false;
+    }
+    uint64_t dst_pa = dst_translator.Translate(va_beg);
+    memcpy(reinterpret_cast<uint8_t*>(dst_pa), reinterpret_cast<uint8_t*>(src_pa), len);
+    size -= len;
+    va_beg = VirtualMemory::AddrCastDown(va_beg) + memory_layout::PGSIZE;
+  }
+  return true;
+}
+
+bool MemorySpace::CopyFrom(const MemorySpace* src) {
+  for (size_t i = 0; i < src->used_address_size; ++i) {
+    if (!CopyMemory(src->page_table, page_table, src->used_address[i].first, src->used_address[i].second)) {
+      return false;
+    }
+  }
+  std::copy(src->used_address.begin(), src->used_address.begin() + src->used_address_size, used_address.begin());
+  used_address_size = src->used_address_size;
+  dynamic_info = src->dynamic_info;
+  // the ring page was copied along with the heap
+  io_ring = src->io_ring;
+  // shared segments stay shared with the child
+  for (int i = 0; i < MAX_SHM_MAPPING; ++i) {
+    const ShmMapping& mapping = src->shm_mappings[i];
+    if (!mapping.segment) {
+      continue;
+    }
+    if (!mapping.segment->Map(page_table, mapping.va, mapping.pages, ShmPrivilege(mapping.writable))) {
+      return false;
+    }
+    mapping.segment->Get();
+    shm_mappings[i] = mapping;
+  }
+  return true;
+}
+
+uint64_t MemorySpace::MaxAddress() const {
+  uint64_t max_mem_addr = 0;
+  for (size_t i = 0; i < used_address_size; i++) {
+    if (used_address[i].second > max_mem_addr) {
+      max_mem_addr = used_address[i].second;
+    }
+  }
+  return max_mem_addr;
+}
+
+uint64_t MemorySpace::ExpandMemory(size_t bytes) {
+  if (bytes == 0) {
+    return 0;
+  }
+  LockGuard<Mutex> guard(&map_lock);
+  uint64_t max_mem_addr = 0;
+  size_t last_region = used_address_size;
+  for (size_t i = 0; i < used_address_size; i++) {
+    if (used_address[i].second > max_mem_addr) {
+      max_mem_addr = used_address[i].second;
+      last_region = i;
+    }
+  }
+  max_mem_addr = VirtualMemory::AddrCastUp(max_mem_addr);
+  // growing heap extends the topmost region instead of using up a new slot
+  bool can_merge = last_region < used_address_size;
+  if (!can_merge && used_address_size >= used_address.size()) {
+    return 0;
+  }
+  if (!VirtualMemory::Instance()->MapMemory(page_table, max_mem_addr, max_mem_addr + bytes, riscv::PTE::R | riscv::PTE::W | riscv::PTE::U)) {
+    return 0;
+  }
+  if (can_merge) {
+    used_address[last_region].second = max_mem_addr + bytes;
+  } else {
+    used_address[used_address_size] = {max_mem_addr, max_mem_addr + bytes};
+    used_address_size += 1;
+  }
+  // translations of the new range may have been cached as invalid
+  AsidAllocator::Instance()->Flush(this);
+  return max_mem_addr;
+}
+
+uint64_t MemorySpace::StackSlotTop(int slot) {
+  return VirtualMemory::GetUserSpVa() - memory_layout::PGSIZE - memory_layout::PGSIZE - slot * STACK_SLOT_STRIDE;
+}
+
+int MemorySpace::AllocStackSlot() {
+  LockGuard<Mutex> map_guard(&map_lock);
+  int slot = 0;
+  {
+    CriticalGuard guard(&lock);
+    while (slot < MAX_STACK_SLOT && (stack_slots & (1uL << slot))) {
+      slot += 1;
+    }
+    if (slot == MAX_STACK_SLOT) {
+      return -1;
+    }
+    stack_slots |= 1uL << slot;
+  }
+  uint64_t top = StackSlotTop(slot);
+  if (!VirtualMemory::Instance()->MapMemory(page_table, top - THREAD_STACK_PAGES * memory_layout::PGSIZE, top, riscv::PTE::R | riscv::PTE::W | riscv::PTE::U)) {
+    CriticalGuard guard(&lock);
+    stack_slots &= ~(1uL << slot);
+    return -1;
+  }
+  return slot;
+}
+
+void MemorySpace::FreeStackSlot(int slot) {
+  CriticalGuard guard(&lock);
+  if (slot < 0 || !(stack_slots & (1uL << slot))) {
+    return;
+  }
+  uint64_t top = StackSlotTop(slot);
+  VirtualMemory::Instance()->FreeMemory(page_table, top - THREAD_STACK_PAGES * memory_layout::PGSIZE, top);
+  stack_slots &= ~(1uL << slot);
+}
+
+bool MemorySpace::CopyStackSlot(const MemorySpace* src, int slot) {
+  uint64_t top = StackSlotTop(slot);
+  if (!CopyMemory(src->page_table, page_table, top - THREAD_STACK_PAGES * memory_layout::PGSIZE, top)) {
+    return false;
+  }
+  stack_slots |= 1uL << slot;
+  return true;
+}
+
+uint64_t MemorySpace::MapShared(ShmSegment* segment, size_t pages, bool writable) {
+  LockGuard<Mutex> guard(&map_lock);
+  ShmMapping* free_mapping = nullptr;
+  for (ShmMapping& mapping : shm_mappings) {
+    if (!mapping.segment) {
+      free_mapping = &mapping;
+      break;
+    }
+  }
+  if (!free_mapping || pages == 0) {
+    return 0;
+  }
+  // first fit, every mapping is followed by an unmapped guard page
+  uint64_t size = pages * memory_layout::PGSIZE;
+  uint64_t va = ShmTop() - SHM_WINDOW;
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (const ShmMapping& mapping : shm_mappings) {
+      uint64_t end = mapping.va + (mapping.pages + 1) * memory_layout::PGSIZE;
+      if (mapping.segment && va < end && mapping.va < va + size + memory_layout::PGSIZE) {
+        va = end;
+        moved = true;
+      }
+    }
+  }
+  if (va + size > ShmTop()) {
+    return 0;
+  }
+  if (!segment->Map(page_table, va, pages, ShmPrivilege(writable))) {
+    return 0;
+  }
+  segment->Get();
+  *free_mapping = {segment, va, pages, writable};
+  // translations of the new range may have been cached as invalid
+  AsidAllocator::Instance()->Flush(this);
+  return va;
+}
+
+bool MemorySpace::UnmapShared(uint64_t va) {
+  ShmSegment* segment = nullptr;
+  {
+    LockGuard<Mutex> guard(&map_lock);
+    for (ShmMapping& mapping : shm_mappings) {
+      if (mapping.segment && mapping.va == va) {
+        VirtualMemory::Instance()->FreeMemory(page_table, va, va + mapping.pages * memory_layout::PGSIZE);
+        segment = mapping.segment;
+        mapping = ShmMapping{};
+        break;
+      }
+    }
+  }
+  if (!segment) {
+    return false;
+  }
+  AsidAllocator::Instance()->Flush(this);
+  ShmSegment::Put(segment);
+  return true;
+}
+
+}  // namespace kernel
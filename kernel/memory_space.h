@@ -0,0 +1,85 @@
+#ifndef KERNEL_MEMORY_SPACE_H
+#define KERNEL_MEMORY_SPACE_H
+
+#include <array>
+#include <utility>
+
+#include "kernel/lock/mutex.h"
+#include "kernel/lock/spin_lock.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+class ShmSegment;
+
+// va_beg, va_end
+using MemoryRegion = std::pair<uint64_t, uint64_t>;
+
+// pages of a shared segment mapped from va on, unused while segment is null
+struct ShmMapping {
+  ShmSegment* segment = nullptr;
+  uint64_t va = 0;
+  size_t pages = 0;
+  bool writable = false;
+};
+
+struct DynamicInfo {
+  uint64_t dynamic_vaddr = 0;
+  uint64_t dynamic_size = 0;
+};
+
+// User address space, shared by all threads of a process. The main stack
+// occupies the page right below GetUserSpVa(), thread stacks are carved
+// from fixed slots below it, each slot separated by an unmapped guard page.
+// Shared memory segments go into a window below the last slot, apart from
+// the heap, which grows upwards from the image.
+struct MemorySpace {
+  static constexpr int MAX_STACK_SLOT = 64;
+  static constexpr uint64_t THREAD_STACK_PAGES = 4;
+  static constexpr int MAX_SHM_MAPPING = 16;
+  static constexpr uint64_t SHM_WINDOW = 1uL << 30;
+
+  static MemorySpace* Create();
+  void Get();
+  // drop one reference, all mappings and the page table go with the last one
+  static void Put(MemorySpace* mm);
+
+  bool CopyFrom(const MemorySpace* src);
+  uint64_t ExpandMemory(size_t bytes);
+  // callers hold map_lock
+  uint64_t MaxAddress() const;
+  // allocate and map a thread stack, returns the slot or -1
+  int AllocStackSlot();
+  void FreeStackSlot(int slot);
+  bool CopyStackSlot(const MemorySpace* src, int slot);
+  static uint64_t StackSlotTop(int slot);
+  // map the first pages of segment at the lowest free place of the window,
+  // the mapping holds a reference of it, returns the address or 0
+  uint64_t MapShared(ShmSegment* segment, size_t pages, bool writable);
+  // false if no mapping starts at va
+  bool UnmapShared(uint64_t va);
+
+  // guards ref_count and stack_slots
+  SpinLock lock;
+  // held while the layout is extended: ELF loads, heap growth, new thread stacks.
+  // It may sleep on disk io, so interrupts stay enabled meanwhile.
+  Mutex map_lock;
+  int ref_count = 1;
+  uint64_t* page_table = nullptr;
+  // asid tagged with the generation of AsidAllocator
+  uint64_t asid = 0;
+  size_t used_address_size = 0;
+  std::array<MemoryRegion, 16> used_address;
+  DynamicInfo dynamic_info;
+  uint64_t stack_slots = 0;
+  // page of the io_def::ring set up by io_setup, 0 without one
+  uint64_t io_ring = 0;
+  // io_enter of several threads take turns on the ring
+  Mutex io_lock;
+  // changed under map_lock
+  std::array<ShmMapping, MAX_SHM_MAPPING> shm_mappings;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_MEMORY_SPACE_H
@@ -0,0 +1,67 @@
+#ifndef KERNEL_PER_HART_RING_H
+#define KERNEL_PER_HART_RING_H
+
+#include <atomic>
+
+#include "kernel/lock/critical_guard.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Ring written only by the hart owning it and drained from any hart. The
+// writer turns interrupts off for the few stores of an entry, so nested
+// interrupts cannot race for a slot and no lock is needed. A full ring
+// drops new entries instead of overwriting ones not read yet.
+template <typename T, size_t N>
+class PerHartRing {
+ public:
+  // runs on the owning hart, fill writes the entry in place
+  template <typename Fill>
+  bool Push(Fill&& fill) {
+    bool is_intr_on = InterruptPushOff();
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    bool has_room = head - tail_.load(std::memory_order_acquire) < N;
+    if (has_room) {
+      fill(&entries_[head % N]);
+      // publish the entry only once it is complete
+      head_.store(head + 1, std::memory_order_release);
+    } else {
+      dropped_ += 1;
+    }
+    InterruptPop(is_intr_on);
+    return has_room;
+  }
+
+  // oldest first, concurrent readers must be serialized by the caller
+  size_t Pop(T* out, size_t max_num) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+    size_t num = 0;
+    while (tail != head && num < max_num) {
+      out[num++] = entries_[tail % N];
+      tail += 1;
+    }
+    // the slots may be reused from here on
+    tail_.store(tail, std::memory_order_release);
+    return num;
+  }
+
+  void Clear() {
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+    dropped_ = 0;
+  }
+
+  uint64_t Dropped() const {
+    return dropped_;
+  }
+
+ private:
+  T entries_[N];
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+  uint64_t dropped_ = 0;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_PER_HART_RING_H
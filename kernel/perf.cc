@@ -0,0 +1,108 @@
+#include "kernel/perf.h"
+
+#include "arch/riscv_reg.h"
+#include "kernel/lock/critical_guard.h"
+
+namespace kernel {
+
+uint64_t PerfContext::ReadHardware(int id, const Counter& counter) {
+  if (counter.type == perf_def::raw) {
+    return riscv::regs::mhpmcounter.read(riscv::MIN_HPM_COUNTER + id);
+  }
+  return counter.config == perf_def::cycles ? riscv::regs::mcycle.read() : riscv::regs::minstret.read();
+}
+
+void PerfContext::Start() {
+  for (int id = 0; id < perf_def::MAX_COUNTERS; ++id) {
+    if (enabled_mask_ & (1u << id)) {
+      Counter& counter = counters_[id];
+      if (counter.type == perf_def::raw) {
+        riscv::regs::mhpmevent.write(riscv::MIN_HPM_COUNTER + id, counter.config);
+      }
+      counter.start = ReadHardware(id, counter);
+    }
+  }
+}
+
+void PerfContext::Stop() {
+  for (int id = 0; id < perf_def::MAX_COUNTERS; ++id) {
+    if (enabled_mask_ & (1u << id)) {
+      Counter& counter = counters_[id];
+      counter.count += ReadHardware(id, counter) - counter.start;
+    }
+  }
+}
+
+int PerfContext::Open(int type, uint64_t config) {
+  if (type == perf_def::hardware && config != perf_def::cycles && config != perf_def::instructions) {
+    return -1;
+  }
+  if (type != perf_def::hardware && type != perf_def::raw) {
+    return -1;
+  }
+  for (int id = 0; id < perf_def::MAX_COUNTERS; ++id) {
+    if (!(open_mask_ & (1u << id))) {
+      counters_[id] = Counter{type, config, 0, 0};
+      open_mask_ |= 1u << id;
+      return id;
+    }
+  }
+  return -1;
+}
+
+bool PerfContext::Control(int id, int cmd) {
+  if (id < 0 || id >= perf_def::MAX_COUNTERS || !(open_mask_ & (1u << id))) {
+    return false;
+  }
+  // a switch out in between would account the counter twice
+  bool is_intr_on = InterruptPushOff();
+  Counter& counter = counters_[id];
+  bool enabled = enabled_mask_ & (1u << id);
+  bool ret = true;
+  switch (cmd) {
+  case perf_def::enable:
+    if (!enabled) {
+      if (counter.type == perf_def::raw) {
+        riscv::regs::mhpmevent.write(riscv::MIN_HPM_COUNTER + id, counter.config);
+      }
+      counter.start = ReadHardware(id, counter);
+      enabled_mask_ |= 1u << id;
+    }
+    break;
+  case perf_def::disable:
+  case perf_def::close:
+    if (enabled) {
+      counter.count += ReadHardware(id, counter) - counter.start;
+      enabled_mask_ &= ~(1u << id);
+    }
+    if (cmd == perf_def::close) {
+      open_mask_ &= ~(1u << id);
+    }
+    break;
+  case perf_def::reset:
+    counter.count = 0;
+    counter.start = ReadHardware(id, counter);
+    break;
+  default:
+    ret = false;
+    break;
+  }
+  InterruptPop(is_intr_on);
+  return ret;
+}
+
+bool PerfContext::Read(int id, uint64_t* value) const {
+  if (id < 0 || id >= perf_def::MAX_COUNTERS || !(open_mask_ & (1u << id))) {
+    return false;
+  }
+  bool is_intr_on = InterruptPushOff();
+  const Counter& counter = counters_[id];
+  *value = counter.count;
+  if (enabled_mask_ & (1u << id)) {
+    *value += ReadHardware(id, counter) - counter.start;
+  }
+  InterruptPop(is_intr_on);
+  return true;
+}
+
+}  // namespace kernel
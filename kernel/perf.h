@@ -0,0 +1,53 @@
+#ifndef KERNEL_PERF_H
+#define KERNEL_PERF_H
+
+#include "kernel/sys_def/perf_def.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Hardware counters virtualized per task. The counters keep running for
+// the whole hart, a task only accumulates the difference between being
+// switched in and out. Raw events of slot i use mhpmcounter3 + i, whose
+// selector is programmed on every switch in, so tasks do not compete for
+// counters.
+class PerfContext {
+ public:
+  // returns the counter id, -1 if no slot is free or the event is unknown
+  int Open(int type, uint64_t config);
+  bool Control(int id, int cmd);
+  // count including the running period, the owner is the running task
+  bool Read(int id, uint64_t* value) const;
+
+  void SwitchIn() {
+    if (enabled_mask_) {
+      Start();
+    }
+  }
+  void SwitchOut() {
+    if (enabled_mask_) {
+      Stop();
+    }
+  }
+
+ private:
+  struct Counter {
+    int type = 0;
+    uint64_t config = 0;
+    uint64_t count = 0;
+    // hardware value when the task was switched in or the counter enabled
+    uint64_t start = 0;
+  };
+
+  static uint64_t ReadHardware(int id, const Counter& counter);
+  void Start();
+  void Stop();
+
+  Counter counters_[perf_def::MAX_COUNTERS];
+  uint8_t open_mask_ = 0;
+  uint8_t enabled_mask_ = 0;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_PERF_H
@@ -0,0 +1,116 @@
+#include "kernel/pipe.h"
+
+#include <algorithm>
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/scheduler.h"
+#include "kernel/slab.h"
+#include "kernel/uaccess.h"
+#include "kernel/virtual_memory.h"
+
+namespace kernel {
+
+static constexpr uint64_t PIPE_SIZE = memory_layout::PGSIZE;
+static ObjectCache<Pipe> pipe_cache("pipe");
+
+Pipe* Pipe::Create() {
+  auto* buf = reinterpret_cast<char*>(VirtualMemory::Instance()->Alloc());
+  if (!buf) {
+    return nullptr;
+  }
+  Pipe* pipe = pipe_cache.Alloc();
+  if (!pipe) {
+    VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(buf));
+    return nullptr;
+  }
+  pipe->buf_ = buf;
+  return pipe;
+}
+
+Pipe::~Pipe() {
+  if (buf_) {
+    VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(buf_));
+  }
+}
+
+int64_t Pipe::Read(uint64_t dst, size_t size, bool wait) {
+  auto* process = Schedueler::Instance()->ThisProcess();
+  CriticalGuard guard(&lk_);
+  while (wait && read_pos_ == write_pos_ && writers_ > 0) {
+    if (process->killed) {
+      return -1;
+    }
+    Channel channel(&read_pos_);
+    Schedueler::Instance()->Sleep(&channel, &lk_);
+  }
+  size_t total = 0;
+  while (total < size && read_pos_ != write_pos_) {
+    uint64_t index = read_pos_ % PIPE_SIZE;
+    size_t len = std::min({size - total, write_pos_ - read_pos_, PIPE_SIZE - index});
+    if (!copy_to_user(dst + total, buf_ + index, len)) {
+      if (!total) {
+        return -1;
+      }
+      break;
+    }
+    total += len;
+    read_pos_ += len;
+  }
+  Channel channel(&write_pos_);
+  Schedueler::Instance()->Wakeup(&channel);
+  return total;
+}
+
+int64_t Pipe::Write(uint64_t src, size_t size) {
+  auto* process = Schedueler::Instance()->ThisProcess();
+  CriticalGuard guard(&lk_);
+  Channel read_channel(&read_pos_);
+  size_t total = 0;
+  while (total < size) {
+    if (!readers_ || process->killed) {
+      return total ? total : -1;
+    }
+    if (write_pos_ - read_pos_ == PIPE_SIZE) {
+      // let the readers drain what is there before waiting for room
+      Schedueler::Instance()->Wakeup(&read_channel);
+      Channel channel(&write_pos_);
+      Schedueler::Instance()->Sleep(&channel, &lk_);
+      continue;
+    }
+    uint64_t index = write_pos_ % PIPE_SIZE;
+    size_t len = std::min({size - total, PIPE_SIZE - (write_pos_ - read_pos_), PIPE_SIZE - index});
+    if (!copy_from_user(buf_ + index, src + total, len)) {
+      if (!total) {
+        return -1;
+      }
+      break;
+    }
+    total += len;
+    write_pos_ += len;
+  }
+  Schedueler::Instance()->Wakeup(&read_channel);
+  return total;
+}
+
+void Pipe::Close(bool write_end) {
+  {
+    CriticalGuard guard(&lk_);
+    if (write_end) {
+      writers_ -= 1;
+    } else {
+      readers_ -= 1;
+    }
+    // sleepers of the other end see the change and return
+    Channel read_channel(&read_pos_);
+    Channel write_channel(&write_pos_);
+    Schedueler::Instance()->Wakeup(&read_channel);
+    Schedueler::Instance()->Wakeup(&write_channel);
+    if (readers_ || writers_) {
+      return;
+    }
+  }
+  pipe_cache.Free(this);
+}
+
+}  // namespace kernel
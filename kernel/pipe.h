@@ -0,0 +1,40 @@
+#ifndef KERNEL_PIPE_H
+#define KERNEL_PIPE_H
+
+#include "kernel/lock/spin_lock.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// One way channel between processes through a ring buffer of a page.
+// Readers sleep while it is empty, writers while it is full. Every open
+// FileDescriptor of an end counts once, the pipe is freed when the last
+// end is closed.
+class Pipe {
+ public:
+  static Pipe* Create();
+
+  // copy up to size bytes to the user buffer dst, waits for data unless
+  // wait is false, 0 once it is empty and every write end is closed
+  int64_t Read(uint64_t dst, size_t size, bool wait = true);
+  // copy size bytes from the user buffer src, waits for room on the way,
+  // -1 if every read end is closed before anything was written
+  int64_t Write(uint64_t src, size_t size);
+  void Close(bool write_end);
+
+  Pipe() {}
+  ~Pipe();
+
+ private:
+  SpinLock lk_;
+  char* buf_ = nullptr;
+  // running counts of bytes, their difference is what the buffer holds
+  uint64_t read_pos_ = 0;
+  uint64_t write_pos_ = 0;
+  int readers_ = 1;
+  int writers_ = 1;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_PIPE_H
@@ -1,14 +1,17 @@
 #include <algorithm>
 #include <assert.h>
-#include <span>
 
 #include "lib/string.h"
+#include "kernel/asid_allocator.h"
+#include "kernel/file_table.h"
 #include "kernel/lock/critical_guard.h"
 #include "kernel/printf.h"
 #include "kernel/process.h"
 #include "kernel/regs_frame.hpp"
 #include "kernel/scheduler.h"
 #include "kernel/sys_def/descriptor_def.h"
+#include "kernel/timer.h"
+#include "kernel/uaccess.h"
 #include "kernel/virtual_memory.h"
 
 namespace kernel {
@@ -22,24 +25,20 @@ int ProcessManager::AllocPid() {
 }
 
 void ProcessManager::ResetProcess(ProcessTask* process) {
-  process->FreePageTable();
-  process->page_table = nullptr;
+  process->ReleaseMemory();
   process->frame = nullptr;
   process->kernel_sp = nullptr;
   process->user_sp = nullptr;
-  process->used_address_size = 0;
-  std::fill(process->used_address.begin(), process->used_address.end(), MemoryRegion(0, 0));
   process->state = ProcessState::unused;
   memset(&process->saved_context, 0, sizeof(process->saved_context));
-  process->parent_process = nullptr;
   std::fill(process->current_path, process->current_path + strlen(process->current_path), 0);
   const char* root_path = "/";
   std::copy(root_path, root_path + strlen(root_path) + 1, process->current_path);
   process->channel = nullptr;
-  for (fs::FileDescriptor& fd : process->file_descriptor) {
-    memset(&fd, 0, sizeof(fd));
+  if (process->files) {
+    FileTable::Put(process->files);
+    process->files = nullptr;
   }
-  process->pid = 0;
 }
 
 void ExecuteRet();
@@ -50,26 +49,49 @@ bool ProcessTask::Init(bool need_init_kernel_info) {
   if (!frame_page) {
     return false;
   }
-  auto root_page_table = mem_manager->Alloc();
-  if (!root_page_table) {
+  auto* memory_space = MemorySpace::Create();
+  if (!memory_space) {
     mem_manager->FreePage({frame_page});
     return false;
   }
   auto user_stack_page = mem_manager->Alloc();
   if (!user_stack_page) {
-    mem_manager->FreePage({frame_page, root_page_table});
+    mem_manager->FreePage({frame_page});
+    MemorySpace::Put(memory_space);
     return false;
   }
   uint64_t user_stack_page_va = VirtualMemory::GetUserSpVa() - memory_layout::PGSIZE;
-  if (!mem_manager->MapPage(root_page_table, user_stack_page_va, (uint64_t)user_stack_page, riscv::PTE::R | riscv::PTE::W | riscv::PTE::U)) {
-     mem_manager->FreePage({frame_page, root_page_table, user_stack_page});
+  if (!mem_manager->MapPage(memory_space->page_table, user_stack_page_va, (uint64_t)user_stack_page, riscv::PTE::R | riscv::PTE::W | riscv::PTE::U)) {
+    mem_manager->FreePage({frame_page, user_stack_page});
+    MemorySpace::Put(memory_space);
     return false;
   }
+  // from here on the stack page is released together with memory_space
   if (need_init_kernel_info) {
     auto sp_page = mem_manager->Alloc();
     if (!sp_page) {
-      frame = nullptr;
-      mem_manager->FreePage({frame_page, root_page_table, user_stack_page});
+      mem_manager->FreePage({frame_page});
+      MemorySpace::Put(memory_space);
+      return false;
+    }
+    files = FileTable::Create();
+    if (!files) {
+      mem_manager->FreePage({frame_page, sp_page});
+      MemorySpace::Put(memory_space);
+      return false;
+    }
+    fs::FileDescriptor console_fd{};
+    console_fd.file_type = fs::FileType::device;
+    console_fd.inode.major = 0;
+    console_fd.inode.minor = 0;
+    // the console is the input too until the parent redirects it
+    if (files->Install(console_fd) != descriptor_def::io::console ||
+        files->Dup(descriptor_def::io::console) != descriptor_def::io::input) {
+      printf("Error: fd in descriptor_def::io is not empty\n");
+      FileTable::Put(files);
+      files = nullptr;
+      mem_manager->FreePage({frame_page, sp_page});
+      MemorySpace::Put(memory_space);
       return false;
     }
     kernel_sp = sp_page;
@@ -77,103 +99,122 @@ bool ProcessTask::Init(bool need_init_kernel_info) {
     saved_context.sp = reinterpret_cast<uint64_t>(kernel_sp) + memory_layout::PGSIZE;
     saved_context.ra = reinterpret_cast<uint64_t>(ExecuteRet);
   }
-  page_table = root_page_table;
+  mm = memory_space;
   frame = reinterpret_cast<RegFrame*>(frame_page);
   assert(sizeof(RegFrame) == 2048);
   user_sp = user_stack_page;
   frame->kernel_sp = (uint64_t)kernel_sp + memory_layout::PGSIZE;
   frame->sp = user_stack_page_va + memory_layout::PGSIZE;
-  if (file_descriptor[descriptor_def::io::console].file_type != fs::FileType::none) {
-    printf("Error: fd in descriptor_def::io::console is not empty\n");
+  return true;
+}
+
+bool ProcessTask::InitThread(ProcessTask* creator, uint64_t entry, uint64_t arg) {
+  auto* mem_manager = VirtualMemory::Instance();
+  auto frame_page = mem_manager->Alloc();
+  if (!frame_page) {
     return false;
   }
-  file_descriptor[descriptor_def::io::console].file_type = fs::FileType::device;
-  file_descriptor[descriptor_def::io::console].inode.major = 0;
-  file_descriptor[descriptor_def::io::console].inode.minor = 0;
+  auto sp_page = mem_manager->Alloc();
+  if (!sp_page) {
+    mem_manager->FreePage({frame_page});
+    return false;
+  }
+  int slot = creator->mm->AllocStackSlot();
+  if (slot < 0) {
+    mem_manager->FreePage({frame_page, sp_page});
+    return false;
+  }
+  creator->mm->Get();
+  creator->files->Get();
+  mm = creator->mm;
+  files = creator->files;
+  stack_slot = slot;
+  group_leader = creator->Leader();
+  memcpy(current_path, creator->current_path, sizeof(current_path));
+  kernel_sp = sp_page;
+  pid = ProcessManager::AllocPid();
+  saved_context.sp = reinterpret_cast<uint64_t>(kernel_sp) + memory_layout::PGSIZE;
+  saved_context.ra = reinterpret_cast<uint64_t>(ExecuteRet);
+  frame = reinterpret_cast<RegFrame*>(frame_page);
+  // the thread resumes in user mode with the creator's globals and a fresh stack
+  memcpy(frame, creator->frame, sizeof(*frame));
+  frame->kernel_sp = reinterpret_cast<uint64_t>(kernel_sp) + memory_layout::PGSIZE;
+  frame->sp = MemorySpace::StackSlotTop(slot);
+  frame->mepc = entry;
+  frame->a0 = arg;
+  frame->ra = 0;
   return true;
 }
 
-void ProcessTask::FreePageTable(bool need_free_kernel_page) {
-  for (int level = 3; level > 0; level--) {
-    for (size_t i = 0; i < used_address_size; i++) {
-      VirtualMemory::Instance()->FreeMemory(page_table, used_address[i].first, used_address[i].second, level);
+void ProcessTask::ReleaseMemory(bool need_free_kernel_page) {
+  if (frame) {
+    VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(frame));
+  }
+  if (mm) {
+    if (stack_slot >= 0) {
+      mm->FreeStackSlot(stack_slot);
+      stack_slot = -1;
     }
-    VirtualMemory::Instance()->FreeMemory(page_table, VirtualMemory::Instance()->GetUserSpVa() - memory_layout::PGSIZE, VirtualMemory::Instance()->GetUserSpVa(), level);
+    MemorySpace::Put(mm);
+    mm = nullptr;
   }
-  VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(frame));
-  VirtualMemory::Instance()->FreePage(page_table);
-  if (need_free_kernel_page) {
+  if (need_free_kernel_page && kernel_sp) {
     VirtualMemory::Instance()->FreePage(kernel_sp);
   }
 }
 
+void TaskUsage::Add(const TaskUsage& other) {
+  utime += other.utime;
+  stime += other.stime;
+  nvcsw += other.nvcsw;
+  nivcsw += other.nivcsw;
+  nfault += other.nfault;
+  inblock += other.inblock;
+  oublock += other.oublock;
+}
+
+void ProcessTask::AccountUserTime() {
+  uint64_t now = TimerManager::Now();
+  usage.utime += now - usage_mark;
+  usage_mark = now;
+}
+
+void ProcessTask::AccountKernelTime() {
+  uint64_t now = TimerManager::Now();
+  usage.stime += now - usage_mark;
+  usage_mark = now;
+}
+
 void ProcessTask::CopyMemoryFrom(const ProcessTask* process) {
-  page_table = process->page_table;
+  mm = process->mm;
   frame = process->frame;
-  used_address_size = process->used_address_size;
-  used_address = process->used_address;
   user_sp = process->user_sp;
-  dynamic_info = process->dynamic_info;
-}
-
-static bool CopyMemory(uint64_t* src_root_page,
-                       uint64_t* dst_root_page,
-                       const std::span<const MemoryRegion>& region,
-                       size_t used_address_size) {
-  for (size_t i = 0; i < used_address_size; ++i) {
-    riscv::PTE pte = riscv::PTE::None;
-    uint64_t va_beg = region[i].first, va_end = region[i].second;
-    auto size = va_end - va_beg;
-    while (size > 0) {
-      uint64_t src_pa = VirtualMemory::Instance()->VAToPA(src_root_page, va_beg, &pte);
-      uint64_t remain_size = memory_layout::PGSIZE - src_pa % memory_layout::PGSIZE;
-      size_t len = size > remain_size ? remain_size : size;
-      if (!VirtualMemory::Instance()->MapMemory(dst_root_page, va_beg, va_beg + len, pte)) {
-        return false;
-      }
-      uint64_t dst_pa = VirtualMemory::Instance()->VAToPA(dst_root_page, va_beg);
-      memcpy(reinterpret_cast<uint8_t*>(dst_pa), reinterpret_cast<uint8_t*>(src_pa), len);
-      size -= len;
-      va_beg = VirtualMemory::AddrCastDown(va_beg) + memory_layout::PGSIZE;
-    }
-  }
-  return true;
 }
 
 bool ProcessTask::CopyFrom(const ProcessTask* src_process) {
-  if (!CopyMemory(src_process->page_table, page_table, src_process->used_address, src_process->used_address_size)) {
+  if (!mm->CopyFrom(src_process->mm)) {
     return false;
   }
-  std::copy(src_process->used_address.begin(), src_process->used_address.begin() + src_process->used_address_size, used_address.begin());
-  used_address_size = src_process->used_address_size;
-
-  memcpy(user_sp, src_process->user_sp, memory_layout::PGSIZE);
+  // the child starts with the open files of the parent, e.g. pipe ends set up by a shell
+  if (!files->CopyFrom(src_process->files)) {
+    return false;
+  }
+  // threads have no main stack page of their own, it belongs to the leader
+  const ProcessTask* src_leader = src_process->group_leader ? src_process->group_leader : src_process;
+  memcpy(user_sp, src_leader->user_sp, memory_layout::PGSIZE);
+  // a forking thread keeps running on its own stack in the child
+  if (src_process->stack_slot >= 0) {
+    if (!mm->CopyStackSlot(src_process->mm, src_process->stack_slot)) {
+      return false;
+    }
+    stack_slot = src_process->stack_slot;
+  }
 
   // prepare trapframe
   memcpy(frame, src_process->frame, sizeof(*frame));
   frame->kernel_sp = reinterpret_cast<uint64_t>(kernel_sp) + memory_layout::PGSIZE;
   memcpy(current_path, src_process->current_path, strlen(src_process->current_path));
-  dynamic_info = src_process->dynamic_info;
   return true;
 }
 
-uint64_t ProcessTask::ExpandMemory(size_t bytes) {
-  if (bytes == 0) {
-    return 0;
-  }
-  uint64_t max_mem_addr = 0;
-  for (size_t i = 0; i < used_address_size; i++) {
-    if (used_address[i].second > max_mem_addr) {
-      max_mem_addr = used_address[i].second;
-    }
-  }
-  max_mem_addr = VirtualMemory::AddrCastUp(max_mem_addr);
-  if (!VirtualMemory::Instance()->MapMemory(page_table, max_mem_addr, max_mem_addr + bytes, riscv::PTE::R | riscv::PTE::W | riscv::PTE::U)) {
-    return 0;
-  }
-  used_address[used_address_size] = {max_mem_addr, max_mem_addr + bytes};
-  used_address_size += 1;
-  return max_mem_addr;
-}
-
 }  // namespace kernel
@@ -6,11 +6,16 @@
 
 #include "filesystem/file_descriptor.h"
 #include "kernel/lock/spin_lock.h"
+#include "kernel/memory_space.h"
+#include "kernel/perf.h"
 #include "kernel/regs_frame.hpp"
 #include "lib/types.h"
 
 namespace kernel {
 
+class FileTable;
+struct ProcessTask;
+
 struct SavedContext {
   uint64_t ra;
   uint64_t s0;
@@ -37,8 +42,43 @@ enum class ProcessState : uint8_t {
   zombie,
 };
 
-// va_beg, va_end
-using MemoryRegion = std::pair<uint64_t, uint64_t>;
+struct SchedEntity {
+  // one of sched_def::policy
+  int policy = 0;
+  // only used by the normal policy, lower gets a larger share
+  int nice = 0;
+  // only used by fifo and rr, higher runs first
+  int rt_priority = 0;
+  // run time scaled by the weight of nice, in mtime units
+  uint64_t vruntime = 0;
+  // mtime when the task was last put on a cpu
+  uint64_t exec_start = 0;
+  // total mtime spent running
+  uint64_t sum_exec = 0;
+  // counted by the run queue of its class, whether waiting or on a cpu
+  bool on_rq = false;
+  // taken off the run queue to run, PutPrev puts it back
+  bool on_cpu = false;
+  // slot in the heap of the fair class, -1 if not queued there
+  int heap_index = -1;
+  // links of the priority list of the real time class
+  ProcessTask* rt_prev = nullptr;
+  ProcessTask* rt_next = nullptr;
+};
+
+struct TaskUsage {
+  // mtime spent in user and in kernel mode
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  // context switches by sleeping and by preemption
+  uint64_t nvcsw = 0;
+  uint64_t nivcsw = 0;
+  uint64_t nfault = 0;
+  // blocks read from and written to disk
+  uint64_t inblock = 0;
+  uint64_t oublock = 0;
+  void Add(const TaskUsage& other);
+};
 
 class Channel {
  public:
@@ -46,41 +86,70 @@ class Channel {
   bool operator==(const Channel& ch) const {
     return ch.data_ == this->data_;
   }
+  const void* data() const {
+    return data_;
+  }
 
  private:
   const void* data_ = nullptr;
 };
 
-struct DynamicInfo {
-  uint64_t dynamic_vaddr = 0;
-  uint64_t dynamic_size = 0;
-};
-
 struct ProcessTask {
   ProcessTask() : owned_channel(this) {}
   SpinLock lock;
   const char* name = nullptr;
   int pid = 0;
   RegFrame* frame = nullptr;
-  uint64_t* page_table = nullptr;
-  size_t used_address_size = 0;
-  std::array<MemoryRegion, 16> used_address;
+  // shared by every thread of the process, nullptr for kernel threads
+  MemorySpace* mm = nullptr;
   uint64_t* kernel_sp = nullptr;
   uint64_t* user_sp = nullptr;
   ProcessState state = ProcessState::unused;
   SavedContext saved_context;
-  const ProcessTask* parent_process = nullptr;
+  ProcessTask* parent_process = nullptr;
+  // children of this process are chained through sibling
+  ProcessTask* children = nullptr;
+  ProcessTask* sibling = nullptr;
+  // links of the scheduler task list and pid hash chain
+  ProcessTask* task_prev = nullptr;
+  ProcessTask* task_next = nullptr;
+  ProcessTask* hash_next = nullptr;
   const Channel* channel = nullptr;
-  std::array<fs::FileDescriptor, 16> file_descriptor;
-  char current_path[128] = "/";
+  // links of the wait bucket of channel while sleeping on it
+  ProcessTask* wait_prev = nullptr;
+  ProcessTask* wait_next = nullptr;
+  FileTable* files = nullptr;
+  char current_path[fs::MAX_PATH_LEN] = "/";
   Channel owned_channel;
   int exit_code = 0;
-  DynamicInfo dynamic_info;
+  // first thread of the group, nullptr if this task is the leader itself
+  ProcessTask* group_leader = nullptr;
+  // thread stack slot in mm, -1 for the main stack
+  int stack_slot = -1;
+  // set when the thread group goes down, checked before returning to user
+  bool killed = false;
+  void (*kthread_fn)(void*) = nullptr;
+  void* kthread_arg = nullptr;
+  SchedEntity se;
+  // own usage, reaped threads are added to their leader
+  TaskUsage usage;
+  // reaped children and their descendants
+  TaskUsage child_usage;
+  // mtime of the last switch between user mode, kernel mode and off cpu
+  uint64_t usage_mark = 0;
+  // counters opened by this thread, not inherited by fork
+  PerfContext perf;
   bool Init(bool need_init_kernel_info = true);
-  void FreePageTable(bool need_free_kernel_page = true);
+  // new thread of creator running entry(arg) on its own stack
+  bool InitThread(ProcessTask* creator, uint64_t entry, uint64_t arg);
+  // drop the frame, the thread stack and this thread's reference to mm
+  void ReleaseMemory(bool need_free_kernel_page = true);
   void CopyMemoryFrom(const ProcessTask* process);
   bool CopyFrom(const ProcessTask* process);
-  uint64_t ExpandMemory(size_t bytes);
+  ProcessTask* Leader() { return group_leader ? group_leader : this; }
+  // charge the time since usage_mark to user or kernel mode
+  void AccountUserTime();
+  void AccountKernelTime();
 };
 
 class ProcessManager {
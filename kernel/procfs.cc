@@ -0,0 +1,508 @@
+#include "kernel/procfs.h"
+
+#include <stdarg.h>
+#include <algorithm>
+
+#include "driver/device_factory.h"
+#include "driver/virtio_blk.h"
+#include "filesystem/common.h"
+#include "kernel/config/memory_layout.h"
+#include "kernel/config/system_param.h"
+#include "kernel/extern_controller.h"
+#include "kernel/file_table.h"
+#include "kernel/lock/instrumented_lock.h"
+#include "kernel/memory_space.h"
+#include "kernel/scheduler.h"
+#include "kernel/shm.h"
+#include "kernel/slab.h"
+#include "kernel/sys_def/sched_def.h"
+#include "kernel/sys_def/time_def.h"
+#include "kernel/timer.h"
+#include "kernel/uaccess.h"
+#include "kernel/virtual_memory.h"
+#include "lib/common.h"
+#include "lib/printk.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+namespace {
+
+enum Entry : uint32_t {
+  root = 0,
+  meminfo,
+  vmstat,
+  diskstats,
+  interrupts,
+  lockstat,
+  slabinfo,
+  pid_dir,
+  pid_status,
+  pid_maps,
+};
+
+struct EntryName {
+  const char* name;
+  Entry entry;
+};
+
+constexpr EntryName root_entries[] = {
+  {"meminfo", meminfo},
+  {"vmstat", vmstat},
+  {"diskstats", diskstats},
+  {"interrupts", interrupts},
+  {"lockstat", lockstat},
+  {"slabinfo", slabinfo},
+};
+
+constexpr EntryName pid_entries[] = {
+  {"status", pid_status},
+  {"maps", pid_maps},
+};
+
+// fs::FileDescriptor::inode_index of a proc file holds the pid above the entry
+constexpr uint32_t ENTRY_BITS = 8;
+constexpr uint32_t ENTRY_MASK = (1u << ENTRY_BITS) - 1;
+
+void Format(char* out, const char* fmt, ...) {
+  va_list va;
+  va_start(va, fmt);
+  simple_vsprintf(&out, fmt, va, nullptr);
+  va_end(va);
+}
+
+// Collects the content of a file, what does not fit is dropped.
+class ProcText {
+ public:
+  ProcText(char* buf, size_t capacity) : buf_(buf), capacity_(capacity) {}
+
+  // a single line must stay below 128 characters
+  void Append(const char* fmt, ...) {
+    char line[128];
+    char* p = line;
+    va_list va;
+    va_start(va, fmt);
+    simple_vsprintf(&p, fmt, va, nullptr);
+    va_end(va);
+    Write(line, p - line);
+  }
+
+  void Write(const void* data, size_t len) {
+    len = std::min(len, capacity_ - size_);
+    memcpy(buf_ + size_, data, len);
+    size_ += len;
+  }
+
+  size_t Size() const {
+    return size_;
+  }
+
+ private:
+  char* buf_;
+  size_t capacity_;
+  size_t size_ = 0;
+};
+
+void AppendDirElement(ProcText* text, uint32_t node, const char* name) {
+  fs::DirElement element{};
+  element.inum = node;
+  memcpy(element.name, name, std::min<size_t>(strlen(name), fs::MAX_FILE_NAME_LEN - 1));
+  text->Write(&element, sizeof(element));
+}
+
+// Copied out while the task table is locked, so the task may go away
+// while the text is generated.
+struct TaskSnapshot {
+  bool found = false;
+  char name[16] = {0};
+  int pid = 0;
+  int ppid = 0;
+  ProcessState state = ProcessState::unused;
+  int threads = 0;
+  int fds = 0;
+  SchedEntity se;
+  // the whole group, reaped threads included
+  TaskUsage usage;
+  bool has_mm = false;
+  size_t region_num = 0;
+  MemoryRegion regions[16];
+  uint64_t stack_slots = 0;
+  int shm_num = 0;
+  struct {
+    uint64_t va;
+    size_t pages;
+    char name[mman_def::MAX_SHM_NAME];
+  } shm[MemorySpace::MAX_SHM_MAPPING];
+};
+
+TaskSnapshot TakeSnapshot(int pid) {
+  TaskSnapshot snapshot;
+  Schedueler::Instance()->ForEachTask([pid, &snapshot](ProcessTask* task) {
+    if (task->state == ProcessState::unused || task->Leader()->pid != pid) {
+      return;
+    }
+    snapshot.threads += 1;
+    if (task != task->Leader()) {
+      snapshot.usage.Add(task->usage);
+      return;
+    }
+    snapshot.found = true;
+    if (task->name) {
+      memcpy(snapshot.name, task->name, std::min<size_t>(strlen(task->name), sizeof(snapshot.name) - 1));
+    }
+    snapshot.pid = task->pid;
+    snapshot.ppid = task->parent_process ? task->parent_process->pid : 0;
+    snapshot.state = task->state;
+    snapshot.fds = task->files ? task->files->OpenNum() : 0;
+    snapshot.se = task->se;
+    snapshot.usage.Add(task->usage);
+    if (task->mm) {
+      snapshot.has_mm = true;
+      snapshot.region_num = std::min(task->mm->used_address_size, std::size(snapshot.regions));
+      std::copy(task->mm->used_address.begin(), task->mm->used_address.begin() + snapshot.region_num, snapshot.regions);
+      snapshot.stack_slots = task->mm->stack_slots;
+      for (const ShmMapping& mapping : task->mm->shm_mappings) {
+        if (!mapping.segment) {
+          continue;
+        }
+        auto& shm = snapshot.shm[snapshot.shm_num++];
+        shm.va = mapping.va;
+        shm.pages = mapping.pages;
+        memcpy(shm.name, mapping.segment->Name(), sizeof(shm.name));
+      }
+    }
+  });
+  return snapshot;
+}
+
+bool IsProcess(int pid) {
+  ProcessTask* task = Schedueler::Instance()->FindProc(pid);
+  return task && task->state != ProcessState::unused && !task->group_leader;
+}
+
+const char* StateName(ProcessState state) {
+  switch (state) {
+  case ProcessState::used:
+    return "new";
+  case ProcessState::sleep:
+    return "sleeping";
+  case ProcessState::runnable:
+    return "runnable";
+  case ProcessState::running:
+    return "running";
+  case ProcessState::zombie:
+    return "zombie";
+  default:
+    return "unused";
+  }
+}
+
+const char* PolicyName(int policy) {
+  switch (policy) {
+  case sched_def::fifo:
+    return "fifo";
+  case sched_def::rr:
+    return "rr";
+  default:
+    return "normal";
+  }
+}
+
+uint64_t MtimeToMs(uint64_t mtime) {
+  return TimerManager::MtimeToNs(mtime) / 1'000'000;
+}
+
+void GenerateRoot(ProcText* text) {
+  for (const auto& e : root_entries) {
+    AppendDirElement(text, e.entry, e.name);
+  }
+  AppendDirElement(text, pid_dir, "self");
+  Schedueler::Instance()->ForEachTask([text](ProcessTask* task) {
+    if (task->state != ProcessState::unused && !task->group_leader) {
+      char name[16];
+      Format(name, "%d", task->pid);
+      AppendDirElement(text, (task->pid << ENTRY_BITS) | pid_dir, name);
+    }
+  });
+}
+
+void GenerateMeminfo(ProcText* text) {
+  auto* vm = VirtualMemory::Instance();
+  uint64_t slab_pages = 0;
+  for (KmemCache* cache = KmemCache::Head(); cache; cache = cache->Next()) {
+    slab_pages += cache->SlabNum();
+  }
+  constexpr uint64_t kb_per_page = memory_layout::PGSIZE / 1024;
+  text->Append("MemTotal: %lu kB\n", (memory_layout::MEMORY_END - memory_layout::KERNEL_BASE) / 1024);
+  text->Append("MemFree: %lu kB\n", vm->GetFreePageSize() * kb_per_page);
+  text->Append("MemZeroed: %lu kB\n", vm->GetZeroedPageSize() * kb_per_page);
+  text->Append("Slab: %lu kB\n", slab_pages * kb_per_page);
+}
+
+void GenerateVmstat(ProcText* text) {
+  auto* vm = VirtualMemory::Instance();
+  PageStats stats = vm->GetPageStats();
+  uint64_t faults = 0;
+  uint64_t nvcsw = 0;
+  uint64_t nivcsw = 0;
+  uint64_t tasks = 0;
+  Schedueler::Instance()->ForEachTask([&](ProcessTask* task) {
+    if (task->state != ProcessState::unused) {
+      faults += task->usage.nfault;
+      nvcsw += task->usage.nvcsw;
+      nivcsw += task->usage.nivcsw;
+      tasks += 1;
+    }
+  });
+  text->Append("nr_free_pages %lu\n", vm->GetFreePageSize());
+  text->Append("nr_zeroed_pages %lu\n", vm->GetZeroedPageSize());
+  text->Append("pgalloc %lu\n", stats.alloc);
+  text->Append("pgalloc_zeroed %lu\n", stats.alloc_zeroed);
+  text->Append("pgfree %lu\n", stats.free);
+  // counted over live tasks only
+  text->Append("nr_tasks %lu\n", tasks);
+  text->Append("pgfault %lu\n", faults);
+  text->Append("nvcsw %lu\n", nvcsw);
+  text->Append("nivcsw %lu\n", nivcsw);
+}
+
+void GenerateDiskstats(ProcText* text) {
+  constexpr std::pair<driver::DeviceList, const char*> disks[] = {
+    {driver::DeviceList::disk0, "disk0"},
+    {driver::DeviceList::disk1, "disk1"},
+  };
+  text->Append("name reads writes read_ms write_ms queue_in_use queue_size\n");
+  for (const auto& [disk, name] : disks) {
+    auto* device = reinterpret_cast<driver::virtio::BlockDevice*>(driver::DeviceFactory::Instance()->GetDevice(disk));
+    const driver::virtio::BlockStats& stats = device->Stats();
+    text->Append("%s %lu %lu %lu %lu %u %u\n", name, stats.reads, stats.writes, MtimeToMs(stats.read_ticks),
+                 MtimeToMs(stats.write_ticks), device->DescInUse(0), driver::virtio::queue_buffer_size);
+  }
+}
+
+void GenerateInterrupts(ProcText* text) {
+  text->Append("%-10s", "");
+  for (size_t hart = 0; hart < system_param::CPU_NUM; ++hart) {
+    text->Append(" %10s%lu", "CPU", hart);
+  }
+  text->Append("\n%-10s", "timer:");
+  for (size_t hart = 0; hart < system_param::CPU_NUM; ++hart) {
+    text->Append(" %13lu", TimerManager::Instance()->InterruptCount(hart));
+  }
+  text->Append("\n");
+  auto* controller = ExternController::Instance();
+  for (uint32_t i = 0; i < controller->IrqNum(); ++i) {
+    const auto& info = controller->GetIrqInfo(i);
+    text->Append("%3u %-6s", lib::common::literal(info.irq), info.name);
+    for (size_t hart = 0; hart < system_param::CPU_NUM; ++hart) {
+      text->Append(" %13lu", info.count[hart]);
+    }
+    text->Append("\n");
+  }
+}
+
+void GenerateLockstat(ProcText* text) {
+  text->Append("name acquisitions contended spin_cycles max_hold_cycles\n");
+  for (auto* node = LockStatsNode::Head(); node; node = node->next()) {
+    const auto& s = node->stats();
+    text->Append("%s %lu %lu %lu %lu\n", node->name(), s.acquisitions, s.contended, s.spin_cycles, s.max_hold_cycles);
+  }
+}
+
+void GenerateSlabinfo(ProcText* text) {
+  text->Append("name active_objs objs_per_slab objsize slabs\n");
+  for (KmemCache* cache = KmemCache::Head(); cache; cache = cache->Next()) {
+    text->Append("%s %lu %lu %lu %lu\n", cache->Name(), cache->ActiveObjects(), cache->ObjectsPerSlab(),
+                 cache->ObjectSize(), cache->SlabNum());
+  }
+}
+
+void GeneratePidDir(ProcText* text, int pid) {
+  for (const auto& e : pid_entries) {
+    AppendDirElement(text, (pid << ENTRY_BITS) | e.entry, e.name);
+  }
+}
+
+void GenerateStatus(ProcText* text, int pid) {
+  TaskSnapshot s = TakeSnapshot(pid);
+  if (!s.found) {
+    return;
+  }
+  uint64_t vm_size = 0;
+  for (size_t i = 0; i < s.region_num; ++i) {
+    vm_size += s.regions[i].second - s.regions[i].first;
+  }
+  if (s.has_mm) {
+    vm_size += memory_layout::PGSIZE;
+    vm_size += __builtin_popcountl(s.stack_slots) * MemorySpace::THREAD_STACK_PAGES * memory_layout::PGSIZE;
+  }
+  for (int i = 0; i < s.shm_num; ++i) {
+    vm_size += s.shm[i].pages * memory_layout::PGSIZE;
+  }
+  text->Append("Name: %s\n", s.name[0] ? s.name : "-");
+  text->Append("Pid: %d\n", s.pid);
+  text->Append("PPid: %d\n", s.ppid);
+  text->Append("State: %s\n", StateName(s.state));
+  text->Append("Threads: %d\n", s.threads);
+  text->Append("Policy: %s\n", PolicyName(s.se.policy));
+  text->Append("Nice: %d\n", s.se.nice);
+  text->Append("RtPriority: %d\n", s.se.rt_priority);
+  text->Append("Fds: %d\n", s.fds);
+  text->Append("VmSize: %lu kB\n", vm_size / 1024);
+  text->Append("UserMs: %lu\n", MtimeToMs(s.usage.utime));
+  text->Append("SysMs: %lu\n", MtimeToMs(s.usage.stime));
+  text->Append("VoluntaryCtxtSwitches: %lu\n", s.usage.nvcsw);
+  text->Append("NonvoluntaryCtxtSwitches: %lu\n", s.usage.nivcsw);
+  text->Append("Faults: %lu\n", s.usage.nfault);
+  text->Append("InBlocks: %lu\n", s.usage.inblock);
+  text->Append("OutBlocks: %lu\n", s.usage.oublock);
+}
+
+void GenerateMaps(ProcText* text, int pid) {
+  TaskSnapshot s = TakeSnapshot(pid);
+  if (!s.found || !s.has_mm) {
+    return;
+  }
+  std::sort(s.regions, s.regions + s.region_num);
+  for (size_t i = 0; i < s.region_num; ++i) {
+    text->Append("%016lx-%016lx\n", s.regions[i].first, s.regions[i].second);
+  }
+  // mappings of the shared window lie between the heap and the thread stacks
+  std::sort(s.shm, s.shm + s.shm_num, [](const auto& a, const auto& b) { return a.va < b.va; });
+  for (int i = 0; i < s.shm_num; ++i) {
+    uint64_t end = s.shm[i].va + s.shm[i].pages * memory_layout::PGSIZE;
+    text->Append("%016lx-%016lx [shm:%s]\n", s.shm[i].va, end, s.shm[i].name[0] ? s.shm[i].name : "anon");
+  }
+  for (int slot = MemorySpace::MAX_STACK_SLOT - 1; slot >= 0; --slot) {
+    if (s.stack_slots & (1uL << slot)) {
+      uint64_t top = MemorySpace::StackSlotTop(slot);
+      text->Append("%016lx-%016lx [stack:%d]\n", top - MemorySpace::THREAD_STACK_PAGES * memory_layout::PGSIZE, top, slot);
+    }
+  }
+  uint64_t sp = VirtualMemory::GetUserSpVa();
+  text->Append("%016lx-%016lx [stack]\n", sp - memory_layout::PGSIZE, sp);
+  text->Append("%016lx-%016lx [clock]\n", time_def::CLOCK_PAGE_VA, time_def::CLOCK_PAGE_VA + memory_layout::PGSIZE);
+}
+
+void Generate(uint32_t node, ProcText* text) {
+  int pid = node >> ENTRY_BITS;
+  switch (node & ENTRY_MASK) {
+  case root:
+    GenerateRoot(text);
+    break;
+  case meminfo:
+    GenerateMeminfo(text);
+    break;
+  case vmstat:
+    GenerateVmstat(text);
+    break;
+  case diskstats:
+    GenerateDiskstats(text);
+    break;
+  case interrupts:
+    GenerateInterrupts(text);
+    break;
+  case lockstat:
+    GenerateLockstat(text);
+    break;
+  case slabinfo:
+    GenerateSlabinfo(text);
+    break;
+  case pid_dir:
+    GeneratePidDir(text, pid);
+    break;
+  case pid_status:
+    GenerateStatus(text, pid);
+    break;
+  case pid_maps:
+    GenerateMaps(text, pid);
+    break;
+  default:
+    break;
+  }
+}
+
+bool ParsePid(const char* name, int* pid) {
+  if (strcmp(name, "self") == 0) {
+    *pid = Schedueler::Instance()->ThisProcess()->Leader()->pid;
+    return true;
+  }
+  int v = 0;
+  for (const char* p = name; *p; ++p) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    v = v * 10 + (*p - '0');
+  }
+  *pid = v;
+  return *name && IsProcess(v);
+}
+
+}  // namespace
+
+bool ProcFs::Covers(const char* path) {
+  char paths[16][fs::MAX_FILE_NAME_LEN] = {0};
+  int level = fs::ParsePath(path, paths);
+  return level > 0 && strcmp(paths[0], "proc") == 0;
+}
+
+bool ProcFs::Open(const char* path, fs::FileDescriptor* fd) {
+  char paths[16][fs::MAX_FILE_NAME_LEN] = {0};
+  int level = fs::ParsePath(path, paths);
+  if (level <= 0 || level > 3 || strcmp(paths[0], "proc") != 0) {
+    return false;
+  }
+  uint32_t node = root;
+  if (level >= 2) {
+    const auto* it = std::find_if(std::begin(root_entries), std::end(root_entries), [&paths](const EntryName& e) {
+      return strcmp(e.name, paths[1]) == 0;
+    });
+    int pid = 0;
+    if (it != std::end(root_entries) && level == 2) {
+      node = it->entry;
+    } else if (ParsePid(paths[1], &pid)) {
+      node = (pid << ENTRY_BITS) | pid_dir;
+      if (level == 3) {
+        const auto* sub = std::find_if(std::begin(pid_entries), std::end(pid_entries), [&paths](const EntryName& e) {
+          return strcmp(e.name, paths[2]) == 0;
+        });
+        if (sub == std::end(pid_entries)) {
+          return false;
+        }
+        node = (pid << ENTRY_BITS) | sub->entry;
+      }
+    } else {
+      return false;
+    }
+  }
+  uint32_t entry = node & ENTRY_MASK;
+  *fd = fs::FileDescriptor{};
+  fd->file_type = fs::FileType::proc;
+  fd->inode_index = node;
+  // what fstat reports
+  fd->inode.type = (entry == root || entry == pid_dir) ? fs::FileType::directory : fs::FileType::regular_file;
+  fd->inode.link_count = 1;
+  return true;
+}
+
+int64_t ProcFs::Read(const fs::FileDescriptor* fd, uint64_t dst, size_t size, uint64_t* offset) {
+  auto* page = reinterpret_cast<char*>(VirtualMemory::Instance()->Alloc());
+  if (!page) {
+    return -1;
+  }
+  ProcText text(page, memory_layout::PGSIZE);
+  Generate(fd->inode_index, &text);
+  size_t len = 0;
+  if (*offset < text.Size()) {
+    len = std::min<size_t>(size, text.Size() - *offset);
+  }
+  bool ok = !len || copy_to_user(dst, page + *offset, len);
+  VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(page));
+  if (!ok) {
+    return -1;
+  }
+  *offset += len;
+  return len;
+}
+
+}  // namespace kernel
@@ -0,0 +1,32 @@
+#ifndef KERNEL_PROCFS_H
+#define KERNEL_PROCFS_H
+
+#include "filesystem/file_descriptor.h"
+#include "lib/singleton.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Read-only files describing the running kernel, found under /proc:
+// meminfo, vmstat, diskstats, interrupts, lockstat, slabinfo and
+// <pid>/status, <pid>/maps for every process, self names the caller.
+// Nothing is stored, the content of a file is generated on every read.
+class ProcFs : public lib::Singleton<ProcFs> {
+ public:
+  friend class lib::Singleton<ProcFs>;
+
+  // whether path is /proc or lies below it
+  bool Covers(const char* path);
+  // false if there is no such file
+  bool Open(const char* path, fs::FileDescriptor* fd);
+  // copy up to size bytes from *offset on to the user buffer dst and
+  // advance it, directories read as fs::DirElement records like on disk
+  int64_t Read(const fs::FileDescriptor* fd, uint64_t dst, size_t size, uint64_t* offset);
+
+ private:
+  ProcFs() {}
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_PROCFS_H
@@ -0,0 +1,159 @@
+#include "kernel/profiler.h"
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/process.h"
+#include "kernel/scheduler.h"
+#include "kernel/uaccess.h"
+#include "kernel/utils.h"
+
+namespace kernel {
+
+// the caller's s0 and ra are saved right below the frame pointer
+static constexpr uint64_t FRAME_RECORD_SIZE = 2 * sizeof(uint64_t);
+
+void Profiler::Tick(void* arg) {
+  *reinterpret_cast<bool*>(arg) = true;
+}
+
+bool Profiler::Start(uint64_t period) {
+  if (period == 0) {
+    return false;
+  }
+  Stop();
+  CriticalGuard guard(&lk_);
+  period_ = period;
+  running_ = true;
+  // a new profile starts from empty rings
+  for (auto& ring : rings_) {
+    ring.Clear();
+  }
+  for (size_t i = 0; i < system_param::CPU_NUM; ++i) {
+    timers_[i].deadline = TimerManager::Now() + period;
+    timers_[i].fn = Tick;
+    timers_[i].arg = &due_[i];
+    TimerManager::Instance()->Add(&timers_[i]);
+  }
+  return true;
+}
+
+void Profiler::Stop() {
+  CriticalGuard guard(&lk_);
+  running_ = false;
+  for (size_t i = 0; i < system_param::CPU_NUM; ++i) {
+    TimerManager::Instance()->Cancel(&timers_[i]);
+    due_[i] = false;
+  }
+}
+
+bool Profiler::TakeDue() {
+  bool due = due_[cpu_id()];
+  due_[cpu_id()] = false;
+  return due;
+}
+
+void Profiler::Rearm() {
+  CriticalGuard guard(&lk_);
+  if (!running_) {
+    return;
+  }
+  // keep the period steady, unless ticks were missed altogether
+  Timer* timer = &timers_[cpu_id()];
+  uint64_t now = TimerManager::Now();
+  timer->deadline += period_;
+  if (timer->deadline <= now) {
+    timer->deadline = now + period_;
+  }
+  TimerManager::Instance()->Add(timer);
+}
+
+void Profiler::SampleUser(ProcessTask* task) {
+  if (!TakeDue()) {
+    return;
+  }
+  rings_[cpu_id()].Push([task](prof_def::sample* sample) {
+    sample->timestamp = TimerManager::Now();
+    sample->pid = task->Leader()->pid;
+    sample->hart = cpu_id();
+    sample->mode = prof_def::user;
+    sample->pc[0] = task->frame->mepc;
+    int depth = 1;
+    UserTranslator translator(task->mm->page_table);
+    uint64_t fp = task->frame->s0;
+    while (depth < prof_def::MAX_DEPTH && fp >= FRAME_RECORD_SIZE && fp % sizeof(uint64_t) == 0) {
+      // the record is only 8 byte aligned, its two words may lie on different pages
+      uint64_t next_pa = translator.Translate(fp - FRAME_RECORD_SIZE, riscv::PTE::R);
+      uint64_t ra_pa = translator.Translate(fp - sizeof(uint64_t), riscv::PTE::R);
+      if (!next_pa || !ra_pa) {
+        break;
+      }
+      uint64_t ra = *reinterpret_cast<const uint64_t*>(ra_pa);
+      uint64_t next = *reinterpret_cast<const uint64_t*>(next_pa);
+      if (ra == 0) {
+        break;
+      }
+      sample->pc[depth++] = ra;
+      // stacks grow down, a caller frame always sits higher
+      if (next <= fp) {
+        break;
+      }
+      fp = next;
+    }
+    sample->depth = depth;
+  });
+  Rearm();
+}
+
+void Profiler::SampleKernel(uint64_t pc, const uint64_t* frame) {
+  if (!TakeDue()) {
+    return;
+  }
+  ProcessTask* task = Schedueler::Instance()->ThisProcess();
+  rings_[cpu_id()].Push([task, pc, frame](prof_def::sample* sample) {
+    sample->timestamp = TimerManager::Now();
+    sample->pid = task ? task->Leader()->pid : 0;
+    sample->hart = cpu_id();
+    sample->mode = task ? prof_def::kernel : prof_def::idle;
+    sample->pc[0] = pc;
+    int depth = 1;
+    // the trap entry code keeps s0, so the handler saved the interrupted
+    // frame pointer, walk no further than the stack page of the handler
+    uint64_t stack_top = (reinterpret_cast<uint64_t>(frame) & ~(memory_layout::PGSIZE - 1)) + memory_layout::PGSIZE;
+    uint64_t fp = frame[-2];
+    while (depth < prof_def::MAX_DEPTH && fp > reinterpret_cast<uint64_t>(frame) && fp <= stack_top &&
+           fp % sizeof(uint64_t) == 0) {
+      const uint64_t* record = reinterpret_cast<const uint64_t*>(fp - FRAME_RECORD_SIZE);
+      uint64_t ra = record[1];
+      uint64_t next = record[0];
+      if (ra == 0) {
+        break;
+      }
+      sample->pc[depth++] = ra;
+      if (next <= fp) {
+        break;
+      }
+      fp = next;
+    }
+    sample->depth = depth;
+  });
+  Rearm();
+}
+
+uint64_t Profiler::Dropped() const {
+  uint64_t dropped = 0;
+  for (const auto& ring : rings_) {
+    dropped += ring.Dropped();
+  }
+  return dropped;
+}
+
+size_t Profiler::Read(prof_def::sample* out, size_t max_num) {
+  CriticalGuard guard(&lk_);
+  size_t num = 0;
+  for (auto& ring : rings_) {
+    num += ring.Pop(out + num, max_num - num);
+  }
+  return num;
+}
+
+}  // namespace kernel
@@ -0,0 +1,56 @@
+#ifndef KERNEL_PROFILER_H
+#define KERNEL_PROFILER_H
+
+#include "kernel/config/system_param.h"
+#include "kernel/lock/spin_lock.h"
+#include "kernel/per_hart_ring.h"
+#include "kernel/sys_def/prof_def.h"
+#include "kernel/timer.h"
+#include "lib/singleton.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+struct ProcessTask;
+
+// Samples where each hart is running at a fixed period. A timer only marks
+// the hart as due, the sample is taken on the way out of the timer
+// interrupt where the interrupted pc and frame pointer chain are at hand.
+// Call chains are followed through s0, so they need code built with
+// frame pointers.
+class Profiler : public lib::Singleton<Profiler> {
+ public:
+  friend class lib::Singleton<Profiler>;
+  static constexpr size_t RING_SIZE = 512;
+
+  // period in mtime units, drops samples not read yet
+  bool Start(uint64_t period);
+  void Stop();
+  // interrupted user code of task, called from the user timer interrupt
+  void SampleUser(ProcessTask* task);
+  // interrupted kernel code, frame is the frame pointer of the trap handler
+  void SampleKernel(uint64_t pc, const uint64_t* frame);
+  uint64_t Dropped() const;
+  // move up to max_num samples, returns how many
+  size_t Read(prof_def::sample* out, size_t max_num);
+
+ private:
+  Profiler() {}
+
+  static void Tick(void* arg);
+  // consume the pending tick of this hart
+  bool TakeDue();
+  void Rearm();
+
+  bool running_ = false;
+  uint64_t period_ = 0;
+  Timer timers_[system_param::CPU_NUM];
+  bool due_[system_param::CPU_NUM] = {false};
+  PerHartRing<prof_def::sample, RING_SIZE> rings_[system_param::CPU_NUM];
+  // serializes Start, Stop and readers
+  SpinLock lk_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_PROFILER_H
@@ -0,0 +1,280 @@
+#include "kernel/sched_class.h"
+
+#include "kernel/config/system_param.h"
+#include "kernel/slab.h"
+#include "kernel/timer.h"
+#include "kernel/utils.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+// period in which every runnable normal task should get to run once
+static constexpr uint64_t SCHED_LATENCY = system_param::MTIME_FREQ / 50;
+// shortest slice, keeps switching overhead bounded with many tasks
+static constexpr uint64_t MIN_GRANULARITY = system_param::MTIME_FREQ / 250;
+// lead in virtual runtime a woken task needs to preempt the running one
+static constexpr uint64_t WAKEUP_GRANULARITY = system_param::MTIME_FREQ / 250;
+static constexpr uint64_t RR_SLICE = system_param::TIMER_INTERVAL;
+
+static constexpr uint64_t NICE_0_WEIGHT = 1024;
+// each nice level is worth about 10% of cpu time
+static constexpr uint64_t nice_to_weight[40] = {
+  /* -20 */ 88761, 71755, 56483, 46273, 36291,
+  /* -15 */ 29154, 23254, 18705, 14949, 11916,
+  /* -10 */ 9548, 7620, 6100, 4904, 3906,
+  /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+  /*   0 */ 1024, 820, 655, 526, 423,
+  /*   5 */ 335, 272, 215, 172, 137,
+  /*  10 */ 110, 87, 70, 56, 45,
+  /*  15 */ 36, 29, 23, 18, 15,
+};
+
+static uint64_t Weight(const ProcessTask* task) {
+  return nice_to_weight[task->se.nice - sched_def::NICE_MIN];
+}
+
+// vruntime including the time curr has spent on the cpu since it was picked
+static uint64_t CurrentVruntime(const ProcessTask* task) {
+  uint64_t vruntime = task->se.vruntime;
+  if (task->state == ProcessState::running) {
+    vruntime += (TimerManager::Now() - task->se.exec_start) * NICE_0_WEIGHT / Weight(task);
+  }
+  return vruntime;
+}
+
+bool FairSchedClass::Grow() {
+  int capacity = capacity_ ? capacity_ * 2 : 64;
+  auto** heap = reinterpret_cast<ProcessTask**>(kmalloc(capacity * sizeof(ProcessTask*)));
+  if (!heap) {
+    return false;
+  }
+  if (heap_) {
+    memcpy(heap, heap_, size_ * sizeof(ProcessTask*));
+    kfree(heap_);
+  }
+  heap_ = heap;
+  capacity_ = capacity;
+  return true;
+}
+
+void FairSchedClass::Swap(int i, int j) {
+  ProcessTask* t = heap_[i];
+  heap_[i] = heap_[j];
+  heap_[j] = t;
+  heap_[i]->se.heap_index = i;
+  heap_[j]->se.heap_index = j;
+}
+
+void FairSchedClass::SiftUp(int index) {
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (heap_[parent]->se.vruntime <= heap_[index]->se.vruntime) {
+      break;
+    }
+    Swap(parent, index);
+    index = parent;
+  }
+}
+
+void FairSchedClass::SiftDown(int index) {
+  while (true) {
+    int smallest = index;
+    int left = index * 2 + 1;
+    int right = left + 1;
+    if (left < size_ && heap_[left]->se.vruntime < heap_[smallest]->se.vruntime) {
+      smallest = left;
+    }
+    if (right < size_ && heap_[right]->se.vruntime < heap_[smallest]->se.vruntime) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      return;
+    }
+    Swap(smallest, index);
+    index = smallest;
+  }
+}
+
+void FairSchedClass::Insert(ProcessTask* task) {
+  // every allocated task has reserved its slot
+  if (size_ == capacity_) {
+    panic("fair run queue overflow");
+  }
+  heap_[size_] = task;
+  task->se.heap_index = size_;
+  size_ += 1;
+  SiftUp(task->se.heap_index);
+}
+
+void FairSchedClass::Remove(int index) {
+  ProcessTask* task = heap_[index];
+  size_ -= 1;
+  if (index != size_) {
+    heap_[index] = heap_[size_];
+    heap_[index]->se.heap_index = index;
+    SiftDown(index);
+    SiftUp(index);
+  }
+  task->se.heap_index = -1;
+}
+
+bool FairSchedClass::Reserve() {
+  if (reserved_ == capacity_ && !Grow()) {
+    return false;
+  }
+  reserved_ += 1;
+  return true;
+}
+
+void FairSchedClass::Unreserve() {
+  reserved_ -= 1;
+}
+
+ProcessTask* FairSchedClass::PickNext() {
+  if (size_ == 0) {
+    return nullptr;
+  }
+  ProcessTask* next = heap_[0];
+  Remove(0);
+  next->se.on_cpu = true;
+  if (next->se.vruntime > min_vruntime_) {
+    min_vruntime_ = next->se.vruntime;
+  }
+  return next;
+}
+
+void FairSchedClass::PutPrev(ProcessTask* task, uint64_t delta) {
+  task->se.vruntime += delta * NICE_0_WEIGHT / Weight(task);
+  task->se.on_cpu = false;
+  if (task->state == ProcessState::runnable) {
+    Insert(task);
+    return;
+  }
+  load_ -= Weight(task);
+  task->se.on_rq = false;
+}
+
+void FairSchedClass::Enqueue(ProcessTask* task, bool wakeup) {
+  // a sleeper gets half a latency of credit so interactive tasks run soon after
+  // waking, but cannot bank the whole time it slept
+  uint64_t floor = min_vruntime_;
+  if (wakeup) {
+    floor = floor > SCHED_LATENCY / 2 ? floor - SCHED_LATENCY / 2 : 0;
+  }
+  if (task->se.vruntime < floor) {
+    task->se.vruntime = floor;
+  }
+  task->se.on_rq = true;
+  load_ += Weight(task);
+  if (!task->se.on_cpu) {
+    Insert(task);
+  }
+}
+
+void FairSchedClass::Dequeue(ProcessTask* task) {
+  if (task->se.heap_index >= 0) {
+    Remove(task->se.heap_index);
+  }
+  load_ -= Weight(task);
+  task->se.on_rq = false;
+}
+
+uint64_t FairSchedClass::Slice(const ProcessTask* task) {
+  if (load_ == 0) {
+    return SCHED_LATENCY;
+  }
+  uint64_t slice = SCHED_LATENCY * Weight(task) / load_;
+  return slice < MIN_GRANULARITY ? MIN_GRANULARITY : slice;
+}
+
+bool FairSchedClass::ShouldPreempt(const ProcessTask* curr, const ProcessTask* woken) {
+  return CurrentVruntime(curr) > woken->se.vruntime + WAKEUP_GRANULARITY;
+}
+
+void RtSchedClass::PushBack(ProcessTask* task) {
+  int prio = task->se.rt_priority;
+  task->se.rt_prev = tail_[prio];
+  task->se.rt_next = nullptr;
+  if (tail_[prio]) {
+    tail_[prio]->se.rt_next = task;
+  } else {
+    head_[prio] = task;
+  }
+  tail_[prio] = task;
+  bitmap_[prio / 64] |= 1uL << (prio % 64);
+}
+
+void RtSchedClass::Unlink(ProcessTask* task) {
+  int prio = task->se.rt_priority;
+  if (task->se.rt_prev) {
+    task->se.rt_prev->se.rt_next = task->se.rt_next;
+  } else {
+    head_[prio] = task->se.rt_next;
+  }
+  if (task->se.rt_next) {
+    task->se.rt_next->se.rt_prev = task->se.rt_prev;
+  } else {
+    tail_[prio] = task->se.rt_prev;
+  }
+  task->se.rt_prev = nullptr;
+  task->se.rt_next = nullptr;
+  if (!head_[prio]) {
+    bitmap_[prio / 64] &= ~(1uL << (prio % 64));
+  }
+}
+
+ProcessTask* RtSchedClass::PickNext() {
+  for (int i = BITMAP_WORDS - 1; i >= 0; --i) {
+    if (!bitmap_[i]) {
+      continue;
+    }
+    // among equal priorities the one which has waited longest goes first
+    ProcessTask* next = head_[i * 64 + 63 - __builtin_clzl(bitmap_[i])];
+    Unlink(next);
+    next->se.on_cpu = true;
+    return next;
+  }
+  return nullptr;
+}
+
+void RtSchedClass::PutPrev(ProcessTask* task, uint64_t) {
+  task->se.on_cpu = false;
+  if (task->state == ProcessState::runnable) {
+    PushBack(task);
+    return;
+  }
+  task->se.on_rq = false;
+}
+
+void RtSchedClass::Enqueue(ProcessTask* task, bool) {
+  task->se.on_rq = true;
+  if (!task->se.on_cpu) {
+    PushBack(task);
+  }
+}
+
+void RtSchedClass::Dequeue(ProcessTask* task) {
+  if (!task->se.on_cpu) {
+    Unlink(task);
+  }
+  task->se.on_rq = false;
+}
+
+bool RtSchedClass::Empty() const {
+  for (uint64_t word : bitmap_) {
+    if (word) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t RtSchedClass::Slice(const ProcessTask* task) {
+  return task->se.policy == sched_def::rr ? RR_SLICE : 0;
+}
+
+bool RtSchedClass::ShouldPreempt(const ProcessTask* curr, const ProcessTask* woken) {
+  return woken->se.rt_priority > curr->se.rt_priority;
+}
+
+}  // namespace kernel
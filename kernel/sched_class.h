@@ -0,0 +1,94 @@
+#ifndef KERNEL_SCHED_CLASS_H
+#define KERNEL_SCHED_CLASS_H
+
+#include "kernel/process.h"
+#include "kernel/sys_def/sched_def.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// A scheduling policy with its own run queue of the runnable tasks of its
+// policies. Classes are asked for a task in rank order, so any runnable
+// real time task goes before a normal one. The scheduler serializes every
+// call with its run queue lock.
+class SchedClass {
+ public:
+  // take the task to run next off the queue, nullptr if none is runnable
+  virtual ProcessTask* PickNext() = 0;
+  // task leaves the cpu after running for delta mtime, it is queued again if still runnable
+  virtual void PutPrev(ProcessTask* task, uint64_t delta) = 0;
+  // task becomes runnable in this class: created, woken or moved in from
+  // another class, it is queued unless it is on a cpu
+  virtual void Enqueue(ProcessTask* task, bool wakeup) = 0;
+  // task stops counting in this class, e.g. before its policy changes
+  virtual void Dequeue(ProcessTask* task) = 0;
+  virtual bool Empty() const = 0;
+  // mtime task may run before it is preempted, 0 for no limit
+  virtual uint64_t Slice(const ProcessTask* task) = 0;
+  // whether woken should take the cpu from curr, both are of this class
+  virtual bool ShouldPreempt(const ProcessTask* curr, const ProcessTask* woken) = 0;
+};
+
+// Virtual runtime based fair share for the normal policy. Waiting tasks are
+// kept in a min-heap of vruntime which only grows when a task is allocated,
+// so queueing a task never allocates.
+class FairSchedClass : public SchedClass {
+ public:
+  ProcessTask* PickNext() override;
+  void PutPrev(ProcessTask* task, uint64_t delta) override;
+  void Enqueue(ProcessTask* task, bool wakeup) override;
+  void Dequeue(ProcessTask* task) override;
+  bool Empty() const override {
+    return size_ == 0;
+  }
+  uint64_t Slice(const ProcessTask* task) override;
+  bool ShouldPreempt(const ProcessTask* curr, const ProcessTask* woken) override;
+  // make room in the heap for one more task, once for every allocated task
+  bool Reserve();
+  void Unreserve();
+
+ private:
+  bool Grow();
+  void Swap(int i, int j);
+  void SiftUp(int index);
+  void SiftDown(int index);
+  void Insert(ProcessTask* task);
+  void Remove(int index);
+
+  ProcessTask** heap_ = nullptr;
+  int size_ = 0;
+  int capacity_ = 0;
+  int reserved_ = 0;
+  // weight of every task counted by the class, the queued ones and those on a cpu
+  uint64_t load_ = 0;
+  // only moves forward, newcomers are placed relative to it
+  uint64_t min_vruntime_ = 0;
+};
+
+// Fixed priorities for the fifo and rr policies, a list per priority and a
+// bitmap of the non-empty ones.
+class RtSchedClass : public SchedClass {
+ public:
+  ProcessTask* PickNext() override;
+  void PutPrev(ProcessTask* task, uint64_t delta) override;
+  void Enqueue(ProcessTask* task, bool wakeup) override;
+  void Dequeue(ProcessTask* task) override;
+  bool Empty() const override;
+  uint64_t Slice(const ProcessTask* task) override;
+  bool ShouldPreempt(const ProcessTask* curr, const ProcessTask* woken) override;
+
+ private:
+  static constexpr int LEVELS = sched_def::RT_PRIORITY_MAX + 1;
+  static constexpr int BITMAP_WORDS = (LEVELS + 63) / 64;
+
+  void PushBack(ProcessTask* task);
+  void Unlink(ProcessTask* task);
+
+  ProcessTask* head_[LEVELS] = {nullptr};
+  ProcessTask* tail_[LEVELS] = {nullptr};
+  uint64_t bitmap_[BITMAP_WORDS] = {0};
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_SCHED_CLASS_H
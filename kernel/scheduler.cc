@@ -5,15 +5,20 @@
 #include "arch/riscv_reg.h"
 #include "kernel/config/memory_layout.h"
 #include "kernel/config/system_param.h"
-#include "kernel/global_channel.h"
+#include "kernel/file_table.h"
 #include "kernel/lock/critical_guard.h"
 #include "kernel/utils.h"
 #include "kernel/printf.h"
+#include "kernel/sys_def/sched_def.h"
+#include "kernel/timer.h"
+#include "kernel/trace.h"
 #include "kernel/virtual_memory.h"
+#include "lib/common.h"
 
 extern "C" void Switch(kernel::SavedContext* c1, kernel::SavedContext* c2);
 
-uint64_t time_scratch[2];
+// address of mtimecmp, the timer vector silences it until ClockInterrupt reprograms it
+uint64_t time_scratch[1];
 
 namespace kernel {
 
@@ -30,104 +35,591 @@ void Schedueler::Yield() {
 
 void Schedueler::Exit(int code) {
   auto* process = ThisProcess();
+  if (process->group_leader) {
+    KillGroup(process->group_leader, code);
+    ExitThread(code);
+  }
+  // the first exit code of the group wins
+  KillGroup(process, code);
+  code = process->exit_code;
+  ReapThreads(process);
+  // close the files now and not when reaped, readers of a pipe wait for the end of the writer
+  if (process->files) {
+    FileTable::Put(process->files);
+    process->files = nullptr;
+  }
+  auto* init_process = GetInitProcess();
+  if (!init_process) {
+    kernel::panic("Cannot find init process");
+  }
+  // kernel threads have nobody waiting for them
+  if (!process->parent_process) {
+    SetParent(process, init_process);
+  }
   CriticalGuard guard(&process->lock);
   process->exit_code = code;
   process->state = ProcessState::zombie;
-  for (auto& task : process_tasks_) {
-    if (task.parent_process == process) {
-      auto* init_process = GetInitProcess();
-      if (!init_process) {
-        kernel::panic("Cannot find init process");
-      }
-      task.parent_process = init_process;
+  if (process->children) {
+    while (process->children) {
+      SetParent(process->children, init_process);
     }
+    Wakeup(&init_process->owned_channel);
   }
   Wakeup(&process->parent_process->owned_channel);
   Switch(&process->saved_context,
          &ThisCpu()->saved_context);
 }
 
-void Schedueler::SetInitProcess(const ProcessTask* process) {
+void Schedueler::ExitThread(int code) {
+  auto* thread = ThisProcess();
+  CriticalGuard guard(&thread->lock);
+  thread->exit_code = code;
+  thread->state = ProcessState::zombie;
+  // joiners sleep on the thread, an exiting leader on itself
+  Wakeup(&thread->owned_channel);
+  Wakeup(&thread->Leader()->owned_channel);
+  Switch(&thread->saved_context,
+         &ThisCpu()->saved_context);
+}
+
+int Schedueler::Join(int tid, int* exit_code) {
+  auto* self = ThisProcess();
+  while (true) {
+    if (self->killed) {
+      return -1;
+    }
+    // looked up again on every wakeup, the target may have been reaped meanwhile
+    ProcessTask* target = FindProc(tid);
+    if (!target || target == self || !target->group_leader || target->group_leader != self->Leader()) {
+      return -1;
+    }
+    if (target->state == ProcessState::zombie) {
+      {
+        CriticalGuard guard(&target->lock);
+        *exit_code = target->exit_code;
+        self->Leader()->usage.Add(target->usage);
+        ProcessManager::ResetProcess(target);
+      }
+      FreeProc(target);
+      return tid;
+    }
+    Sleep(&target->owned_channel);
+  }
+}
+
+void Schedueler::KillGroup(ProcessTask* leader, int code) {
+  CriticalGuard guard(&table_lock_);
+  if (!leader->killed) {
+    leader->killed = true;
+    leader->exit_code = code;
+  }
+  for (ProcessTask* task = task_head_; task; task = task->task_next) {
+    if (task != leader && task->group_leader != leader) {
+      continue;
+    }
+    {
+      CriticalGuard task_guard(&task->lock);
+      task->killed = true;
+    }
+    // sleepers notice killed once their wait loop runs again
+    WakeTask(task);
+  }
+}
+
+void Schedueler::ReapThreads(ProcessTask* leader) {
+  while (true) {
+    bool has_thread = false;
+    ProcessTask* zombie = nullptr;
+    {
+      CriticalGuard guard(&table_lock_);
+      for (ProcessTask* task = task_head_; task; task = task->task_next) {
+        if (task->group_leader != leader) {
+          continue;
+        }
+        has_thread = true;
+        if (task->state == ProcessState::zombie) {
+          zombie = task;
+          break;
+        }
+      }
+    }
+    if (!has_thread) {
+      return;
+    }
+    if (!zombie) {
+      Sleep(&leader->owned_channel);
+      continue;
+    }
+    {
+      CriticalGuard guard(&zombie->lock);
+      leader->usage.Add(zombie->usage);
+      ProcessManager::ResetProcess(zombie);
+    }
+    FreeProc(zombie);
+  }
+}
+
+void Schedueler::SetInitProcess(ProcessTask* process) {
   init_process_ = process;
 }
-const ProcessTask* Schedueler::GetInitProcess() {
+ProcessTask* Schedueler::GetInitProcess() {
   return init_process_;
 }
 
 void Schedueler::InitTimer() {
   uint64_t hart_id = riscv::regs::mhartid.read();
-  uint64_t mtime_cmp = memory_layout::CLINT_MTIMECMP(hart_id);
-  uint64_t current_mtime = MEMORY_MAPPED_IO_R_DWORD(memory_layout::CLINT_MTIME);
-  MEMORY_MAPPED_IO_W_DWORD(mtime_cmp, current_mtime + system_param::TIMER_INTERVAL);
-  time_scratch[0] = mtime_cmp;
-  time_scratch[1] = system_param::TIMER_INTERVAL;
+  time_scratch[0] = memory_layout::CLINT_MTIMECMP(hart_id);
+  // no deadline yet, Dispatch arms the slice once there is something to run
+  TimerManager::Instance()->StopSlice();
   riscv::regs::mie.set_bit(riscv::MIE::MTIE);
 }
 
-void Schedueler::Sleep(const Channel* channel, SpinLock* lk) {
+void Schedueler::SleepImpl(const Channel* channel, void* lk, void (*unlock)(void*), void (*lock)(void*)) {
   CpuTask* current_cpu = &cpu_task_[riscv::regs::mhartid.read()];
-  if (!current_cpu->process_task ||
-      current_cpu->process_task->state != ProcessState::running) {
+  ProcessTask* task = current_cpu->process_task;
+  if (!task || task->state != ProcessState::running) {
     panic("process_task's state is not running when try to sleep");
   }
-
+  // queued before lk is released, so a waker holding lk always finds the task
   {
-    CriticalGuard guard(&current_cpu->process_task->lock);
+    WaitBucket& bucket = BucketOf(channel);
+    CriticalGuard guard(&bucket.lock);
+    task->channel = channel;
+    LinkWaiter(bucket, task);
+  }
+  {
+    CriticalGuard guard(&task->lock);
     if (lk) {
-      lk->UnLock();
+      unlock(lk);
+    }
+    // a wakeup since queueing has taken the task off the bucket already
+    if (task->channel) {
+      task->state = ProcessState::sleep;
+      task->usage.nvcsw += 1;
+      Tracer::Instance()->Record(trace_def::sleep, reinterpret_cast<uint64_t>(channel->data()));
+      Switch(&task->saved_context,
+             &current_cpu->saved_context);
     }
-    current_cpu->process_task->state = ProcessState::sleep;
-    current_cpu->process_task->channel = channel;
-    Switch(&current_cpu->process_task->saved_context,
-           &current_cpu->saved_context);
     if (lk) {
-      lk->Lock();
+      lock(lk);
     }
   }
 }
 
-void Schedueler::Wakeup(const Channel* channel) {
-  for (auto& task : process_tasks_) {
-    CriticalGuard guard(&task.lock);
-    if (task.state == ProcessState::sleep && (*task.channel) == (*channel)) {
-      task.state = ProcessState::runnable;
-      task.channel = nullptr;
+int Schedueler::Wakeup(const Channel* channel, int max_num) {
+  WaitBucket& bucket = BucketOf(channel);
+  CriticalGuard guard(&bucket.lock);
+  int num = 0;
+  ProcessTask* next = nullptr;
+  for (ProcessTask* task = bucket.head; task && num != max_num; task = next) {
+    next = task->wait_next;
+    // other channels may share the bucket
+    if ((*task->channel) == (*channel)) {
+      CriticalGuard task_guard(&task->lock);
+      WakeWaiter(bucket, task);
+      num += 1;
     }
   }
+  return num;
+}
+
+Schedueler::WaitBucket& Schedueler::BucketOf(const Channel* channel) {
+  auto key = reinterpret_cast<uint64_t>(channel->data());
+  return wait_hash_[(key ^ (key >> 12)) / sizeof(uint64_t) % WAIT_HASH_SIZE];
 }
 
-std::tuple<bool, ProcessTask*> Schedueler::FindFirslZombieChild(const ProcessTask* parent){
+void Schedueler::LinkWaiter(WaitBucket& bucket, ProcessTask* task) {
+  task->wait_prev = nullptr;
+  task->wait_next = bucket.head;
+  if (bucket.head) {
+    bucket.head->wait_prev = task;
+  }
+  bucket.head = task;
+}
+
+void Schedueler::UnlinkWaiter(WaitBucket& bucket, ProcessTask* task) {
+  if (task->wait_prev) {
+    task->wait_prev->wait_next = task->wait_next;
+  } else {
+    bucket.head = task->wait_next;
+  }
+  if (task->wait_next) {
+    task->wait_next->wait_prev = task->wait_prev;
+  }
+  task->wait_prev = nullptr;
+  task->wait_next = nullptr;
+}
+
+void Schedueler::WakeWaiter(WaitBucket& bucket, ProcessTask* task) {
+  UnlinkWaiter(bucket, task);
+  if (task->state == ProcessState::sleep) {
+    MakeRunnable(task);
+  } else {
+    task->channel = nullptr;
+  }
+}
+
+void Schedueler::WakeTask(ProcessTask* task) {
+  // the channel may change until its bucket is locked, it is checked again then
+  while (const Channel* channel = __atomic_load_n(&task->channel, __ATOMIC_ACQUIRE)) {
+    WaitBucket& bucket = BucketOf(channel);
+    CriticalGuard guard(&bucket.lock);
+    CriticalGuard task_guard(&task->lock);
+    if (task->channel == channel) {
+      WakeWaiter(bucket, task);
+      return;
+    }
+  }
+}
+
+void Schedueler::MakeRunnable(ProcessTask* task) {
+  Tracer::Instance()->Record(trace_def::wakeup, task->pid, task->channel ? reinterpret_cast<uint64_t>(task->channel->data()) : 0);
+  task->state = ProcessState::runnable;
+  task->channel = nullptr;
+  {
+    CriticalGuard guard(&rq_lock_);
+    ClassOf(task)->Enqueue(task, true);
+  }
+  CheckPreempt(task);
+}
+
+void Schedueler::CheckPreempt(ProcessTask* woken) {
+  CpuTask* cpu = ThisCpu();
+  ProcessTask* curr = cpu->process_task;
+  if (!curr || curr == woken || cpu->need_resched) {
+    return;
+  }
+  SchedClass* curr_class = ClassOf(curr);
+  SchedClass* woken_class = ClassOf(woken);
+  if (curr_class == woken_class) {
+    cpu->need_resched = curr_class->ShouldPreempt(curr, woken);
+  } else {
+    cpu->need_resched = woken_class == &rt_class_;
+  }
+}
+
+SchedClass* Schedueler::ClassOf(const ProcessTask* task) {
+  if (task->se.policy == sched_def::normal) {
+    return &fair_class_;
+  }
+  return &rt_class_;
+}
+
+ProcessTask* Schedueler::PickNext(uint64_t* slice) {
+  CriticalGuard guard(&rq_lock_);
+  // real time tasks always go first
+  SchedClass* classes[] = {&rt_class_, &fair_class_};
+  for (SchedClass* sched_class : classes) {
+    ProcessTask* task = sched_class->PickNext();
+    if (task) {
+      *slice = sched_class->Slice(task);
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void Schedueler::WakeNewTask(ProcessTask* task, const ProcessTask* parent) {
+  CriticalGuard guard(&task->lock);
+  if (parent) {
+    task->se.policy = parent->se.policy;
+    task->se.nice = parent->se.nice;
+    task->se.rt_priority = parent->se.rt_priority;
+    task->se.vruntime = parent->se.vruntime;
+  }
+  task->state = ProcessState::runnable;
+  {
+    CriticalGuard guard(&rq_lock_);
+    ClassOf(task)->Enqueue(task, false);
+  }
+  CheckPreempt(task);
+}
+
+bool Schedueler::SetNice(ProcessTask* task, int nice) {
+  if (nice < sched_def::NICE_MIN || nice > sched_def::NICE_MAX) {
+    return false;
+  }
+  CriticalGuard guard(&task->lock);
+  {
+    // the weight of a queued task is part of the load of its class
+    CriticalGuard rq_guard(&rq_lock_);
+    bool on_rq = task->se.on_rq;
+    if (on_rq) {
+      ClassOf(task)->Dequeue(task);
+    }
+    task->se.nice = nice;
+    if (on_rq) {
+      ClassOf(task)->Enqueue(task, false);
+    }
+  }
+  // the new weight may change who should run now
+  ThisCpu()->need_resched = true;
+  return true;
+}
+
+bool Schedueler::SetPolicy(ProcessTask* task, int policy, int rt_priority) {
+  if (policy == sched_def::normal) {
+    if (rt_priority != 0) {
+      return false;
+    }
+  } else if (policy == sched_def::fifo || policy == sched_def::rr) {
+    if (rt_priority < sched_def::RT_PRIORITY_MIN || rt_priority > sched_def::RT_PRIORITY_MAX) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  CriticalGuard guard(&task->lock);
+  {
+    // a queued task moves to the queue of its new class or priority
+    CriticalGuard rq_guard(&rq_lock_);
+    bool on_rq = task->se.on_rq;
+    if (on_rq) {
+      ClassOf(task)->Dequeue(task);
+    }
+    task->se.policy = policy;
+    task->se.rt_priority = rt_priority;
+    if (on_rq) {
+      ClassOf(task)->Enqueue(task, false);
+    }
+  }
+  ThisCpu()->need_resched = true;
+  return true;
+}
+
+std::tuple<bool, ProcessTask*> Schedueler::FindFirslZombieChild(const ProcessTask* parent, int pid) {
   bool has_child = false;
-  for (auto& task : process_tasks_) {
-    if (task.parent_process == parent) {
-      has_child = true;
-      if (task.state == ProcessState::zombie) {
-        return {true, &task};
-      }
+  for (ProcessTask* task = parent->children; task; task = task->sibling) {
+    if (pid != -1 && task->pid != pid) {
+      continue;
+    }
+    has_child = true;
+    if (task->state == ProcessState::zombie) {
+      return {true, task};
     }
   }
   return {has_child, nullptr};
 }
 
+TaskUsage Schedueler::GroupUsage(ProcessTask* leader) {
+  TaskUsage usage;
+  CriticalGuard guard(&table_lock_);
+  for (ProcessTask* task = task_head_; task; task = task->task_next) {
+    if (task == leader || task->group_leader == leader) {
+      usage.Add(task->usage);
+    }
+  }
+  return usage;
+}
+
 void Schedueler::ClockInterrupt() {
-  ticks = ticks + 1;
-  Wakeup(GlobalChannel::sleep_channel());
+  if (TimerManager::Instance()->Interrupt()) {
+    ThisCpu()->need_resched = true;
+  }
+}
+
+void Schedueler::MaybePreempt() {
+  CpuTask* cpu = ThisCpu();
+  if (cpu->process_task && cpu->need_resched) {
+    cpu->process_task->usage.nivcsw += 1;
+    Yield();
+  }
+}
+
+uint64_t Schedueler::SystemTick() {
+  return TimerManager::Now() / system_param::TIMER_INTERVAL;
+}
+
+// taken by a sleeper from its deadline check until it sleeps, and by the waking timer
+static SpinLock timed_sleep_lock;
+
+static void WakeSleeper(void* arg) {
+  CriticalGuard guard(&timed_sleep_lock);
+  Schedueler::Instance()->Wakeup(reinterpret_cast<const Channel*>(arg));
+}
+
+bool Schedueler::SleepUntil(uint64_t deadline) {
+  auto* process = ThisProcess();
+  Timer timer;
+  Channel channel(&timer);
+  timer.deadline = deadline;
+  timer.fn = WakeSleeper;
+  timer.arg = &channel;
+  if (!TimerManager::Instance()->Add(&timer)) {
+    return false;
+  }
+  {
+    CriticalGuard guard(&timed_sleep_lock);
+    while (TimerManager::Now() < deadline && !process->killed) {
+      Sleep(&channel, &timed_sleep_lock);
+    }
+  }
+  TimerManager::Instance()->Cancel(&timer);
+  return TimerManager::Now() >= deadline;
+}
+
+ProcessTask* Schedueler::AllocTask() {
+  {
+    CriticalGuard guard(&rq_lock_);
+    if (!fair_class_.Reserve()) {
+      return nullptr;
+    }
+  }
+  ProcessTask* task = task_cache_.Alloc();
+  if (!task) {
+    CriticalGuard guard(&rq_lock_);
+    fair_class_.Unreserve();
+  }
+  return task;
+}
+
+void Schedueler::FreeTask(ProcessTask* task) {
+  task_cache_.Free(task);
+  CriticalGuard guard(&rq_lock_);
+  fair_class_.Unreserve();
 }
 
 ProcessTask* Schedueler::AllocProc() {
-  for (ProcessTask& task : process_tasks_) {
-    CriticalGuard guard(&task.lock);
-    if (task.state == ProcessState::unused) {
-      if (!task.Init()) {
-        return nullptr;
+  ProcessTask* task = AllocTask();
+  if (!task) {
+    return nullptr;
+  }
+  if (!task->Init()) {
+    FreeTask(task);
+    return nullptr;
+  }
+  InsertTask(task);
+  return task;
+}
+
+ProcessTask* Schedueler::AllocThread(ProcessTask* creator, uint64_t entry, uint64_t arg) {
+  ProcessTask* task = AllocTask();
+  if (!task) {
+    return nullptr;
+  }
+  if (!task->InitThread(creator, entry, arg)) {
+    FreeTask(task);
+    return nullptr;
+  }
+  InsertTask(task);
+  return task;
+}
+
+static void KernelThreadEntry() {
+  auto* task = Schedueler::Instance()->ThisProcess();
+  task->lock.UnLock();
+  global_interrunpt_on();
+  task->kthread_fn(task->kthread_arg);
+  Schedueler::Instance()->Exit(0);
+}
+
+ProcessTask* Schedueler::CreateKernelThread(const char* name, void (*fn)(void*), void* arg) {
+  ProcessTask* task = AllocTask();
+  if (!task) {
+    return nullptr;
+  }
+  task->kernel_sp = VirtualMemory::Instance()->Alloc();
+  if (!task->kernel_sp) {
+    FreeTask(task);
+    return nullptr;
+  }
+  task->name = name;
+  task->pid = ProcessManager::AllocPid();
+  task->kthread_fn = fn;
+  task->kthread_arg = arg;
+  task->saved_context.sp = reinterpret_cast<uint64_t>(task->kernel_sp) + memory_layout::PGSIZE;
+  task->saved_context.ra = reinterpret_cast<uint64_t>(KernelThreadEntry);
+  InsertTask(task);
+  WakeNewTask(task, nullptr);
+  return task;
+}
+
+void Schedueler::InsertTask(ProcessTask* task) {
+  task->state = ProcessState::used;
+  CriticalGuard guard(&table_lock_);
+  task->task_prev = task_tail_;
+  if (task_tail_) {
+    task_tail_->task_next = task;
+  } else {
+    task_head_ = task;
+  }
+  task_tail_ = task;
+  auto& bucket = pid_hash_[task->pid % PID_HASH_SIZE];
+  task->hash_next = bucket;
+  bucket = task;
+}
+
+void Schedueler::FreeProc(ProcessTask* process) {
+  {
+    CriticalGuard guard(&table_lock_);
+    RemoveChild(process);
+    if (process->task_prev) {
+      process->task_prev->task_next = process->task_next;
+    } else {
+      task_head_ = process->task_next;
+    }
+    if (process->task_next) {
+      process->task_next->task_prev = process->task_prev;
+    } else {
+      task_tail_ = process->task_prev;
+    }
+    for (ProcessTask** p = &pid_hash_[process->pid % PID_HASH_SIZE]; *p; p = &(*p)->hash_next) {
+      if (*p == process) {
+        *p = process->hash_next;
+        break;
       }
-      task.state = ProcessState::used;
-      return &task;
+    }
+  }
+  FreeTask(process);
+}
+
+ProcessTask* Schedueler::FindProc(int pid) {
+  CriticalGuard guard(&table_lock_);
+  for (ProcessTask* task = pid_hash_[pid % PID_HASH_SIZE]; task; task = task->hash_next) {
+    if (task->pid == pid) {
+      return task;
     }
   }
   return nullptr;
 }
 
+bool Schedueler::IsDescendant(ProcessTask* owner, ProcessTask* task) {
+  CriticalGuard guard(&table_lock_);
+  for (ProcessTask* p = task->Leader(); p; p = p->parent_process) {
+    if (p == owner->Leader()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Schedueler::SetParent(ProcessTask* child, ProcessTask* parent) {
+  CriticalGuard guard(&table_lock_);
+  RemoveChild(child);
+  child->parent_process = parent;
+  child->sibling = parent->children;
+  parent->children = child;
+}
+
+void Schedueler::RemoveChild(ProcessTask* child) {
+  if (!child->parent_process) {
+    return;
+  }
+  for (ProcessTask** p = &child->parent_process->children; *p; p = &(*p)->sibling) {
+    if (*p == child) {
+      *p = child->sibling;
+      break;
+    }
+  }
+  child->parent_process = nullptr;
+  child->sibling = nullptr;
+}
+
+bool Schedueler::HasRunnable() {
+  CriticalGuard guard(&rq_lock_);
+  return !rt_class_.Empty() || !fair_class_.Empty();
+}
+
 ProcessTask* Schedueler::ThisProcess() {
   CpuTask* current_cpu = &cpu_task_[riscv::regs::mhartid.read()];
   return current_cpu->process_task; 
@@ -142,14 +634,40 @@ void Schedueler::Dispatch() {
   while (true) {
     global_interrunpt_on();
     CpuTask* current_cpu = &cpu_task_[riscv::regs::mhartid.read()];
-    for (ProcessTask& task : process_tasks_) {
-      CriticalGuard lk(&task.lock);
-      if (task.state == ProcessState::runnable) {
-        current_cpu->process_task = &task;
-        task.state = ProcessState::running;
-        Switch(&current_cpu->saved_context, &task.saved_context);
-        current_cpu->process_task = nullptr;
+    uint64_t slice = 0;
+    ProcessTask* task = PickNext(&slice);
+    if (task) {
+      CriticalGuard lk(&task->lock);
+      // taken off the run queue, no other cpu can pick it meanwhile
+      TimerManager::Instance()->StartSlice(slice);
+      current_cpu->need_resched = false;
+      current_cpu->process_task = task;
+      task->state = ProcessState::running;
+      task->se.exec_start = TimerManager::Now();
+      task->usage_mark = task->se.exec_start;
+      Tracer::Instance()->Record(trace_def::switch_in);
+      task->perf.SwitchIn();
+      Switch(&current_cpu->saved_context, &task->saved_context);
+      task->perf.SwitchOut();
+      Tracer::Instance()->Record(trace_def::switch_out, lib::common::literal(task->state));
+      current_cpu->process_task = nullptr;
+      // a task is not freed while its lock is held, even if it exited,
+      // and it always leaves the cpu from kernel mode
+      task->AccountKernelTime();
+      uint64_t delta = task->usage_mark - task->se.exec_start;
+      task->se.sum_exec += delta;
+      {
+        CriticalGuard rq_guard(&rq_lock_);
+        ClassOf(task)->PutPrev(task, delta);
       }
+      continue;
+    }
+    // idle: drop the slice timer and wait for a deadline or a device interrupt,
+    // a pending interrupt still ends wfi while they are masked
+    global_interrunpt_off();
+    TimerManager::Instance()->StopSlice();
+    if (!HasRunnable()) {
+      riscv::isa::wfi();
     }
   }
 }
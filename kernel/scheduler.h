@@ -3,41 +3,133 @@
 
 #include "kernel/config/system_param.h"
 #include "kernel/cpu.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/lock/instrumented_lock.h"
+#include "kernel/lock/spin_lock.h"
+#include "kernel/lock/ticket_lock.h"
 #include "kernel/process.h"
+#include "kernel/sched_class.h"
+#include "kernel/slab.h"
 #include "lib/singleton.h"
 #include "lib/types.h"
 
 namespace kernel {
 
-class SpinLock;
-
 class Schedueler : public lib::Singleton<Schedueler> {
  public:
   friend class lib::Singleton<Schedueler>;
   void Yield();
-  void Sleep(const Channel* channel, SpinLock* lk = nullptr);
-  void Wakeup(const Channel* channel);
+  // lk is released while sleeping and taken again before returning. Like
+  // CriticalGuard this only touches lk on multi-core builds, an unlock of a
+  // lock nobody took would leave a TicketLock unable to be taken again.
+  template <typename LockType = SpinLock>
+  void Sleep(const Channel* channel, LockType* lk = nullptr) {
+    if constexpr (system_param::CPU_NUM == 1) {
+      lk = nullptr;
+    }
+    SleepImpl(channel, lk,
+              [](void* l) { static_cast<LockType*>(l)->UnLock(); },
+              [](void* l) { static_cast<LockType*>(l)->Lock(); });
+  }
+  // wake at most max_num sleepers of channel, every one if max_num < 0
+  int Wakeup(const Channel* channel, int max_num = -1);
+  // exit of any thread takes the whole thread group down
   void Exit(int code);
-  void SetInitProcess(const ProcessTask* process);
-  const ProcessTask* GetInitProcess();
-  std::tuple<bool, ProcessTask*> FindFirslZombieChild(const ProcessTask* parent);
+  // leave as a single thread, the task stays a zombie until joined or its group exits
+  void ExitThread(int code);
+  // reap the thread tid of the caller's group, returns tid or -1
+  int Join(int tid, int* exit_code);
+  void SetInitProcess(ProcessTask* process);
+  ProcessTask* GetInitProcess();
+  // only children with the given pid count unless pid is -1
+  std::tuple<bool, ProcessTask*> FindFirslZombieChild(const ProcessTask* parent, int pid = -1);
+  // usage of every live and reaped thread of the group
+  TaskUsage GroupUsage(ProcessTask* leader);
   void ClockInterrupt();
-  inline __attribute__((always_inline)) uint64_t SystemTick() {
-    return ticks;
-  }
+  // give up the cpu if a wakeup or the end of the slice asked for it
+  void MaybePreempt();
+  // time since boot in units of TIMER_INTERVAL
+  uint64_t SystemTick();
+  // sleep until mtime reaches deadline, false if woken early because the task was killed
+  bool SleepUntil(uint64_t deadline);
   ProcessTask* ThisProcess();
   CpuTask* ThisCpu();
   void InitTimer();
   void Dispatch();
   ProcessTask* AllocProc();
+  // new thread sharing the address space and files of creator
+  ProcessTask* AllocThread(ProcessTask* creator, uint64_t entry, uint64_t arg);
+  // task running fn(arg) in machine mode, never returns to user mode
+  ProcessTask* CreateKernelThread(const char* name, void (*fn)(void*), void* arg);
+  // first time task becomes runnable, it inherits the scheduling policy of parent if given
+  void WakeNewTask(ProcessTask* task, const ProcessTask* parent);
+  bool SetNice(ProcessTask* task, int nice);
+  bool SetPolicy(ProcessTask* task, int policy, int rt_priority);
+  // give a process which has been reset back to the task cache
+  void FreeProc(ProcessTask* process);
+  ProcessTask* FindProc(int pid);
+  // whether task belongs to the thread group of owner or of one of its descendants
+  bool IsDescendant(ProcessTask* owner, ProcessTask* task);
+  // fn(task) for every allocated task, the table lock is held meanwhile
+  template <typename F>
+  void ForEachTask(F&& fn) {
+    CriticalGuard guard(&table_lock_);
+    for (ProcessTask* task = task_head_; task; task = task->task_next) {
+      fn(task);
+    }
+  }
+  void SetParent(ProcessTask* child, ProcessTask* parent);
 
  private:
   Schedueler() {}
+  static constexpr int PID_HASH_SIZE = 256;
+  static constexpr int WAIT_HASH_SIZE = 256;
+
+  // sleepers of every channel hashing to it, taken before a task lock
+  struct WaitBucket {
+    SpinLock lock;
+    ProcessTask* head = nullptr;
+  };
+
+  void SleepImpl(const Channel* channel, void* lk, void (*unlock)(void*), void (*lock)(void*));
+  void InsertTask(ProcessTask* task);
+  // a task from the cache with its slot in the run queues reserved
+  ProcessTask* AllocTask();
+  void FreeTask(ProcessTask* task);
+  bool HasRunnable();
+  SchedClass* ClassOf(const ProcessTask* task);
+  // take the next task off the run queues, *slice is how long it may run
+  ProcessTask* PickNext(uint64_t* slice);
+  WaitBucket& BucketOf(const Channel* channel);
+  // the lock of bucket is held
+  void LinkWaiter(WaitBucket& bucket, ProcessTask* task);
+  void UnlinkWaiter(WaitBucket& bucket, ProcessTask* task);
+  // the locks of the wait bucket of task and of task are held. A sleeper
+  // becomes runnable, one which has not gone to sleep yet does not
+  void WakeWaiter(WaitBucket& bucket, ProcessTask* task);
+  // wake task whatever channel it sleeps on, the table lock is held
+  void WakeTask(ProcessTask* task);
+  // task->lock is held, the task was sleeping and has left its wait bucket
+  void MakeRunnable(ProcessTask* task);
+  // ask the running task of this cpu to make room for woken if it should
+  void CheckPreempt(ProcessTask* woken);
+  void RemoveChild(ProcessTask* child);
+  void KillGroup(ProcessTask* leader, int code);
+  void ReapThreads(ProcessTask* leader);
 
-  ProcessTask process_tasks_[system_param::MAX_PROCESS_NUM];
+  ObjectCache<ProcessTask> task_cache_{"process_task"};
+  // every allocated process, in allocation order
+  ProcessTask* task_head_ = nullptr;
+  ProcessTask* task_tail_ = nullptr;
+  ProcessTask* pid_hash_[PID_HASH_SIZE] = {nullptr};
+  WaitBucket wait_hash_[WAIT_HASH_SIZE];
+  Instrumented<TicketLock> table_lock_{"sched_table"};
   CpuTask cpu_task_[system_param::CPU_NUM];
-  volatile uint64_t ticks = 0;
-  const ProcessTask* init_process_;
+  ProcessTask* init_process_ = nullptr;
+  // the run queues of both classes, taken after a task lock
+  Instrumented<TicketLock> rq_lock_{"sched_rq"};
+  RtSchedClass rt_class_;
+  FairSchedClass fair_class_;
 };
 
 }  // namespace kernel
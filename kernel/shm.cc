@@ -0,0 +1,169 @@
+#include "kernel/shm.h"
+
+#include "kernel/lock/critical_guard.h"
+#include "kernel/slab.h"
+#include "kernel/virtual_memory.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+static ObjectCache<ShmSegment> shm_cache("shm_segment");
+
+// every named segment holds a reference for its slot
+static ShmSegment* named[mman_def::MAX_SHM_SEGMENTS];
+static SpinLock named_lock;
+
+static int FindNamed(const char* name) {
+  for (int i = 0; i < mman_def::MAX_SHM_SEGMENTS; ++i) {
+    if (named[i] && strcmp(named[i]->Name(), name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+ShmSegment* ShmSegment::Create(const char* name, size_t size) {
+  if (size == 0 || size > mman_def::MAX_SHM_SIZE || strlen(name) >= mman_def::MAX_SHM_NAME) {
+    return nullptr;
+  }
+  auto* vm = VirtualMemory::Instance();
+  ShmSegment* segment = shm_cache.Alloc();
+  if (!segment) {
+    return nullptr;
+  }
+  segment->lists_ = reinterpret_cast<uint64_t***>(vm->Alloc());
+  if (!segment->lists_) {
+    Put(segment);
+    return nullptr;
+  }
+  // pages_ only counts what is there, so a failed segment is freed like any other
+  size_t pages = VirtualMemory::AddrCastUp(size) / memory_layout::PGSIZE;
+  for (size_t i = 0; i < pages; ++i) {
+    uint64_t**& list = segment->lists_[i / PAGES_PER_LIST];
+    if (!list) {
+      list = reinterpret_cast<uint64_t**>(vm->Alloc());
+    }
+    uint64_t* page = list ? vm->Alloc() : nullptr;
+    if (!page) {
+      Put(segment);
+      return nullptr;
+    }
+    list[i % PAGES_PER_LIST] = page;
+    segment->pages_ += 1;
+  }
+  if (!*name) {
+    return segment;
+  }
+  memcpy(segment->name_, name, strlen(name) + 1);
+  // the pages were allocated without the lock, the name may have been bound meanwhile
+  int slot = -1;
+  ShmSegment* bound = nullptr;
+  {
+    CriticalGuard guard(&named_lock);
+    int found = FindNamed(name);
+    if (found >= 0) {
+      bound = named[found];
+      bound->Get();
+    }
+    for (int i = 0; i < mman_def::MAX_SHM_SEGMENTS && slot < 0 && !bound; ++i) {
+      if (!named[i]) {
+        slot = i;
+      }
+    }
+    if (slot >= 0) {
+      segment->Get();
+      named[slot] = segment;
+    }
+  }
+  if (slot < 0) {
+    // the first creator wins, or there are too many names
+    Put(segment);
+    return bound;
+  }
+  return segment;
+}
+
+ShmSegment* ShmSegment::OpenOrCreate(const char* name, size_t size) {
+  // most opens find the segment, they need not allocate its pages first
+  ShmSegment* segment = *name ? Open(name) : nullptr;
+  return segment ? segment : Create(name, size);
+}
+
+ShmSegment* ShmSegment::Open(const char* name) {
+  CriticalGuard guard(&named_lock);
+  int slot = FindNamed(name);
+  if (slot < 0) {
+    return nullptr;
+  }
+  named[slot]->Get();
+  return named[slot];
+}
+
+bool ShmSegment::Unlink(const char* name) {
+  ShmSegment* segment = nullptr;
+  {
+    CriticalGuard guard(&named_lock);
+    int slot = FindNamed(name);
+    if (slot < 0) {
+      return false;
+    }
+    segment = named[slot];
+    named[slot] = nullptr;
+  }
+  Put(segment);
+  return true;
+}
+
+void ShmSegment::Get() {
+  CriticalGuard guard(&lk_);
+  ref_count_ += 1;
+}
+
+void ShmSegment::Put(ShmSegment* segment) {
+  {
+    CriticalGuard guard(&segment->lk_);
+    segment->ref_count_ -= 1;
+    if (segment->ref_count_ > 0) {
+      return;
+    }
+  }
+  shm_cache.Free(segment);
+}
+
+ShmSegment::~ShmSegment() {
+  if (!lists_) {
+    return;
+  }
+  auto* vm = VirtualMemory::Instance();
+  // pages still mapped somewhere only lose the reference of the segment
+  for (size_t i = 0; i < pages_; ++i) {
+    vm->FreePage(PageAt(i));
+  }
+  for (size_t i = 0; i < PAGES_PER_LIST && lists_[i]; ++i) {
+    vm->FreePage(reinterpret_cast<uint64_t*>(lists_[i]));
+  }
+  vm->FreePage(reinterpret_cast<uint64_t*>(lists_));
+}
+
+uint64_t* ShmSegment::PageAt(size_t index) const {
+  return lists_[index / PAGES_PER_LIST][index % PAGES_PER_LIST];
+}
+
+bool ShmSegment::Map(uint64_t* page_table, uint64_t va, size_t pages, riscv::PTE privilege) {
+  auto* vm = VirtualMemory::Instance();
+  if (pages > pages_) {
+    return false;
+  }
+  for (size_t i = 0; i < pages; ++i) {
+    uint64_t* pa = PageAt(i);
+    vm->GetPage(pa);
+    if (!vm->MapPage(page_table, va + i * memory_layout::PGSIZE, reinterpret_cast<uint64_t>(pa), privilege)) {
+      vm->FreePage(pa);
+      vm->FreeMemory(page_table, va, va + i * memory_layout::PGSIZE);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace kernel
@@ -0,0 +1,56 @@
+#ifndef KERNEL_SHM_H
+#define KERNEL_SHM_H
+
+#include "arch/riscv_isa.h"
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/spin_lock.h"
+#include "kernel/sys_def/mman_def.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Physical pages which several address spaces map at once. A segment is
+// referenced by its fds, its mappings and its name until shm_unlink. Each
+// mapping holds its own reference of every page in VirtualMemory, so the
+// pages outlive the segment until the last one is unmapped.
+class ShmSegment {
+ public:
+  // the named segment with one more reference, or a new one of size bytes
+  // with zeroed pages if there is none. An empty name is never shared
+  static ShmSegment* OpenOrCreate(const char* name, size_t size);
+  // the name is forgotten, fds and mappings keep the segment alive
+  static bool Unlink(const char* name);
+  static void Put(ShmSegment* segment);
+  void Get();
+
+  // map the first pages of the segment from va on
+  bool Map(uint64_t* page_table, uint64_t va, size_t pages, riscv::PTE privilege);
+  size_t Pages() const {
+    return pages_;
+  }
+  const char* Name() const {
+    return name_;
+  }
+
+  ShmSegment() {}
+  ~ShmSegment();
+
+ private:
+  static constexpr size_t PAGES_PER_LIST = memory_layout::PGSIZE / sizeof(uint64_t*);
+
+  static ShmSegment* Create(const char* name, size_t size);
+  static ShmSegment* Open(const char* name);
+
+  uint64_t* PageAt(size_t index) const;
+
+  char name_[mman_def::MAX_SHM_NAME] = {0};
+  size_t pages_ = 0;
+  // a page of lists, each list a page of the physical pages of the segment
+  uint64_t*** lists_ = nullptr;
+  int ref_count_ = 1;
+  SpinLock lk_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_SHM_H
@@ -0,0 +1,219 @@
+#include "kernel/slab.h"
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/utils.h"
+#include "kernel/virtual_memory.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+constexpr uint32_t SLAB_MAGIC = 0x51ab'c0de;
+constexpr uint32_t LARGE_MAGIC = 0x1a29'e000;
+constexpr size_t OBJECT_ALIGN = 16;
+constexpr uint8_t FREE_END = 0xff;
+constexpr uint8_t MAX_LARGE_PAGES = 8;
+
+// Lives at the start of every slab page, followed by the free index array
+// and the objects. Keeping the free list outside of the objects leaves
+// constructed objects untouched while they are cached.
+struct Slab {
+  uint32_t magic;
+  uint16_t in_use;
+  uint8_t free_head;
+  KmemCache* cache;
+  char* objects;
+  Slab* prev;
+  Slab* next;
+  uint8_t free_next[];
+};
+
+// header of kmalloc allocations which do not fit any cache
+struct LargeHeader {
+  uint32_t magic;
+  uint32_t page_num;
+};
+
+static constexpr size_t AlignUp(size_t size) {
+  return (size + OBJECT_ALIGN - 1) / OBJECT_ALIGN * OBJECT_ALIGN;
+}
+
+static constexpr size_t LARGE_HEADER_SIZE = AlignUp(sizeof(LargeHeader));
+
+// caches are constructed by RunInitArray on a single hart, no locking needed
+static KmemCache* cache_head = nullptr;
+
+KmemCache::KmemCache(const char* name, size_t object_size, Ctor ctor) : name_(name), ctor_(ctor) {
+  object_size_ = AlignUp(object_size ? object_size : 1);
+  objects_per_slab_ = (memory_layout::PGSIZE - sizeof(Slab)) / (object_size_ + 1);
+  while (objects_per_slab_ > 0 && AlignUp(sizeof(Slab) + objects_per_slab_) + objects_per_slab_ * object_size_ > memory_layout::PGSIZE) {
+    objects_per_slab_ -= 1;
+  }
+  if (objects_per_slab_ >= FREE_END) {
+    objects_per_slab_ = FREE_END - 1;
+  }
+  next_ = cache_head;
+  cache_head = this;
+}
+
+KmemCache* KmemCache::Head() {
+  return cache_head;
+}
+
+Slab* KmemCache::NewSlab() {
+  if (objects_per_slab_ == 0) {
+    return nullptr;
+  }
+  auto* slab = reinterpret_cast<Slab*>(VirtualMemory::Instance()->Alloc());
+  if (!slab) {
+    return nullptr;
+  }
+  slab->magic = SLAB_MAGIC;
+  slab->in_use = 0;
+  slab->free_head = 0;
+  slab->cache = this;
+  slab->objects = reinterpret_cast<char*>(slab) + AlignUp(sizeof(Slab) + objects_per_slab_);
+  for (uint32_t i = 0; i < objects_per_slab_; ++i) {
+    slab->free_next[i] = i + 1 < objects_per_slab_ ? i + 1 : FREE_END;
+    if (ctor_) {
+      ctor_(slab->objects + i * object_size_);
+    }
+  }
+  slab_num_ += 1;
+  return slab;
+}
+
+void KmemCache::Link(Slab** list, Slab* slab) {
+  slab->prev = nullptr;
+  slab->next = *list;
+  if (*list) {
+    (*list)->prev = slab;
+  }
+  *list = slab;
+}
+
+void KmemCache::Unlink(Slab** list, Slab* slab) {
+  if (slab->prev) {
+    slab->prev->next = slab->next;
+  } else {
+    *list = slab->next;
+  }
+  if (slab->next) {
+    slab->next->prev = slab->prev;
+  }
+  slab->prev = slab->next = nullptr;
+}
+
+void* KmemCache::Alloc() {
+  CriticalGuard guard(&lk_);
+  Slab* slab = partial_;
+  if (!slab) {
+    slab = NewSlab();
+    if (!slab) {
+      return nullptr;
+    }
+    Link(&partial_, slab);
+  }
+  uint8_t index = slab->free_head;
+  slab->free_head = slab->free_next[index];
+  slab->in_use += 1;
+  if (slab->free_head == FREE_END) {
+    Unlink(&partial_, slab);
+    Link(&full_, slab);
+  }
+  active_objects_ += 1;
+  return slab->objects + index * object_size_;
+}
+
+void KmemCache::Free(void* obj) {
+  auto* slab = reinterpret_cast<Slab*>(VirtualMemory::AddrCastDown(reinterpret_cast<uint64_t>(obj)));
+  uint64_t offset = reinterpret_cast<char*>(obj) - slab->objects;
+  if (slab->magic != SLAB_MAGIC || slab->cache != this || offset % object_size_ != 0) {
+    panic("KmemCache %s: invalid object: %p", name_, obj);
+  }
+  CriticalGuard guard(&lk_);
+  uint8_t index = offset / object_size_;
+  if (slab->free_head == FREE_END) {
+    Unlink(&full_, slab);
+    Link(&partial_, slab);
+  }
+  slab->free_next[index] = slab->free_head;
+  slab->free_head = index;
+  slab->in_use -= 1;
+  active_objects_ -= 1;
+  // an empty slab is kept only if it is the last one with free objects
+  if (slab->in_use == 0 && (slab->prev || slab->next)) {
+    Unlink(&partial_, slab);
+    slab->magic = 0;
+    slab_num_ -= 1;
+    VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(slab));
+  }
+}
+
+KmemCache* KmemCache::CacheOf(const void* obj) {
+  auto* slab = reinterpret_cast<Slab*>(VirtualMemory::AddrCastDown(reinterpret_cast<uint64_t>(obj)));
+  if (slab->magic != SLAB_MAGIC) {
+    return nullptr;
+  }
+  return slab->cache;
+}
+
+static KmemCache kmalloc_caches[] = {
+  {"kmalloc-16", 16},
+  {"kmalloc-32", 32},
+  {"kmalloc-64", 64},
+  {"kmalloc-128", 128},
+  {"kmalloc-256", 256},
+  {"kmalloc-512", 512},
+  {"kmalloc-1024", 1024},
+};
+
+void* kmalloc(size_t size) {
+  for (auto& cache : kmalloc_caches) {
+    if (size <= cache.ObjectSize()) {
+      return cache.Alloc();
+    }
+  }
+  size_t page_num = (size + LARGE_HEADER_SIZE + memory_layout::PGSIZE - 1) / memory_layout::PGSIZE;
+  if (page_num > MAX_LARGE_PAGES) {
+    return nullptr;
+  }
+  uint64_t* pages = page_num == 1 ? VirtualMemory::Instance()->Alloc() : VirtualMemory::Instance()->AllocContinuousPage(page_num);
+  if (!pages) {
+    return nullptr;
+  }
+  auto* header = reinterpret_cast<LargeHeader*>(pages);
+  header->magic = LARGE_MAGIC;
+  header->page_num = page_num;
+  return reinterpret_cast<char*>(pages) + LARGE_HEADER_SIZE;
+}
+
+void* kzalloc(size_t size) {
+  void* addr = kmalloc(size);
+  if (addr) {
+    memset(addr, 0, size);
+  }
+  return addr;
+}
+
+void kfree(void* addr) {
+  if (!addr) {
+    return;
+  }
+  uint64_t page = VirtualMemory::AddrCastDown(reinterpret_cast<uint64_t>(addr));
+  if (KmemCache* cache = KmemCache::CacheOf(addr)) {
+    cache->Free(addr);
+    return;
+  }
+  auto* header = reinterpret_cast<LargeHeader*>(page);
+  if (header->magic != LARGE_MAGIC || reinterpret_cast<uint64_t>(addr) != page + LARGE_HEADER_SIZE) {
+    panic("kfree: invalid addr: %p", addr);
+  }
+  uint32_t page_num = header->page_num;
+  header->magic = 0;
+  for (uint32_t i = 0; i < page_num; ++i) {
+    VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(page + i * memory_layout::PGSIZE));
+  }
+}
+
+}  // namespace kernel
@@ -0,0 +1,91 @@
+#ifndef KERNEL_SLAB_H
+#define KERNEL_SLAB_H
+
+#include <new>
+#include <utility>
+
+#include "kernel/lock/spin_lock.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+struct Slab;
+
+// Caches objects of a single size in page sized slabs. The slab header sits
+// at the beginning of its page, so the owner of an object is found by
+// rounding the object address down to the page.
+class KmemCache {
+ public:
+  using Ctor = void (*)(void*);
+
+  // ctor runs once for every object when a new slab is carved, freed
+  // objects are expected to be handed back in constructed state
+  KmemCache(const char* name, size_t object_size, Ctor ctor = nullptr);
+  KmemCache(const KmemCache&) = delete;
+  KmemCache& operator= (const KmemCache&) = delete;
+
+  void* Alloc();
+  void Free(void* obj);
+  const char* Name() const { return name_; }
+  size_t ObjectSize() const { return object_size_; }
+  size_t ActiveObjects() const { return active_objects_; }
+  size_t SlabNum() const { return slab_num_; }
+  size_t ObjectsPerSlab() const { return objects_per_slab_; }
+  static KmemCache* CacheOf(const void* obj);
+  // every cache, linked when constructed
+  static KmemCache* Head();
+  KmemCache* Next() const { return next_; }
+
+ private:
+  Slab* NewSlab();
+  void Link(Slab** list, Slab* slab);
+  void Unlink(Slab** list, Slab* slab);
+
+  const char* name_;
+  size_t object_size_;
+  Ctor ctor_;
+  uint32_t objects_per_slab_;
+  // slabs which have free objects and slabs which have not
+  Slab* partial_ = nullptr;
+  Slab* full_ = nullptr;
+  size_t active_objects_ = 0;
+  size_t slab_num_ = 0;
+  KmemCache* next_ = nullptr;
+  SpinLock lk_;
+};
+
+// Cache of T, objects are constructed on Alloc and destroyed on Free.
+template <typename T>
+class ObjectCache {
+ public:
+  explicit ObjectCache(const char* name) : cache_(name, sizeof(T)) {}
+
+  template <typename... Args>
+  T* Alloc(Args&&... args) {
+    void* mem = cache_.Alloc();
+    if (!mem) {
+      return nullptr;
+    }
+    return new (mem) T(std::forward<Args>(args)...);
+  }
+
+  void Free(T* obj) {
+    obj->~T();
+    cache_.Free(obj);
+  }
+
+  KmemCache* Cache() { return &cache_; }
+
+ private:
+  KmemCache cache_;
+};
+
+// General purpose allocation, small sizes are served from power of two
+// caches and larger ones from continuous pages.
+void* kmalloc(size_t size);
+void* kzalloc(size_t size);
+void kfree(void* addr);
+
+}  // namespace kernel
+
+#endif  // KERNEL_SLAB_H
@@ -3,6 +3,7 @@
 #include "arch/riscv_reg.h"
 #include "driver/device_factory.h"
 #include "lib/types.h"
+#include "kernel/asid_allocator.h"
 #include "kernel/config/memory_layout.h"
 #include "kernel/config/system_param.h"
 #include "kernel/console.h"
@@ -12,6 +13,7 @@
 #include "kernel/syscalls/define.h"
 #include "kernel/utils.h"
 #include "kernel/virtual_memory.h"
+#include "lib/common.h"
 
 __attribute__ ((aligned (memory_layout::PGSIZE))) char stack[system_param::CPU_NUM][2 * memory_layout::PGSIZE];
 
@@ -49,10 +51,16 @@ void start() {
   if (!kernel::VirtualMemory::Instance()->Init()) {
     kernel::panic();
   }
+  kernel::AsidAllocator::Instance()->Init();
 
   riscv::regs::pmp_addr.write(0, 0x3f'ffff'ffff'ffffuL);
   riscv::regs::pmp_cfg.write(0, riscv::PMPBit::X | riscv::PMPBit::R | riscv::PMPBit::W | riscv::PMPBit::TOR);
 
+  // user code reads time, cycle and instret directly, see lib/clock.h
+  uint64_t counters = lib::common::literal(riscv::Counteren::CY | riscv::Counteren::TM | riscv::Counteren::IR);
+  riscv::regs::mcounteren.write(counters);
+  riscv::regs::scounteren.write(counters);
+
   riscv::plic::globalinit();
   riscv::plic::hartinit(riscv::regs::mhartid.read());
   driver::DeviceFactory::Instance()->InitDevices();
@@ -61,6 +69,9 @@ void start() {
   kernel::ResourceFactory::Instance()->RegistResource(kernel::resource_id::console_major, kernel::resource_id::console_minor, &console);
 
   kernel::ExcuteInitProcess(initcode, initcode_size);
+  if (!kernel::VirtualMemory::Instance()->StartZeroWorker()) {
+    kernel::printf("Warning: failed to start page zeroing thread\n");
+  }
   kernel::Schedueler::Instance()->InitTimer();
   kernel::Schedueler::Instance()->Dispatch();
 }
@@ -3,7 +3,10 @@
 namespace descriptor_def {
 
 namespace io {
+  // output of a process, the console unless a shell redirected it
   constexpr int console = 0;
+  // read by programs which are given no file, the console at first too
+  constexpr int input = 1;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "kernel/config/memory_layout.h"
+#include "lib/types.h"
+
+namespace io_def {
+
+// A submission and a completion queue shared by a process and the kernel
+// in one page handed out by io_setup. The process fills sq entries and
+// advances sq_tail, io_enter runs them in order and posts a cqe for each,
+// so many operations cost a single trap.
+constexpr uint32_t RING_ENTRIES = 64;
+
+enum op : uint8_t {
+  nop = 0,
+  read = 1,
+  write = 2,
+  open = 3,
+  close = 4,
+  fstat = 5,
+};
+
+struct sqe {
+  // one of op
+  uint8_t opcode;
+  uint8_t reserved[3];
+  int32_t fd;
+  // buffer of read and write, path of open, fs::FileState of fstat
+  uint64_t addr;
+  uint64_t len;
+  // handed back in the cqe untouched
+  uint64_t user_data;
+};
+
+struct cqe {
+  uint64_t user_data;
+  // what the matching syscall would have returned
+  int64_t res;
+};
+
+// Indexes only grow, an entry sits at index % RING_ENTRIES. The process
+// owns sq_tail and cq_head, the kernel sq_head and cq_tail.
+struct ring {
+  uint32_t sq_head;
+  uint32_t sq_tail;
+  uint32_t cq_head;
+  uint32_t cq_tail;
+  sqe sq[RING_ENTRIES];
+  cqe cq[RING_ENTRIES];
+};
+
+static_assert(sizeof(ring) <= memory_layout::PGSIZE);
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace mman_def {
+
+// Shared memory segments: shm_open hands out an fd of a segment, mmap of
+// that fd maps its pages into the caller. Every process mapping a segment
+// sees the same physical pages, fork keeps mappings shared.
+constexpr int MAX_SHM_NAME = 16;
+constexpr uint64_t MAX_SHM_SIZE = 32 * 1024 * 1024;
+// named segments existing at the same time
+constexpr int MAX_SHM_SEGMENTS = 32;
+
+enum prot : int {
+  read = 1,
+  write = 2,
+};
+
+}
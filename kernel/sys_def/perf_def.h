@@ -0,0 +1,31 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace perf_def {
+
+// counters one task may have open at a time
+constexpr int MAX_COUNTERS = 4;
+
+enum type : int {
+  // config is one of hw_event
+  hardware = 0,
+  // config is written to the mhpmevent selector as is, the events are
+  // implementation defined
+  raw = 1,
+};
+
+enum hw_event : uint64_t {
+  cycles = 0,
+  instructions = 1,
+};
+
+enum ctl_cmd : int {
+  enable = 0,
+  disable = 1,
+  // zero the count, the counter stays enabled or disabled
+  reset = 2,
+  close = 3,
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace prof_def {
+
+// deepest call chain kept per sample, including the sampled pc
+constexpr int MAX_DEPTH = 16;
+
+enum mode : uint8_t {
+  user = 0,
+  // a task was running kernel code, e.g. a syscall
+  kernel = 1,
+  // no task on the hart, pc is in the scheduler loop
+  idle = 2,
+};
+
+struct sample {
+  // mtime
+  uint64_t timestamp;
+  // leader of the sampled thread group, 0 if idle
+  int32_t pid;
+  uint16_t hart;
+  uint8_t mode;
+  // valid entries of pc
+  uint8_t depth;
+  // pc[0] is the interrupted pc, the rest are return addresses, innermost first
+  uint64_t pc[MAX_DEPTH];
+};
+
+enum ctl_cmd : int {
+  stop = 0,
+  // argument is the sampling period in microseconds
+  start = 1,
+  // number of samples lost because a ring was full
+  dropped = 2,
+};
+
+}
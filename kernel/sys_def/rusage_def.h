@@ -0,0 +1,28 @@
+#pragma once
+
+#include "kernel/sys_def/time_def.h"
+#include "lib/types.h"
+
+namespace rusage_def {
+
+enum who : int {
+  // the calling process, every thread of it included
+  self = 0,
+  // reaped children and everything they reaped themselves
+  children = -1,
+};
+
+struct rusage {
+  time_def::timespec utime;
+  time_def::timespec stime;
+  // sleeps and preemptions
+  uint64_t nvcsw;
+  uint64_t nivcsw;
+  // page faults taken
+  uint64_t nfault;
+  // blocks read from and written to disk
+  uint64_t inblock;
+  uint64_t oublock;
+};
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+namespace sched_def {
+
+enum policy : int {
+  // time shared by virtual runtime, weighted by nice
+  normal = 0,
+  // fixed priority, runs until it blocks or a higher priority task wakes
+  fifo = 1,
+  // fixed priority, round robin between tasks of the same priority
+  rr = 2,
+};
+
+constexpr int NICE_MIN = -20;
+constexpr int NICE_MAX = 19;
+constexpr int RT_PRIORITY_MIN = 1;
+constexpr int RT_PRIORITY_MAX = 99;
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace time_def {
+
+// there is no rtc, both clocks count from boot
+enum clock_type : int {
+  realtime = 0,
+  monotonic = 1,
+};
+
+constexpr int64_t NSEC_PER_SEC = 1'000'000'000;
+
+struct timespec {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+// Read-only page mapped into every process. User code reads the time csr
+// directly and converts it with the frequency published here.
+constexpr uint64_t CLOCK_PAGE_VA = 0x3f'ffff'f000;
+
+struct clock_page {
+  // ticks per second of the time csr
+  uint64_t mtime_freq;
+  // added to the monotonic clock for CLOCK_REALTIME, 0 while there is no rtc
+  int64_t realtime_offset_ns;
+};
+
+}
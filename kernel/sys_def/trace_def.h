@@ -0,0 +1,48 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace trace_def {
+
+// keep in sync with tools/trace_decode.py
+enum event : uint16_t {
+  // args: syscall number, first argument
+  syscall_enter = 1,
+  // args: syscall number, return value
+  syscall_exit = 2,
+  // the task starts running, no args
+  switch_in = 3,
+  // args: state the task leaves the cpu in
+  switch_out = 4,
+  // args: channel
+  sleep = 5,
+  // args: pid of the woken task, channel
+  wakeup = 6,
+  // args: device mmio base, first descriptor
+  virtio_submit = 7,
+  // args: device mmio base, interrupt status
+  virtio_complete = 8,
+  // args: faulting address, pc
+  page_fault = 9,
+};
+
+struct record {
+  // mtime
+  uint64_t timestamp;
+  uint16_t hart;
+  uint16_t event;
+  // running task, 0 if none
+  int32_t pid;
+  uint64_t args[2];
+};
+
+enum ctl_cmd : int {
+  stop = 0,
+  start = 1,
+  // drop everything recorded so far
+  clear = 2,
+  // number of records lost because a ring was full
+  dropped = 3,
+};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace uio_def {
+
+// buffers one readv or writev may take
+constexpr int MAX_IOV = 16;
+
+struct iovec {
+  void* base;
+  uint64_t len;
+};
+
+enum whence : int {
+  // the offset is taken as is
+  set = 0,
+  // relative to the current offset
+  cur = 1,
+  // relative to the size of the file
+  end = 2,
+};
+
+}
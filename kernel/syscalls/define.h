@@ -44,6 +44,41 @@ int sys_move_cursor();
 int sys_detach_framebuffer();
 int sys_dlopen();
 int sys_dlclose();
+int sys_clone();
+int sys_thread_exit();
+int sys_thread_join();
+int sys_futex_wait();
+int sys_futex_wake();
+int sys_nanosleep();
+int sys_clock_gettime();
+int sys_nice();
+int sys_setpriority();
+int sys_sched_setscheduler();
+int sys_getrusage();
+int sys_wait4();
+int sys_trace_ctl();
+int sys_trace_read();
+int sys_prof_ctl();
+int sys_prof_read();
+int sys_perf_open();
+int sys_perf_ctl();
+int sys_perf_read();
+int sys_io_setup();
+int sys_io_enter();
+int sys_readv();
+int sys_writev();
+int sys_pread();
+int sys_pwrite();
+int sys_lseek();
+int sys_sendfile();
+int sys_copy_file_range();
+int sys_pipe();
+int sys_dup();
+int sys_dup2();
+int sys_shm_open();
+int sys_shm_unlink();
+int sys_mmap();
+int sys_munmap();
 
 }  // namespace syscall
 }  // namespace kernel
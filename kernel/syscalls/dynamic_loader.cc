@@ -7,6 +7,7 @@
 #include "kernel/printf.h"
 #include "kernel/scheduler.h"
 #include "kernel/syscalls/dynamic_loader.h"
+#include "kernel/uaccess.h"
 #include "kernel/virtual_memory.h"
 #include "lib/string.h"
 
@@ -60,9 +61,14 @@ std::array<uint64_t, 2> DynamicLoader::ProcessDynamicInfo(uint64_t offset, const
   Elf64_Dyn* init_array = nullptr;
   Elf64_Dyn* init_array_sz = nullptr;
 
+  UserTranslator translator(process_->mm->page_table);
   auto dyn_info_num = dynamic_info->dynamic_size / sizeof(Elf64_Dyn);
   for (uint32_t i = 0; i < dyn_info_num; ++i) {
-    auto* dyn = reinterpret_cast<Elf64_Dyn*>(VirtualMemory::Instance()->VAToPA(process_->page_table, dynamic_info->dynamic_vaddr + i * sizeof(Elf64_Dyn)));
+    auto* dyn = reinterpret_cast<Elf64_Dyn*>(translator.Translate(dynamic_info->dynamic_vaddr + i * sizeof(Elf64_Dyn)));
+    if (!dyn) {
+      printf("DynamicLoader: Invalid dynamic section\n");
+      return {};
+    }
     if (dyn->d_tag == DT_RELA) {
       rela_hdr = dyn;
     }
@@ -92,8 +98,8 @@ std::array<uint64_t, 2> DynamicLoader::ProcessDynamicInfo(uint64_t offset, const
     printf("DynamicLoader: Cannot find dyn sym from memory\n");
     return {};
   }
-  auto va_to_pa_util = [this](uint64_t va) -> uint64_t {
-    return VirtualMemory::Instance()->VAToPA(process_->page_table, va);
+  auto va_to_pa_util = [&translator](uint64_t va) -> uint64_t {
+    return translator.Translate(va);
   };
   auto fun = [&](Elf64_Dyn* hdr, Elf64_Dyn* size, auto type){
     if (!hdr || !size) {
@@ -163,7 +169,7 @@ bool DynamicLoader::LoadDynamicInfo(const DynamicInfo* dynamic_info, uint64_t* i
     return false;
   }
 
-  ProcessDynamicInfo(0, &dynsym_header, &dynstr_header, &process_->dynamic_info, true);
+  ProcessDynamicInfo(0, &dynsym_header, &dynstr_header, &process_->mm->dynamic_info, true);
   auto init_array = ProcessDynamicInfo(offset_, &dynsym_header, &dynstr_header, dynamic_info, false);
   
   if (init_array_beg && init_array_end) {
@@ -3,6 +3,7 @@
 
 #include "arch/riscv_isa.h"
 #include "arch/riscv_reg.h"
+#include "kernel/asid_allocator.h"
 #include "kernel/config/memory_layout.h"
 #include "kernel/printf.h"
 #include "kernel/process.h"
@@ -34,10 +35,14 @@ int ExecuteImpl(lib::StreamBase* stream, ProcessTask* process) {
 }
 
 void TrapRet(ProcessTask* process, riscv::Exception exception) {
+  // the thread group is going down, never get back to user mode
+  if (process->killed) {
+    Schedueler::Instance()->Exit(process->Leader()->exit_code);
+  }
   global_interrunpt_off();
+  process->AccountKernelTime();
   RegFrame* frame = process->frame;
-  riscv::regs::satp.write(riscv::virtual_addresing::Sv39, process->page_table);
-  riscv::isa::sfence();
+  AsidAllocator::Instance()->Activate(process->mm);
   riscv::regs::mepc.write(frame->mepc);
   riscv::regs::mtvec.write_vec(user_exception_table, true);
   riscv::regs::mstatus.set_mpp(riscv::MPP::user_mode);
@@ -55,7 +60,7 @@ void ExcuteInitProcess(char* code, size_t size) {
   lib::StringStream stringstream(code, size);
   ProcessTask* process = Schedueler::Instance()->AllocProc();
   ExecuteImpl(&stringstream, process);
-  process->state = ProcessState::runnable;
+  Schedueler::Instance()->WakeNewTask(process, nullptr);
   Schedueler::Instance()->SetInitProcess(process);
 }
 
@@ -8,18 +8,35 @@
 #include "filesystem/inode_def.h"
 #include "filesystem/filestream.h"
 #include "filesystem/file_descriptor.h"
+#include "kernel/asid_allocator.h"
+#include "kernel/file_table.h"
 #include "kernel/config/memory_layout.h"
-#include "kernel/global_channel.h"
 #include "kernel/lock/critical_guard.h"
+#include "kernel/pipe.h"
 #include "kernel/printf.h"
 #include "kernel/process.h"
+#include "kernel/procfs.h"
+#include "kernel/profiler.h"
 #include "kernel/resource_factory.h"
 #include "kernel/scheduler.h"
+#include "kernel/shm.h"
+#include "kernel/slab.h"
 #include "kernel/sys_def/device_info.h"
+#include "kernel/sys_def/io_def.h"
+#include "kernel/sys_def/mman_def.h"
+#include "kernel/sys_def/perf_def.h"
+#include "kernel/sys_def/prof_def.h"
+#include "kernel/sys_def/rusage_def.h"
+#include "kernel/sys_def/sched_def.h"
 #include "kernel/sys_def/syscall_err.h"
+#include "kernel/sys_def/time_def.h"
+#include "kernel/sys_def/uio_def.h"
 #include "kernel/syscalls/define.h"
 #include "kernel/syscalls/dynamic_loader.h"
 #include "kernel/syscalls/utils.h"
+#include "kernel/timer.h"
+#include "kernel/trace.h"
+#include "kernel/uaccess.h"
 #include "kernel/utils.h"
 #include "kernel/virtual_memory.h"
 #include "lib/string.h"
@@ -37,210 +54,810 @@ int sys_fork() {
     return -1;
   }
   dst_pro->frame->a0 = 0;
-  dst_pro->state = ProcessState::runnable;
-  dst_pro->parent_process = src_pro;
+  Schedueler::Instance()->SetParent(dst_pro, src_pro);
+  Schedueler::Instance()->WakeNewTask(dst_pro, src_pro);
   return dst_pro->pid;
 }
 
-static void GetFileDescriptor(int fd_index, fs::FileDescriptor** taregt_fd) {
-  auto* cur_process = Schedueler::Instance()->ThisProcess();
-  if (fd_index < 0 || (uint64_t)fd_index >= cur_process->file_descriptor.size()) {
-    return;
+// An open file of the caller, referenced for the lifetime of the object so
+// other threads may close fd meanwhile. get() is nullptr if fd is not open.
+class FileRef {
+ public:
+  explicit FileRef(int fd_index) : fd_(Schedueler::Instance()->ThisProcess()->files->Lookup(fd_index)) {
+    if (fd_ && fd_->file_type == fs::FileType::none) {
+      FileTable::Release(fd_);
+      fd_ = nullptr;
+    }
   }
-  auto& fd = cur_process->file_descriptor[fd_index];
-  if (fd.file_type == fs::FileType::none) {
-    return;
+
+  ~FileRef() {
+    if (fd_) {
+      FileTable::Release(fd_);
+    }
   }
-  *taregt_fd = &fd;
-}
 
-int sys_write() {
-  fs::FileDescriptor* fd = nullptr;
-  GetFileDescriptor(comm::GetIntArg(0), &fd);
-  if (!fd) {
-    printf("sys_write: Invalid file_descriptor: %d\n", comm::GetIntArg(0));
-    return -1;
+  FileRef(const FileRef&) = delete;
+  FileRef& operator=(const FileRef&) = delete;
+
+  fs::FileDescriptor* get() const {
+    return fd_;
   }
-  auto size = comm::GetIntegralArg<size_t>(2);
+
+ private:
+  fs::FileDescriptor* fd_;
+};
+
+// Moves data between the user buffers of iov and the file behind fd from
+// *offset on, which advances by the bytes moved. Stops at the first buffer
+// which is not used up, e.g. at the end of the file. Shared by the read and
+// write syscalls and the io ring.
+template <bool is_write>
+static int64_t TransferFile(fs::FileDescriptor* fd, const uio_def::iovec* iov, int iov_num, uint64_t* offset) {
+  constexpr riscv::PTE privilege = is_write ? riscv::PTE::R : riscv::PTE::W;
+  int64_t total = 0;
   if (fd->file_type == fs::FileType::regular_file || fd->file_type == fs::FileType::directory) {
+    if constexpr (is_write) {
+      // nothing is written if the file would grow past its largest size
+      uint64_t end = *offset;
+      for (int i = 0; i < iov_num; ++i) {
+        if (end > fs::MAX_FILE_SIZE || iov[i].len > fs::MAX_FILE_SIZE - end) {
+          return -1;
+        }
+        end += iov[i].len;
+      }
+    }
+    // one stream for all buffers, it keeps the indirect block between them
     fs::FileStream file_stream(fd->inode);
-    file_stream.Seek(fd->offset);
-    auto fun = [&file_stream](const char* buf, size_t len) -> size_t {
-      return file_stream.write(buf, len);
+    file_stream.Seek(*offset);
+    auto fun = [&file_stream](char* buf, size_t len) -> size_t {
+      if constexpr (is_write) {
+        return file_stream.write(buf, len);
+      } else {
+        return file_stream.Read(buf, len);
+      }
     };
-    size = safe_copy(comm::GetRawArg(1), size, fun);
-    fd->offset += size;
+    for (int i = 0; i < iov_num; ++i) {
+      size_t len = safe_copy(reinterpret_cast<uint64_t>(iov[i].base), iov[i].len, fun, privilege);
+      total += len;
+      if (len < iov[i].len) {
+        break;
+      }
+    }
+    *offset += total;
   } else if (fd->file_type == fs::FileType::device) {
     auto* r = ResourceFactory::Instance()->GetResource(fd->inode.major, fd->inode.minor);
     if (!r) {
       return -1;
     }
-    auto fun = [r](const char* buf, size_t len) -> size_t {
-      return r->write(buf, len);
+    auto fun = [r](char* buf, size_t len) -> size_t {
+      if constexpr (is_write) {
+        return r->write(buf, len);
+      } else {
+        return r->read(buf, len);
+      }
     };
-    size = safe_copy(comm::GetRawArg(1), size, fun);
-  } else if (fd->file_type == fs::FileType::none) {
-    printf("sys_write: Invalid file_descriptor: %d\n", comm::GetIntArg(0));
+    for (int i = 0; i < iov_num; ++i) {
+      size_t len = safe_copy(reinterpret_cast<uint64_t>(iov[i].base), iov[i].len, fun, privilege);
+      total += len;
+      if (len < iov[i].len) {
+        break;
+      }
+    }
+  } else if (fd->file_type == fs::FileType::pipe) {
+    if (fd->writable != is_write) {
+      return -1;
+    }
+    for (int i = 0; i < iov_num; ++i) {
+      uint64_t base = reinterpret_cast<uint64_t>(iov[i].base);
+      // a read takes what is there, only the first buffer waits for data
+      int64_t len = is_write ? fd->pipe->Write(base, iov[i].len) : fd->pipe->Read(base, iov[i].len, i == 0);
+      if (len < 0) {
+        return total ? total : -1;
+      }
+      total += len;
+      if (static_cast<uint64_t>(len) < iov[i].len) {
+        break;
+      }
+    }
+  } else if (fd->file_type == fs::FileType::proc && !is_write) {
+    for (int i = 0; i < iov_num; ++i) {
+      int64_t len = ProcFs::Instance()->Read(fd, reinterpret_cast<uint64_t>(iov[i].base), iov[i].len, offset);
+      if (len < 0) {
+        return total ? total : -1;
+      }
+      total += len;
+      if (static_cast<uint64_t>(len) < iov[i].len) {
+        break;
+      }
+    }
+  } else {
+    // files under /proc are read-only, shared memory is only mapped
     return -1;
   }
-  return size;
+  return total;
 }
 
-int sys_read() {
-  fs::FileDescriptor* fd = nullptr;
-  GetFileDescriptor(comm::GetIntArg(0), &fd);
+static int64_t WriteFile(fs::FileDescriptor* fd, uint64_t src, size_t size) {
+  uio_def::iovec iov{reinterpret_cast<void*>(src), size};
+  return TransferFile<true>(fd, &iov, 1, &fd->offset);
+}
+
+static int64_t ReadFile(fs::FileDescriptor* fd, uint64_t dst, size_t size) {
+  uio_def::iovec iov{reinterpret_cast<void*>(dst), size};
+  return TransferFile<false>(fd, &iov, 1, &fd->offset);
+}
+
+int sys_write() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
   if (!fd) {
-    printf("sys_read: Invalid file_descriptor: %d\n", comm::GetIntArg(0));
+    printf("sys_write: Invalid file_descriptor: %d\n", comm::GetIntArg(0));
     return -1;
   }
-  auto size = comm::GetIntegralArg<size_t>(2);
-  if (fd->file_type == fs::FileType::regular_file || fd->file_type == fs::FileType::directory) {
-    fs::FileStream file_stream(fd->inode);
-    file_stream.Seek(fd->offset);
-    auto fun = [&file_stream](char* buf, size_t len) -> size_t {
-      return file_stream.Read(buf, len);
-    };
-    size = safe_copy(comm::GetRawArg(1), size, fun);
-    fd->offset += size;
-  } else if (fd->file_type == fs::FileType::device) {
-    auto* r = ResourceFactory::Instance()->GetResource(fd->inode.major, fd->inode.minor);
-    if (!r) {
-      return -1;
-    }
-    auto fun = [r](char* buf, size_t len) -> size_t {
-      return r->read(buf, len);
-    };
-    size = safe_copy(comm::GetRawArg(1), size, fun);
-  } else if (fd->file_type == fs::FileType::none) {
+  return WriteFile(fd, comm::GetRawArg(1), comm::GetIntegralArg<size_t>(2));
+}
+
+int sys_read() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
+  if (!fd) {
     printf("sys_read: Invalid file_descriptor: %d\n", comm::GetIntArg(0));
     return -1;
   }
-  return size;
+  return ReadFile(fd, comm::GetRawArg(1), comm::GetIntegralArg<size_t>(2));
 }
 
 int sys_exec() {
   ProcessTask* process = Schedueler::Instance()->ThisProcess();
-  auto path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(process->page_table, comm::GetRawArg(0)));
-  char** argv = reinterpret_cast<char**>(VirtualMemory::Instance()->VAToPA(process->page_table, comm::GetRawArg(1)));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return -1;
+  }
+  uint64_t argv = comm::GetRawArg(1);
   if (!argv) {
     return -1;
   }
+  // other threads would keep running on the old image
+  if (process->mm->ref_count > 1) {
+    printf("exec: refuse to replace the image of a multithreaded process\n");
+    return -1;
+  }
   fs::InodeDef inode{};
   auto inode_index = fs::Open(path_name, &inode);
   if (inode_index < 0) {
     return -1;
   }
-  auto* new_page = VirtualMemory::Instance()->Alloc();
-  if (!new_page) {
+  void* task_mem = kzalloc(sizeof(ProcessTask));
+  if (!task_mem) {
     return -1;
   }
-  if (sizeof(ProcessTask) > memory_layout::PGSIZE) {
-    kernel::panic("page size cannot cantain ProcessTask");
-  }
-  ProcessTask* tmp_process_task = reinterpret_cast<ProcessTask*>(new_page);
+  ProcessTask* tmp_process_task = new (task_mem) ProcessTask;
   tmp_process_task->kernel_sp = process->kernel_sp;
   if (!tmp_process_task->Init(false)) {
+    kfree(tmp_process_task);
     return -1;
   }
-  CriticalGuard guard;
+  // the new image goes into a private address space, nothing else can see it until the switch below
   fs::FileStream filestream(inode);
   int ret = ExecuteImpl(&filestream, tmp_process_task);
   if (ret < 0) {
-    tmp_process_task->FreePageTable(false);
+    tmp_process_task->ReleaseMemory(false);
+    kfree(tmp_process_task);
     return -1;
   }
+  // strings are copied onto the new stack from its top, the pointer array goes below them
+  constexpr int max_argc = 16;
   auto user_sp_begin = reinterpret_cast<uint64_t>(tmp_process_task->user_sp) + memory_layout::PGSIZE;
   uint64_t user_sp = user_sp_begin;
-  uint64_t argv_addr[17];
+  uint64_t argv_addr[max_argc + 1];
   int argc = 0;
+  bool argv_valid = true;
   for (argc = 0; ; argc++) {
-    if (!argv[argc]) {
-      user_sp -= (argc + 1) * 8;
-      user_sp -= user_sp % 16;
+    uint64_t str = 0;
+    if (argc > max_argc || !copy_from_user(&str, argv + argc * sizeof(uint64_t), sizeof(str))) {
+      argv_valid = false;
+      break;
+    }
+    if (!str) {
       argv_addr[argc] = 0;
       break;
     }
-    const char* str = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(process->page_table, reinterpret_cast<uint64_t>(argv[argc])));
-    user_sp -= strlen(str) + 1;
+    // fetch the string into the free space above the pointer array, then move it up
+    uint64_t free_beg = reinterpret_cast<uint64_t>(tmp_process_task->user_sp) + (max_argc + 4) * sizeof(uint64_t);
+    if (user_sp <= free_beg + 16) {
+      argv_valid = false;
+      break;
+    }
+    char* dst = reinterpret_cast<char*>(free_beg);
+    int64_t len = strncpy_from_user(dst, str, user_sp - free_beg - 16);
+    if (len < 0) {
+      argv_valid = false;
+      break;
+    }
+    user_sp -= len + 1;
     user_sp -= user_sp % 16;
+    std::copy_backward(dst, dst + len + 1, reinterpret_cast<char*>(user_sp) + len + 1);
     argv_addr[argc] = tmp_process_task->frame->sp - (user_sp_begin - user_sp);
-    std::copy(str, str + strlen(str) + 1, reinterpret_cast<char*>(user_sp));
   }
+  if (!argv_valid) {
+    tmp_process_task->ReleaseMemory(false);
+    kfree(tmp_process_task);
+    return -1;
+  }
+  user_sp -= (argc + 1) * 8;
+  user_sp -= user_sp % 16;
   std::copy(argv_addr, argv_addr + argc + 1, reinterpret_cast<uint64_t*>(user_sp));
   tmp_process_task->frame->sp -= user_sp_begin - user_sp;
   tmp_process_task->frame->a1 = tmp_process_task->frame->sp;
-  process->FreePageTable(false);
-  process->CopyMemoryFrom(tmp_process_task);
-  VirtualMemory::Instance()->FreePage(new_page);
+  {
+    CriticalGuard guard(&process->lock);
+    process->ReleaseMemory(false);
+    process->CopyMemoryFrom(tmp_process_task);
+  }
+  AsidAllocator::Instance()->Flush(process->mm);
+  kfree(tmp_process_task);
   return argc;
 }
 
 int sys_sleep() {
-  uint64_t current_tick = Schedueler::Instance()->SystemTick();
   auto sleep_time = comm::GetIntegralArg<uint64_t>(0);
-  while ((Schedueler::Instance()->SystemTick() - current_tick) < sleep_time) {
-    Schedueler::Instance()->Sleep(GlobalChannel::sleep_channel());
+  uint64_t deadline = TimerManager::Now() + sleep_time * system_param::TIMER_INTERVAL;
+  if (Schedueler::Instance()->SleepUntil(deadline)) {
+    return 0;
+  }
+  // remaining ticks, rounded up
+  uint64_t now = TimerManager::Now();
+  if (now >= deadline) {
+    return 0;
+  }
+  return (deadline - now + system_param::TIMER_INTERVAL - 1) / system_param::TIMER_INTERVAL;
+}
+
+int sys_nanosleep() {
+  time_def::timespec req{};
+  if (!comm::GetUserArg(0, &req) || req.tv_sec < 0 || req.tv_nsec < 0 || req.tv_nsec >= time_def::NSEC_PER_SEC) {
+    return -1;
+  }
+  uint64_t start = TimerManager::Now();
+  uint64_t duration = TimerManager::NsToMtime(req.tv_sec * time_def::NSEC_PER_SEC + req.tv_nsec);
+  if (Schedueler::Instance()->SleepUntil(start + duration)) {
+    return 0;
+  }
+  if (comm::GetRawArg(1)) {
+    uint64_t elapsed = TimerManager::Now() - start;
+    uint64_t remain_ns = elapsed < duration ? TimerManager::MtimeToNs(duration - elapsed) : 0;
+    time_def::timespec rem{static_cast<int64_t>(remain_ns / time_def::NSEC_PER_SEC), static_cast<int64_t>(remain_ns % time_def::NSEC_PER_SEC)};
+    comm::PutUserArg(1, rem);
+  }
+  return -1;
+}
+
+// only the caller's own thread group and its descendants can be changed
+static ProcessTask* SchedTarget(int pid) {
+  auto* self = Schedueler::Instance()->ThisProcess();
+  if (pid == 0) {
+    return self;
+  }
+  auto* task = Schedueler::Instance()->FindProc(pid);
+  if (!task || !Schedueler::Instance()->IsDescendant(self, task)) {
+    return nullptr;
+  }
+  return task;
+}
+
+int sys_nice() {
+  auto* process = Schedueler::Instance()->ThisProcess();
+  int nice = process->se.nice + comm::GetIntArg(0);
+  nice = std::clamp(nice, sched_def::NICE_MIN, sched_def::NICE_MAX);
+  return Schedueler::Instance()->SetNice(process, nice) ? 0 : -1;
+}
+
+int sys_setpriority() {
+  auto* task = SchedTarget(comm::GetIntArg(0));
+  if (!task) {
+    return -1;
+  }
+  return Schedueler::Instance()->SetNice(task, comm::GetIntArg(1)) ? 0 : -1;
+}
+
+int sys_sched_setscheduler() {
+  auto* self = Schedueler::Instance()->ThisProcess();
+  auto* task = SchedTarget(comm::GetIntArg(0));
+  int policy = comm::GetIntArg(1);
+  if (!task) {
+    return -1;
   }
-  if ((Schedueler::Instance()->SystemTick() - current_tick) >= sleep_time) {
+  // a real time task can starve everything else, the shell that would kill
+  // it included, so only init and tasks which already are real time hand it out
+  if (policy != sched_def::normal && self->Leader() != Schedueler::Instance()->GetInitProcess() &&
+      self->se.policy == sched_def::normal) {
+    return -1;
+  }
+  return Schedueler::Instance()->SetPolicy(task, policy, comm::GetIntArg(2)) ? 0 : -1;
+}
+
+int sys_trace_ctl() {
+  auto* tracer = Tracer::Instance();
+  switch (comm::GetIntArg(0)) {
+  case trace_def::stop:
+    tracer->SetEnabled(false);
+    return 0;
+  case trace_def::start:
+    tracer->SetEnabled(true);
+    return 0;
+  case trace_def::clear:
+    tracer->Clear();
+    return 0;
+  case trace_def::dropped:
+    return tracer->Dropped();
+  default:
+    return -1;
+  }
+}
+
+int sys_trace_read() {
+  uint64_t dst = comm::GetRawArg(0);
+  int max_num = comm::GetIntArg(1);
+  // bounce through the kernel stack, rings are read with interrupts off
+  trace_def::record records[16];
+  int num = 0;
+  while (num < max_num) {
+    size_t want = std::min<size_t>(max_num - num, std::size(records));
+    size_t got = Tracer::Instance()->Read(records, want);
+    if (got == 0) {
+      break;
+    }
+    if (!copy_to_user(dst + num * sizeof(trace_def::record), records, got * sizeof(trace_def::record))) {
+      return -1;
+    }
+    num += got;
+  }
+  return num;
+}
+
+int sys_prof_ctl() {
+  auto* profiler = Profiler::Instance();
+  switch (comm::GetIntArg(0)) {
+  case prof_def::stop:
+    profiler->Stop();
     return 0;
+  case prof_def::start:
+    return profiler->Start(TimerManager::NsToMtime(comm::GetRawArg(1) * 1000)) ? 0 : -1;
+  case prof_def::dropped:
+    return profiler->Dropped();
+  default:
+    return -1;
+  }
+}
+
+int sys_prof_read() {
+  uint64_t dst = comm::GetRawArg(0);
+  int max_num = comm::GetIntArg(1);
+  prof_def::sample samples[4];
+  int num = 0;
+  while (num < max_num) {
+    size_t want = std::min<size_t>(max_num - num, std::size(samples));
+    size_t got = Profiler::Instance()->Read(samples, want);
+    if (got == 0) {
+      break;
+    }
+    if (!copy_to_user(dst + num * sizeof(prof_def::sample), samples, got * sizeof(prof_def::sample))) {
+      return -1;
+    }
+    num += got;
+  }
+  return num;
+}
+
+int sys_perf_open() {
+  return Schedueler::Instance()->ThisProcess()->perf.Open(comm::GetIntArg(0), comm::GetRawArg(1));
+}
+
+int sys_perf_ctl() {
+  return Schedueler::Instance()->ThisProcess()->perf.Control(comm::GetIntArg(0), comm::GetIntArg(1)) ? 0 : -1;
+}
+
+int sys_perf_read() {
+  uint64_t value = 0;
+  if (!Schedueler::Instance()->ThisProcess()->perf.Read(comm::GetIntArg(0), &value)) {
+    return -1;
+  }
+  return comm::PutUserArg(1, value) ? 0 : -1;
+}
+
+int sys_clock_gettime() {
+  int clock_id = comm::GetIntArg(0);
+  if (clock_id != time_def::realtime && clock_id != time_def::monotonic) {
+    return -1;
+  }
+  uint64_t ns = TimerManager::MtimeToNs(TimerManager::Now());
+  time_def::timespec ts{static_cast<int64_t>(ns / time_def::NSEC_PER_SEC), static_cast<int64_t>(ns % time_def::NSEC_PER_SEC)};
+  if (!comm::PutUserArg(1, ts)) {
+    return -1;
+  }
+  return 0;
+}
+
+// the iovec array of arg order, false if it does not fit uio_def::MAX_IOV
+static bool GetIovecArg(int order, int iov_num, uio_def::iovec* iov) {
+  if (iov_num < 0 || iov_num > uio_def::MAX_IOV) {
+    return false;
+  }
+  return copy_from_user(iov, comm::GetRawArg(order), iov_num * sizeof(uio_def::iovec));
+}
+
+template <bool is_write>
+static int VectoredIo() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
+  uio_def::iovec iov[uio_def::MAX_IOV];
+  int iov_num = comm::GetIntArg(2);
+  if (!fd || !GetIovecArg(1, iov_num, iov)) {
+    return -1;
+  }
+  return TransferFile<is_write>(fd, iov, iov_num, &fd->offset);
+}
+
+int sys_readv() {
+  return VectoredIo<false>();
+}
+
+int sys_writev() {
+  return VectoredIo<true>();
+}
+
+// at the offset given by the last arg, the one of the fd stays as it is
+template <bool is_write>
+static int PositionalIo() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
+  // devices and pipes have no position
+  if (!fd || fd->file_type == fs::FileType::device || fd->file_type == fs::FileType::pipe) {
+    return -1;
+  }
+  uio_def::iovec iov{reinterpret_cast<void*>(comm::GetRawArg(1)), comm::GetIntegralArg<size_t>(2)};
+  uint64_t offset = comm::GetRawArg(3);
+  return TransferFile<is_write>(fd, &iov, 1, &offset);
+}
+
+int sys_pread() {
+  return PositionalIo<false>();
+}
+
+int sys_pwrite() {
+  return PositionalIo<true>();
+}
+
+// the new offset is put into the last arg
+int sys_lseek() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
+  if (!fd || fd->file_type == fs::FileType::device || fd->file_type == fs::FileType::pipe) {
+    return -1;
+  }
+  auto offset = comm::GetIntegralArg<int64_t>(1);
+  int whence = comm::GetIntArg(2);
+  int64_t base = 0;
+  if (whence == uio_def::cur) {
+    base = fd->offset;
+  } else if (whence == uio_def::end) {
+    // the content of /proc files is generated on read, there is no size
+    if (fd->file_type == fs::FileType::proc) {
+      return -1;
+    }
+    base = fd->inode.size;
+  } else if (whence != uio_def::set) {
+    return -1;
+  }
+  // base is never past fs::MAX_FILE_SIZE, so neither bound can overflow
+  if (offset < -base || offset > static_cast<int64_t>(fs::MAX_FILE_SIZE) - base) {
+    return -1;
+  }
+  uint64_t result = base + offset;
+  if (!comm::PutUserArg(3, result)) {
+    return -1;
+  }
+  fd->offset = result;
+  return 0;
+}
+
+// Copies up to size bytes from the regular file in at *in_offset to out,
+// a regular file at *out_offset or a device, through a kernel page
+// instead of user memory. Both offsets advance by the bytes copied. A file
+// is not copied onto itself, the offsets of an fd could alias each other.
+static int64_t CopyFileData(fs::FileDescriptor* in, uint64_t* in_offset, fs::FileDescriptor* out, uint64_t* out_offset, size_t size) {
+  if (in->file_type != fs::FileType::regular_file) {
+    return -1;
+  }
+  Resource* r = nullptr;
+  if (out->file_type == fs::FileType::device) {
+    r = ResourceFactory::Instance()->GetResource(out->inode.major, out->inode.minor);
+    if (!r) {
+      return -1;
+    }
+  } else if (out->file_type != fs::FileType::regular_file || out->inode_index == in->inode_index) {
+    return -1;
+  } else if (*out_offset > fs::MAX_FILE_SIZE) {
+    return -1;
   } else {
-    return sleep_time - (Schedueler::Instance()->SystemTick() - current_tick);
+    size = std::min<uint64_t>(size, fs::MAX_FILE_SIZE - *out_offset);
   }
+  if (*in_offset >= in->inode.size) {
+    return 0;
+  }
+  auto* buf = reinterpret_cast<char*>(VirtualMemory::Instance()->Alloc());
+  if (!buf) {
+    return -1;
+  }
+  fs::FileStream in_stream(in->inode);
+  in_stream.Seek(*in_offset);
+  fs::FileStream out_stream(out->inode);
+  if (!r) {
+    out_stream.Seek(*out_offset);
+  }
+  int64_t total = 0;
+  while (size > 0) {
+    size_t len = in_stream.Read(buf, std::min<size_t>(size, memory_layout::PGSIZE));
+    if (len == 0) {
+      break;
+    }
+    size_t written = r ? r->write(buf, len) : out_stream.write(buf, len);
+    total += written;
+    size -= written;
+    if (written < len) {
+      break;
+    }
+  }
+  VirtualMemory::Instance()->FreePage(reinterpret_cast<uint64_t*>(buf));
+  *in_offset += total;
+  if (!r) {
+    *out_offset += total;
+  }
+  return total;
 }
 
-int sys_open() {
-  auto root_page = Schedueler::Instance()->ThisProcess()->page_table;
-  auto path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(root_page, comm::GetRawArg(0)));
+// a user offset given by arg order or, without one, the fd offset
+class OffsetArg {
+ public:
+  OffsetArg(int order, fs::FileDescriptor* fd) : user_(comm::GetRawArg(order)), offset_(&fd->offset) {
+    if (user_) {
+      ok_ = copy_from_user(&value_, user_, sizeof(value_));
+      offset_ = &value_;
+    }
+  }
+
+  bool ok() const {
+    return ok_;
+  }
+
+  uint64_t* get() {
+    return offset_;
+  }
+
+  // hand the advanced offset back to the user
+  bool Store() const {
+    return !user_ || copy_to_user(user_, &value_, sizeof(value_));
+  }
+
+ private:
+  uint64_t user_;
+  uint64_t value_ = 0;
+  uint64_t* offset_;
+  bool ok_ = true;
+};
+
+int sys_sendfile() {
+  FileRef out_ref(comm::GetIntArg(0));
+  FileRef in_ref(comm::GetIntArg(1));
+  fs::FileDescriptor* out = out_ref.get();
+  fs::FileDescriptor* in = in_ref.get();
+  if (!out || !in) {
+    return -1;
+  }
+  OffsetArg in_offset(2, in);
+  if (!in_offset.ok()) {
+    return -1;
+  }
+  uint64_t out_offset = out->offset;
+  int64_t ret = CopyFileData(in, in_offset.get(), out, &out_offset, comm::GetIntegralArg<size_t>(3));
+  if (ret < 0 || !in_offset.Store()) {
+    return -1;
+  }
+  // the destination always moves on like with write
+  out->offset = out_offset;
+  return ret;
+}
+
+int sys_copy_file_range() {
+  FileRef in_ref(comm::GetIntArg(0));
+  FileRef out_ref(comm::GetIntArg(2));
+  fs::FileDescriptor* in = in_ref.get();
+  fs::FileDescriptor* out = out_ref.get();
+  if (!in || !out || out->file_type != fs::FileType::regular_file) {
+    return -1;
+  }
+  OffsetArg in_offset(1, in);
+  OffsetArg out_offset(3, out);
+  if (!in_offset.ok() || !out_offset.ok()) {
+    return -1;
+  }
+  int64_t ret = CopyFileData(in, in_offset.get(), out, out_offset.get(), comm::GetIntegralArg<size_t>(4));
+  if (ret < 0 || !in_offset.Store() || !out_offset.Store()) {
+    return -1;
+  }
+  return ret;
+}
+
+static int OpenFile(const char* path_name) {
+  // /proc is not on disk, it is matched before looking the path up
+  if (ProcFs::Instance()->Covers(path_name)) {
+    fs::FileDescriptor fd{};
+    if (!ProcFs::Instance()->Open(path_name, &fd)) {
+      return -1;
+    }
+    return Schedueler::Instance()->ThisProcess()->files->Install(fd);
+  }
   fs::InodeDef inode{};
   auto inode_index = fs::Open(path_name, &inode);
   if (inode_index < 0) {
     return -1;
   }
-  auto& fds = Schedueler::Instance()->ThisProcess()->file_descriptor;
-  for (auto it = fds.begin(); it != fds.end(); ++it) {
-    if (it->file_type == fs::FileType::none) {
-      it->file_type = inode.type;
-      it->inode_index = inode_index;
-      it->inode = inode;
-      it->offset = 0;
-      return it - fds.begin();
-    }
+  fs::FileDescriptor fd{};
+  fd.file_type = inode.type;
+  fd.inode_index = inode_index;
+  fd.inode = inode;
+  return Schedueler::Instance()->ThisProcess()->files->Install(fd);
+}
+
+int sys_open() {
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return -1;
   }
-  return -1;
+  return OpenFile(path_name);
 }
 
 int sys_close() {
-  fs::FileDescriptor* fd = nullptr;
-  GetFileDescriptor(comm::GetIntArg(0), &fd);
-  if (!fd) {
+  if (!Schedueler::Instance()->ThisProcess()->files->Close(comm::GetIntArg(0))) {
     return -1;
   }
-  memset(fd, 0, sizeof(fs::FileDescriptor));
   return 0;
 }
 
+int sys_pipe() {
+  Pipe* pipe = Pipe::Create();
+  if (!pipe) {
+    return -1;
+  }
+  auto* files = Schedueler::Instance()->ThisProcess()->files;
+  fs::FileDescriptor fd{};
+  fd.file_type = fs::FileType::pipe;
+  fd.pipe = pipe;
+  int fds[2];
+  fds[0] = files->Install(fd);
+  fd.writable = true;
+  fds[1] = files->Install(fd);
+  // an installed end is closed with its slot, the others by hand
+  bool ok = fds[0] >= 0 && fds[1] >= 0 && copy_to_user(comm::GetRawArg(0), fds, sizeof(fds));
+  if (!ok) {
+    for (int i = 0; i < 2; ++i) {
+      if (fds[i] >= 0) {
+        files->Close(fds[i]);
+      } else {
+        pipe->Close(i == 1);
+      }
+    }
+    return -1;
+  }
+  return 0;
+}
+
+int sys_dup() {
+  return Schedueler::Instance()->ThisProcess()->files->Dup(comm::GetIntArg(0));
+}
+
+int sys_dup2() {
+  return Schedueler::Instance()->ThisProcess()->files->Dup2(comm::GetIntArg(0), comm::GetIntArg(1));
+}
+
+// the name of arg order, an empty one for a null pointer
+static bool GetShmNameArg(int order, char* name) {
+  if (!comm::GetRawArg(order)) {
+    name[0] = '\0';
+    return true;
+  }
+  return comm::GetStrArg(order, name, mman_def::MAX_SHM_NAME) >= 0;
+}
+
+// a null name creates an anonymous segment, shared only through the fd
+// and fork, a named one is opened if it exists and created otherwise
+int sys_shm_open() {
+  char name[mman_def::MAX_SHM_NAME];
+  if (!GetShmNameArg(0, name)) {
+    return -1;
+  }
+  ShmSegment* segment = ShmSegment::OpenOrCreate(name, comm::GetIntegralArg<size_t>(1));
+  if (!segment) {
+    return -1;
+  }
+  fs::FileDescriptor fd{};
+  fd.file_type = fs::FileType::shm;
+  fd.shm = segment;
+  int index = Schedueler::Instance()->ThisProcess()->files->Install(fd);
+  if (index < 0) {
+    ShmSegment::Put(segment);
+  }
+  return index;
+}
+
+int sys_shm_unlink() {
+  char name[mman_def::MAX_SHM_NAME];
+  if (!GetShmNameArg(0, name) || !name[0]) {
+    return -1;
+  }
+  return ShmSegment::Unlink(name) ? 0 : -1;
+}
+
+// the address goes back through the last arg, it does not fit the return value
+int sys_mmap() {
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
+  if (!fd || fd->file_type != fs::FileType::shm) {
+    return -1;
+  }
+  auto length = comm::GetIntegralArg<size_t>(1);
+  int prot = comm::GetIntArg(2);
+  size_t pages = length ? VirtualMemory::AddrCastUp(length) / memory_layout::PGSIZE : fd->shm->Pages();
+  if (!(prot & mman_def::read) || pages > fd->shm->Pages()) {
+    return -1;
+  }
+  auto* mm = Schedueler::Instance()->ThisProcess()->mm;
+  uint64_t va = mm->MapShared(fd->shm, pages, prot & mman_def::write);
+  if (!va) {
+    return -1;
+  }
+  if (!comm::PutUserArg(3, va)) {
+    mm->UnmapShared(va);
+    return -1;
+  }
+  return 0;
+}
+
+int sys_munmap() {
+  return Schedueler::Instance()->ThisProcess()->mm->UnmapShared(comm::GetRawArg(0)) ? 0 : -1;
+}
+
+static bool StatFile(const fs::FileDescriptor* fd, uint64_t dst) {
+  fs::FileState f_stat{};
+  f_stat.inode_index = fd->inode_index;
+  f_stat.link_count = fd->inode.link_count;
+  f_stat.size = fd->inode.size;
+  f_stat.type = fd->file_type;
+  if (fd->file_type == fs::FileType::proc) {
+    f_stat.type = fd->inode.type;
+  } else if (fd->file_type == fs::FileType::shm) {
+    f_stat.size = fd->shm->Pages() * memory_layout::PGSIZE;
+  }
+  return copy_to_user(dst, &f_stat, sizeof(f_stat));
+}
+
 int sys_fstat() {
-  fs::FileDescriptor* fd = nullptr;
-  GetFileDescriptor(comm::GetIntArg(0), &fd);
+  FileRef fd_ref(comm::GetIntArg(0));
+  fs::FileDescriptor* fd = fd_ref.get();
   if (!fd) {
     return -1;
   }
-  uint64_t addr = comm::GetRawArg(1);
-  if (!addr) {
+  if (!StatFile(fd, comm::GetRawArg(1))) {
     return -1;
   }
-  auto* root_page = Schedueler::Instance()->ThisProcess()->page_table;
-  auto f_stat = reinterpret_cast<fs::FileState*>(VirtualMemory::Instance()->VAToPA(root_page, addr));
-  f_stat->inode_index = fd->inode_index;
-  f_stat->link_count = fd->inode.link_count;
-  f_stat->size = fd->inode.size;
-  f_stat->type = fd->file_type;
   return 0;
 }
 
 int sys_mknod() {
-  auto root_page = Schedueler::Instance()->ThisProcess()->page_table;
-  auto path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(root_page, comm::GetRawArg(0)));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return -1;
+  }
   uint8_t major = comm::GetIntArg(1);
   uint8_t minor = comm::GetIntArg(2);
   bool ret = fs::Create(path_name, fs::FileType::device, major, minor);
@@ -251,7 +868,7 @@ int sys_mknod() {
 }
 
 int sys_getpid() {
-  return Schedueler::Instance()->ThisProcess()->pid;
+  return Schedueler::Instance()->ThisProcess()->Leader()->pid;
 }
 
 int sys_exit() {
@@ -260,46 +877,106 @@ int sys_exit() {
   return 0;
 }
 
-int sys_wait() {
+static rusage_def::rusage ToRusage(const TaskUsage& usage) {
+  auto to_timespec = [](uint64_t mtime) {
+    uint64_t ns = TimerManager::MtimeToNs(mtime);
+    return time_def::timespec{static_cast<int64_t>(ns / time_def::NSEC_PER_SEC), static_cast<int64_t>(ns % time_def::NSEC_PER_SEC)};
+  };
+  return rusage_def::rusage{
+    to_timespec(usage.utime),
+    to_timespec(usage.stime),
+    usage.nvcsw,
+    usage.nivcsw,
+    usage.nfault,
+    usage.inblock,
+    usage.oublock,
+  };
+}
+
+// reap a zombie child, or the child pid if it is not -1
+static int WaitChild(int pid, uint64_t exit_code_addr, uint64_t usage_addr) {
   auto* process = Schedueler::Instance()->ThisProcess();
   while (true) {
+    if (process->killed) {
+      return -1;
+    }
     bool has_child;
     ProcessTask* child;
-    std::tie(has_child, child) = Schedueler::Instance()->FindFirslZombieChild(process);
+    std::tie(has_child, child) = Schedueler::Instance()->FindFirslZombieChild(process, pid);
     if (!has_child) {
       return -1;
     }
     if (child) {
-      CriticalGuard guard(&child->lock);
-      int pid = child->pid;
-      if (comm::GetRawArg(0)) {
-        auto addr = reinterpret_cast<int*>(VirtualMemory::Instance()->VAToPA(process->page_table, comm::GetRawArg(0)));
-        *addr = child->exit_code;
+      int child_pid = child->pid;
+      TaskUsage usage;
+      {
+        CriticalGuard guard(&child->lock);
+        if (exit_code_addr) {
+          copy_to_user(exit_code_addr, &child->exit_code, sizeof(child->exit_code));
+        }
+        usage = child->usage;
+        usage.Add(child->child_usage);
+        process->Leader()->child_usage.Add(usage);
+        ProcessManager::ResetProcess(child);
+      }
+      Schedueler::Instance()->FreeProc(child);
+      if (usage_addr) {
+        rusage_def::rusage ru = ToRusage(usage);
+        copy_to_user(usage_addr, &ru, sizeof(ru));
       }
-      ProcessManager::ResetProcess(child);
-      return pid;
+      return child_pid;
     }
     Schedueler::Instance()->Sleep(&process->owned_channel);
   }
   return 0;
 }
 
+int sys_wait() {
+  return WaitChild(-1, comm::GetRawArg(0), 0);
+}
+
+int sys_wait4() {
+  return WaitChild(comm::GetIntArg(0), comm::GetRawArg(1), comm::GetRawArg(2));
+}
+
+int sys_getrusage() {
+  auto* process = Schedueler::Instance()->ThisProcess();
+  TaskUsage usage;
+  int who = comm::GetIntArg(0);
+  if (who == rusage_def::self) {
+    // bring the running thread's kernel time up to date
+    process->AccountKernelTime();
+    usage = Schedueler::Instance()->GroupUsage(process->Leader());
+  } else if (who == rusage_def::children) {
+    usage = process->Leader()->child_usage;
+  } else {
+    return -1;
+  }
+  if (!comm::PutUserArg(1, ToRusage(usage))) {
+    return -1;
+  }
+  return 0;
+}
+
 int sys_getcwd() {
   auto* process = Schedueler::Instance()->ThisProcess();
-  auto addr = reinterpret_cast<char*>(VirtualMemory::Instance()->VAToPA(process->page_table, comm::GetRawArg(0)));
   auto max_len = comm::GetIntegralArg<size_t>(1);
   size_t path_len = strlen(process->current_path);
   if (path_len > max_len) {
     return -1;
   }
-  std::copy(process->current_path, process->current_path + path_len, addr);
-  addr[path_len] = '\0';
+  if (!copy_to_user(comm::GetRawArg(0), process->current_path, path_len + 1)) {
+    return -1;
+  }
   return 0;
 }
 
 int sys_chdir() {
   auto* process = Schedueler::Instance()->ThisProcess();
-  const char* path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(process->page_table, comm::GetRawArg(0)));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return return_code::no_such_file_or_directory;
+  }
   fs::InodeDef inode{};
   auto inode_index = fs::Open(path_name, &inode);
   if (inode_index < 0) {
@@ -311,6 +988,9 @@ int sys_chdir() {
   auto path_len = strlen(path_name);
   if (path_name[0] != '/') {
     auto cur_path_len = strlen(process->current_path);
+    if (cur_path_len + path_len + 2 > sizeof(process->current_path)) {
+      return return_code::no_such_file_or_directory;
+    }
     if (process->current_path[cur_path_len - 1] != '/') {
       process->current_path[cur_path_len] = '/';
       process->current_path[cur_path_len + 1] = '\0';
@@ -328,8 +1008,10 @@ int sys_chdir() {
 }
 
 int sys_mkdir() {
-  auto root_page = Schedueler::Instance()->ThisProcess()->page_table;
-  auto path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(root_page, comm::GetRawArg(0)));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return -1;
+  }
   bool ret = fs::Create(path_name, fs::FileType::directory, 0, 0);
   if (!ret) {
     return -1;
@@ -340,7 +1022,7 @@ int sys_mkdir() {
 int sys_sbrk() {
   auto* process = Schedueler::Instance()->ThisProcess();
   uint32_t bytes = comm::GetIntegralArg<uint32_t>(0);
-  return process->ExpandMemory(bytes);
+  return process->mm->ExpandMemory(bytes);
 }
 
 int sys_uptime() {
@@ -349,8 +1031,10 @@ int sys_uptime() {
 }
 
 int sys_create() {
-  auto root_page = Schedueler::Instance()->ThisProcess()->page_table;
-  auto path_name = reinterpret_cast<const char*>(VirtualMemory::Instance()->VAToPA(root_page, comm::GetRawArg(0)));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    return -1;
+  }
   fs::FileType file_type = static_cast<fs::FileType>(comm::GetIntArg(1));
   if (file_type != fs::FileType::directory && file_type != fs::FileType::regular_file) {
     return -1;
@@ -360,29 +1044,23 @@ int sys_create() {
   if (!ret) {
     return -1;
   }
-  auto& fds = Schedueler::Instance()->ThisProcess()->file_descriptor;
-  for (auto it = fds.begin(); it != fds.end(); ++it) {
-    if (it->file_type == fs::FileType::none) {
-      it->file_type = file_type;
-      it->inode_index = target_inode.inode_index;
-      it->inode = target_inode;
-      it->offset = 0;
-      return it - fds.begin();
-    }
-  }
-  return -1;
+  fs::FileDescriptor fd{};
+  fd.file_type = file_type;
+  fd.inode_index = target_inode.inode_index;
+  fd.inode = target_inode;
+  return Schedueler::Instance()->ThisProcess()->files->Install(fd);
 }
 
 int sys_get_screen_info() {
-  auto* info = comm::GetAddrArg<device_info::screen_info>(0);
-  if (!info) {
+  auto* gpu_device = reinterpret_cast<driver::virtio::GPUDevice*>(driver::DeviceFactory::Instance()->GetDevice(driver::DeviceList::gpu0));
+  driver::virtio::gpu::virtio_gpu_resp_display_info display_info = gpu_device->GetDisplayInfo();
+  device_info::screen_info info{};
+  info.height = display_info.pmodes[0].r.height;
+  info.width = display_info.pmodes[0].r.width;
+  if (!comm::PutUserArg(0, info)) {
     printf("sys_get_screen_info: invalid addr: \n");
     return -1;
   }
-  auto* gpu_device = reinterpret_cast<driver::virtio::GPUDevice*>(driver::DeviceFactory::Instance()->GetDevice(driver::DeviceList::gpu0));
-  driver::virtio::gpu::virtio_gpu_resp_display_info display_info = gpu_device->GetDisplayInfo();
-  info->height = display_info.pmodes[0].r.height;
-  info->width = display_info.pmodes[0].r.width;
   return 0;
 }
 
@@ -392,7 +1070,7 @@ int sys_framebuffer() {
   driver::virtio::gpu::virtio_gpu_resp_display_info info = gpu_device->GetDisplayInfo();
   auto& rect = info.pmodes[0].r;
   size_t memory_size = rect.height * rect.width * 4;
-  uint64_t addr = process->ExpandMemory(memory_size);
+  uint64_t addr = process->mm->ExpandMemory(memory_size);
   bool map_ret = gpu_device->SetupFramebuffer(rect, 0, addr, memory_size);
   if (!map_ret) {
     return 0;
@@ -430,12 +1108,15 @@ int sys_detach_framebuffer() {
 
 int sys_dlopen() {
   ProcessTask* process = Schedueler::Instance()->ThisProcess();
-  if (process->dynamic_info.dynamic_vaddr == 0 || process->dynamic_info.dynamic_size == 0) {
+  if (process->mm->dynamic_info.dynamic_vaddr == 0 || process->mm->dynamic_info.dynamic_size == 0) {
     printf("dlopen: No dynamic symbol needed\n");
     return 0;
   }
-  char path_name[64];
-  comm::GetStrArg(0, path_name, sizeof(path_name));
+  char path_name[fs::MAX_PATH_LEN];
+  if (comm::GetStrArg(0, path_name, sizeof(path_name)) < 0) {
+    printf("dlopen: Invalid path\n");
+    return -1;
+  }
   fs::InodeDef inode{};
   auto inode_index = fs::Open(path_name, &inode);
   if (inode_index < 0) {
@@ -443,31 +1124,189 @@ int sys_dlopen() {
     return -1;
   }
   printf("dlopen: Loading symbol from %s\n", path_name);
-  CriticalGuard guard;
   fs::FileStream filestream(inode);
-  uint64_t max_mem_addr = 0;
-  for (size_t i = 0; i < process->used_address_size; i++) {
-    if (process->used_address[i].second > max_mem_addr) {
-      max_mem_addr = process->used_address[i].second;
+  uint64_t init_array_beg, init_array_end;
+  {
+    // other threads keep running, only layout changes of this address space wait
+    LockGuard<Mutex> guard(&process->mm->map_lock);
+    DynamicLoader dynamic_loader(&filestream, process, VirtualMemory::AddrCastUp(process->mm->MaxAddress()));
+    DynamicInfo dynamic_info;
+    if (!dynamic_loader.Load(ET_DYN, nullptr, &dynamic_info)) {
+      return -1;
+    }
+    if (!dynamic_loader.LoadDynamicInfo(&dynamic_info, &init_array_beg, &init_array_end)) {
+      return -1;
     }
   }
-  DynamicLoader dynamic_loader(&filestream, process, VirtualMemory::AddrCastUp(max_mem_addr));
-  DynamicInfo dynamic_info;
-  if (!dynamic_loader.Load(ET_DYN, nullptr, &dynamic_info)) {
+  AsidAllocator::Instance()->Flush(process->mm);
+  process->frame->a1 = init_array_beg;
+  process->frame->a2 = init_array_end;
+  return 0;
+}
+
+int sys_dlclose() {
+  return 0;
+}
+
+int sys_clone() {
+  auto* process = Schedueler::Instance()->ThisProcess();
+  uint64_t entry = comm::GetRawArg(0);
+  if (!entry) {
     return -1;
   }
-  uint64_t init_array_beg, init_array_end;
-  if (!dynamic_loader.LoadDynamicInfo(&dynamic_info, &init_array_beg, &init_array_end)) {
+  auto* thread = Schedueler::Instance()->AllocThread(process, entry, comm::GetRawArg(1));
+  if (!thread) {
     return -1;
   }
-  process->frame->a1 = init_array_beg;
-  process->frame->a2 = init_array_end;
+  thread->name = process->name;
+  Schedueler::Instance()->WakeNewTask(thread, process);
+  return thread->pid;
+}
+
+int sys_thread_exit() {
+  int exit_code = comm::GetIntArg(0);
+  auto* process = Schedueler::Instance()->ThisProcess();
+  // the leader owns the process, its exit ends the whole group
+  if (!process->group_leader) {
+    Schedueler::Instance()->Exit(exit_code);
+  }
+  Schedueler::Instance()->ExitThread(exit_code);
   return 0;
 }
 
-int sys_dlclose() {
+// futex waiters sleep on the physical address of the word, so processes
+// mapping the same page meet on the same channel
+static SpinLock futex_lock;
+
+static uint32_t* FutexWord(uint64_t uaddr) {
+  if (uaddr % sizeof(uint32_t) != 0) {
+    return nullptr;
+  }
+  UserTranslator translator(Schedueler::Instance()->ThisProcess()->mm->page_table);
+  return reinterpret_cast<uint32_t*>(translator.Translate(uaddr, riscv::PTE::W));
+}
+
+int sys_futex_wait() {
+  uint32_t* word = FutexWord(comm::GetRawArg(0));
+  if (!word) {
+    return -1;
+  }
+  auto expected = comm::GetIntegralArg<uint32_t>(1);
+  auto* process = Schedueler::Instance()->ThisProcess();
+  // a waker has to take futex_lock, so it cannot slip in between the check and the sleep
+  CriticalGuard guard(&futex_lock);
+  if (__atomic_load_n(word, __ATOMIC_ACQUIRE) != expected || process->killed) {
+    return -1;
+  }
+  Channel channel(word);
+  Schedueler::Instance()->Sleep(&channel, &futex_lock);
   return 0;
 }
 
+int sys_futex_wake() {
+  uint32_t* word = FutexWord(comm::GetRawArg(0));
+  if (!word) {
+    return -1;
+  }
+  int max_num = comm::GetIntArg(1);
+  if (max_num <= 0) {
+    return 0;
+  }
+  CriticalGuard guard(&futex_lock);
+  Channel channel(word);
+  return Schedueler::Instance()->Wakeup(&channel, max_num);
+}
+
+int sys_thread_join() {
+  int exit_code = 0;
+  int tid = Schedueler::Instance()->Join(comm::GetIntArg(0), &exit_code);
+  if (tid < 0) {
+    return -1;
+  }
+  if (comm::GetRawArg(1)) {
+    comm::PutUserArg(1, exit_code);
+  }
+  return tid;
+}
+
+static int64_t ExecuteSqe(const io_def::sqe& sqe) {
+  if (sqe.opcode == io_def::nop) {
+    return 0;
+  }
+  if (sqe.opcode == io_def::open) {
+    char path_name[fs::MAX_PATH_LEN];
+    if (strncpy_from_user(path_name, sqe.addr, sizeof(path_name)) < 0) {
+      return -1;
+    }
+    return OpenFile(path_name);
+  }
+  if (sqe.opcode == io_def::close) {
+    return Schedueler::Instance()->ThisProcess()->files->Close(sqe.fd) ? 0 : -1;
+  }
+  FileRef fd_ref(sqe.fd);
+  fs::FileDescriptor* fd = fd_ref.get();
+  if (!fd) {
+    return -1;
+  }
+  switch (sqe.opcode) {
+  case io_def::read:
+    return ReadFile(fd, sqe.addr, sqe.len);
+  case io_def::write:
+    return WriteFile(fd, sqe.addr, sqe.len);
+  case io_def::fstat:
+    return StatFile(fd, sqe.addr) ? 0 : -1;
+  default:
+    return -1;
+  }
+}
+
+int sys_io_setup() {
+  auto* mm = Schedueler::Instance()->ThisProcess()->mm;
+  LockGuard<Mutex> guard(&mm->io_lock);
+  if (!mm->io_ring) {
+    // the ring is an ordinary heap page, it is copied by fork and freed with the process
+    uint64_t va = mm->ExpandMemory(memory_layout::PGSIZE);
+    if (!va) {
+      return -1;
+    }
+    mm->io_ring = va;
+  }
+  return comm::PutUserArg(0, mm->io_ring) ? 0 : -1;
+}
+
+// Entries are run synchronously in submission order, so an entry may use
+// what an earlier one of the same call produced. Stops early when the
+// completion queue is full, returns the number of entries consumed.
+int sys_io_enter() {
+  auto* mm = Schedueler::Instance()->ThisProcess()->mm;
+  int to_submit = comm::GetIntArg(0);
+  LockGuard<Mutex> guard(&mm->io_lock);
+  if (!mm->io_ring) {
+    return -1;
+  }
+  // heap pages stay mapped as long as the process lives, the ring can be used by address
+  UserTranslator translator(mm->page_table);
+  auto* ring = reinterpret_cast<io_def::ring*>(translator.Translate(mm->io_ring, riscv::PTE::W));
+  if (!ring) {
+    return -1;
+  }
+  int submitted = 0;
+  while (submitted < to_submit) {
+    uint32_t sq_head = ring->sq_head;
+    uint32_t cq_tail = ring->cq_tail;
+    if (sq_head == __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE) ||
+        cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE) >= io_def::RING_ENTRIES) {
+      break;
+    }
+    // the process may scribble on the entry meanwhile, work on a copy
+    io_def::sqe sqe = ring->sq[sq_head % io_def::RING_ENTRIES];
+    ring->cq[cq_tail % io_def::RING_ENTRIES] = {sqe.user_data, ExecuteSqe(sqe)};
+    __atomic_store_n(&ring->cq_tail, cq_tail + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->sq_head, sq_head + 1, __ATOMIC_RELEASE);
+    submitted += 1;
+  }
+  return submitted;
+}
+
 }  // namespace syscall
 }  // namespace kernel
\ No newline at end of file
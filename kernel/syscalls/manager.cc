@@ -39,6 +39,41 @@ int (*Manager::syscalls[])(void) = {
   [SYSCALL_detach_framebuffer] = sys_detach_framebuffer,
   [SYSCALL_dlopen]             = sys_dlopen,
   [SYSCALL_dlclose]            = sys_dlclose,
+  [SYSCALL_clone]              = sys_clone,
+  [SYSCALL_thread_exit]        = sys_thread_exit,
+  [SYSCALL_thread_join]        = sys_thread_join,
+  [SYSCALL_futex_wait]         = sys_futex_wait,
+  [SYSCALL_futex_wake]         = sys_futex_wake,
+  [SYSCALL_nanosleep]          = sys_nanosleep,
+  [SYSCALL_clock_gettime]      = sys_clock_gettime,
+  [SYSCALL_nice]               = sys_nice,
+  [SYSCALL_setpriority]        = sys_setpriority,
+  [SYSCALL_sched_setscheduler] = sys_sched_setscheduler,
+  [SYSCALL_getrusage]          = sys_getrusage,
+  [SYSCALL_wait4]              = sys_wait4,
+  [SYSCALL_trace_ctl]          = sys_trace_ctl,
+  [SYSCALL_trace_read]         = sys_trace_read,
+  [SYSCALL_prof_ctl]           = sys_prof_ctl,
+  [SYSCALL_prof_read]          = sys_prof_read,
+  [SYSCALL_perf_open]          = sys_perf_open,
+  [SYSCALL_perf_ctl]           = sys_perf_ctl,
+  [SYSCALL_perf_read]          = sys_perf_read,
+  [SYSCALL_io_setup]           = sys_io_setup,
+  [SYSCALL_io_enter]           = sys_io_enter,
+  [SYSCALL_readv]              = sys_readv,
+  [SYSCALL_writev]             = sys_writev,
+  [SYSCALL_pread]              = sys_pread,
+  [SYSCALL_pwrite]             = sys_pwrite,
+  [SYSCALL_lseek]              = sys_lseek,
+  [SYSCALL_sendfile]           = sys_sendfile,
+  [SYSCALL_copy_file_range]    = sys_copy_file_range,
+  [SYSCALL_pipe]               = sys_pipe,
+  [SYSCALL_dup]                = sys_dup,
+  [SYSCALL_dup2]               = sys_dup2,
+  [SYSCALL_shm_open]           = sys_shm_open,
+  [SYSCALL_shm_unlink]         = sys_shm_unlink,
+  [SYSCALL_mmap]               = sys_mmap,
+  [SYSCALL_munmap]             = sys_munmap,
 };
 
 int Manager::Sum() {
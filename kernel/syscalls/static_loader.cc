@@ -1,6 +1,7 @@
 #include "kernel/process.h"
 #include "kernel/syscalls/static_loader.h"
 #include "kernel/printf.h"
+#include "kernel/uaccess.h"
 #include "kernel/virtual_memory.h"
 #include <elf.h>
 
@@ -22,8 +23,9 @@ static bool LoadSegment(uint64_t* root_page, lib::StreamBase* stream, uint64_t v
       dst += remain;
     }
   };
+  UserTranslator translator(root_page);
   while (size != 0) {
-    uint64_t pa = VirtualMemory::Instance()->VAToPA(root_page, va);
+    uint64_t pa = translator.Translate(va);
     if (pa == 0) {
       return false;
     }
@@ -68,7 +70,7 @@ bool StaticLoader::Load(uint8_t target_type, uint64_t* entry, DynamicInfo* dynam
     return false;
   }
 
-  uint64_t* root_page = process_->page_table;
+  uint64_t* root_page = process_->mm->page_table;
 
   for (int i = 0; i < elf64_header.e_phnum; ++i) {
     Elf64_Phdr ph;
@@ -77,7 +79,7 @@ bool StaticLoader::Load(uint8_t target_type, uint64_t* entry, DynamicInfo* dynam
     if (ph.p_type == PT_DYNAMIC) {
       DynamicInfo info{ph.p_vaddr + offset_, ph.p_memsz};
       if (target_type == ET_EXEC) {
-        process_->dynamic_info = info;
+        process_->mm->dynamic_info = info;
       }
       if (dynamic_info) {
         *dynamic_info = info;
@@ -107,14 +109,14 @@ bool StaticLoader::Load(uint8_t target_type, uint64_t* entry, DynamicInfo* dynam
       printf("exec: Load Segment failed\n");
       return false;
     }
-    if (process_->used_address_size >= process_->used_address.size()) {
+    if (process_->mm->used_address_size >= process_->mm->used_address.size()) {
       printf("exec: too many load-segment\n");
       return false;
     }
-    auto& region = process_->used_address[process_->used_address_size];
+    auto& region = process_->mm->used_address[process_->mm->used_address_size];
     region.first = va_beg;
     region.second = va_beg + ph.p_memsz;
-    process_->used_address_size += 1;
+    process_->mm->used_address_size += 1;
   }
   if (entry) {
     *entry = elf64_header.e_entry;
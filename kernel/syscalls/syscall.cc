@@ -4,12 +4,17 @@
 #include "kernel/regs_frame.hpp"
 #include "kernel/scheduler.h"
 #include "kernel/syscalls/manager.h"
+#include "kernel/trace.h"
 
 namespace kernel {
 
 void ProcessSystemCall() {
   ProcessTask* process = Schedueler::Instance()->ThisProcess();
-  process->frame->a0 = syscall::Manager::Instance()->DoWork(process->frame->a7);
+  uint64_t num = process->frame->a7;
+  Tracer::Instance()->Record(trace_def::syscall_enter, num, process->frame->a0);
+  int ret = syscall::Manager::Instance()->DoWork(num);
+  Tracer::Instance()->Record(trace_def::syscall_exit, num, ret);
+  process->frame->a0 = ret;
 }
 
 }
\ No newline at end of file
@@ -27,5 +27,40 @@
 #define SYSCALL_detach_framebuffer 23
 #define SYSCALL_dlopen 24
 #define SYSCALL_dlclose 25
+#define SYSCALL_clone 26
+#define SYSCALL_thread_exit 27
+#define SYSCALL_thread_join 28
+#define SYSCALL_futex_wait 29
+#define SYSCALL_futex_wake 30
+#define SYSCALL_nanosleep 31
+#define SYSCALL_clock_gettime 32
+#define SYSCALL_nice 33
+#define SYSCALL_setpriority 34
+#define SYSCALL_sched_setscheduler 35
+#define SYSCALL_getrusage 36
+#define SYSCALL_wait4 37
+#define SYSCALL_trace_ctl 38
+#define SYSCALL_trace_read 39
+#define SYSCALL_prof_ctl 40
+#define SYSCALL_prof_read 41
+#define SYSCALL_perf_open 42
+#define SYSCALL_perf_ctl 43
+#define SYSCALL_perf_read 44
+#define SYSCALL_io_setup 45
+#define SYSCALL_io_enter 46
+#define SYSCALL_readv 47
+#define SYSCALL_writev 48
+#define SYSCALL_pread 49
+#define SYSCALL_pwrite 50
+#define SYSCALL_lseek 51
+#define SYSCALL_sendfile 52
+#define SYSCALL_copy_file_range 53
+#define SYSCALL_pipe 54
+#define SYSCALL_dup 55
+#define SYSCALL_dup2 56
+#define SYSCALL_shm_open 57
+#define SYSCALL_shm_unlink 58
+#define SYSCALL_mmap 59
+#define SYSCALL_munmap 60
 
 #endif
@@ -3,8 +3,7 @@
 
 #include <type_traits>
 
-#include "kernel/scheduler.h"
-#include "kernel/virtual_memory.h"
+#include "kernel/uaccess.h"
 #include "lib/types.h"
 
 namespace kernel {
@@ -15,26 +14,23 @@ uint64_t GetRawArg(int order);
 void SetRawArg(int order, uint64_t value);
 int GetIntArg(int order);
 void SetIntArg(int order, int value);
-void GetStrArg(int order, char* buf, size_t size);
+// length of the string, -1 if arg is not a valid user string fitting in buf
+int64_t GetStrArg(int order, char* buf, size_t size);
 
 template <typename T, std::enable_if_t<std::is_integral_v<T>, bool> = true>
 T GetIntegralArg(int order) {
   return static_cast<T>(GetRawArg(order));
 }
 
+// copy a value from / to the user address given by arg, false on fault
 template <typename T>
-T* GetAddrArg(int order) {
-  uint64_t user_addr = GetRawArg(order);
-  if (!user_addr) {
-    return nullptr;
-  }
-  auto* process = Schedueler::Instance()->ThisProcess();
-  riscv::PTE pte = riscv::PTE::None;
-  auto pa = VirtualMemory::Instance()->VAToPA(process->page_table, user_addr, &pte);
-  if (!pa || !(pte & riscv::PTE::U)) {
-    return nullptr;
-  }
-  return reinterpret_cast<T*>(pa);
+bool GetUserArg(int order, T* value) {
+  return copy_from_user(value, GetRawArg(order), sizeof(T));
+}
+
+template <typename T>
+bool PutUserArg(int order, const T& value) {
+  return copy_to_user(GetRawArg(order), &value, sizeof(T));
 }
 
 }  // namespace comm
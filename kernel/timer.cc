@@ -0,0 +1,167 @@
+#include "kernel/timer.h"
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/lock/critical_guard.h"
+#include "kernel/slab.h"
+#include "kernel/sys_def/time_def.h"
+#include "kernel/utils.h"
+#include "lib/string.h"
+
+namespace kernel {
+
+// padded to a whole page, no other kernel data may become visible to user space
+struct alignas(memory_layout::PGSIZE) ClockPageData {
+  time_def::clock_page page;
+};
+static_assert(sizeof(ClockPageData) == memory_layout::PGSIZE);
+
+static ClockPageData clock_page_data = {{system_param::MTIME_FREQ, 0}};
+
+uint64_t TimerManager::Now() {
+  return MEMORY_MAPPED_IO_R_DWORD(memory_layout::CLINT_MTIME);
+}
+
+uint64_t TimerManager::NsToMtime(uint64_t ns) {
+  constexpr uint64_t ns_per_mtime = 1'000'000'000 / system_param::MTIME_FREQ;
+  return (ns + ns_per_mtime - 1) / ns_per_mtime;
+}
+
+uint64_t TimerManager::MtimeToNs(uint64_t mtime) {
+  return mtime * (1'000'000'000 / system_param::MTIME_FREQ);
+}
+
+uint64_t TimerManager::ClockPage() {
+  return reinterpret_cast<uint64_t>(&clock_page_data);
+}
+
+bool TimerManager::Grow() {
+  int capacity = capacity_ ? capacity_ * 2 : 64;
+  auto** heap = reinterpret_cast<Timer**>(kmalloc(capacity * sizeof(Timer*)));
+  if (!heap) {
+    return false;
+  }
+  if (heap_) {
+    memcpy(heap, heap_, size_ * sizeof(Timer*));
+    kfree(heap_);
+  }
+  heap_ = heap;
+  capacity_ = capacity;
+  return true;
+}
+
+void TimerManager::Swap(int i, int j) {
+  Timer* t = heap_[i];
+  heap_[i] = heap_[j];
+  heap_[j] = t;
+  heap_[i]->heap_index = i;
+  heap_[j]->heap_index = j;
+}
+
+void TimerManager::SiftUp(int index) {
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+    if (heap_[parent]->deadline <= heap_[index]->deadline) {
+      break;
+    }
+    Swap(parent, index);
+    index = parent;
+  }
+}
+
+void TimerManager::SiftDown(int index) {
+  while (true) {
+    int smallest = index;
+    int left = index * 2 + 1;
+    int right = left + 1;
+    if (left < size_ && heap_[left]->deadline < heap_[smallest]->deadline) {
+      smallest = left;
+    }
+    if (right < size_ && heap_[right]->deadline < heap_[smallest]->deadline) {
+      smallest = right;
+    }
+    if (smallest == index) {
+      return;
+    }
+    Swap(smallest, index);
+    index = smallest;
+  }
+}
+
+void TimerManager::Remove(int index) {
+  Timer* timer = heap_[index];
+  size_ -= 1;
+  if (index != size_) {
+    heap_[index] = heap_[size_];
+    heap_[index]->heap_index = index;
+    SiftDown(index);
+    SiftUp(index);
+  }
+  timer->heap_index = -1;
+}
+
+void TimerManager::Program() {
+  uint64_t next = slice_deadline_[cpu_id()] ? slice_deadline_[cpu_id()] : NO_DEADLINE;
+  if (size_ > 0 && heap_[0]->deadline < next) {
+    next = heap_[0]->deadline;
+  }
+  MEMORY_MAPPED_IO_W_DWORD(memory_layout::CLINT_MTIMECMP(cpu_id()), next);
+}
+
+bool TimerManager::Add(Timer* timer) {
+  CriticalGuard guard(&lk_);
+  if (timer->heap_index >= 0) {
+    return false;
+  }
+  if (size_ == capacity_ && !Grow()) {
+    return false;
+  }
+  heap_[size_] = timer;
+  timer->heap_index = size_;
+  size_ += 1;
+  SiftUp(timer->heap_index);
+  if (timer->heap_index == 0) {
+    Program();
+  }
+  return true;
+}
+
+bool TimerManager::Cancel(Timer* timer) {
+  CriticalGuard guard(&lk_);
+  if (timer->heap_index < 0) {
+    return false;
+  }
+  Remove(timer->heap_index);
+  return true;
+}
+
+bool TimerManager::Interrupt() {
+  CriticalGuard guard(&lk_);
+  interrupt_count_[cpu_id()] += 1;
+  uint64_t now = Now();
+  while (size_ > 0 && heap_[0]->deadline <= now) {
+    Timer* timer = heap_[0];
+    Remove(0);
+    timer->fn(timer->arg);
+  }
+  bool slice_over = false;
+  if (slice_deadline_[cpu_id()] && slice_deadline_[cpu_id()] <= now) {
+    slice_deadline_[cpu_id()] = 0;
+    slice_over = true;
+  }
+  Program();
+  return slice_over;
+}
+
+void TimerManager::StartSlice(uint64_t length) {
+  CriticalGuard guard(&lk_);
+  slice_deadline_[cpu_id()] = length ? Now() + length : 0;
+  Program();
+}
+
+void TimerManager::StopSlice() {
+  CriticalGuard guard(&lk_);
+  slice_deadline_[cpu_id()] = 0;
+  Program();
+}
+
+}  // namespace kernel
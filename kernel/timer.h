@@ -0,0 +1,71 @@
+#ifndef KERNEL_TIMER_H
+#define KERNEL_TIMER_H
+
+#include "kernel/config/system_param.h"
+#include "kernel/lock/spin_lock.h"
+#include "lib/singleton.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+struct Timer {
+  // absolute mtime value
+  uint64_t deadline = 0;
+  // runs in interrupt context with interrupts off, must not sleep
+  void (*fn)(void*) = nullptr;
+  void* arg = nullptr;
+  // position in the heap, -1 if not pending
+  int heap_index = -1;
+};
+
+// One-shot timers kept in a min-heap of deadlines. mtimecmp is programmed
+// for the earliest deadline only, plus the end of the running task's
+// scheduling slice. A hart with nothing to run takes no timer interrupt
+// until the next deadline.
+class TimerManager : public lib::Singleton<TimerManager> {
+ public:
+  friend class lib::Singleton<TimerManager>;
+  static constexpr uint64_t NO_DEADLINE = ~0uL;
+
+  static uint64_t Now();
+  static uint64_t NsToMtime(uint64_t ns);
+  static uint64_t MtimeToNs(uint64_t mtime);
+  // physical address of the read-only time_def::clock_page shared with user space
+  static uint64_t ClockPage();
+
+  bool Add(Timer* timer);
+  // returns false if the timer had already fired
+  bool Cancel(Timer* timer);
+  // fire expired timers and program the next interrupt of this hart,
+  // true if the slice of the running task is over
+  bool Interrupt();
+  // the task about to run on this hart may do so for length mtime, 0 for no limit
+  void StartSlice(uint64_t length);
+  // nothing to run on this hart, only deadlines of timers may wake it
+  void StopSlice();
+  // timer interrupts taken by hart
+  uint64_t InterruptCount(int hart) const {
+    return interrupt_count_[hart];
+  }
+
+ private:
+  TimerManager() {}
+
+  bool Grow();
+  void Swap(int i, int j);
+  void SiftUp(int index);
+  void SiftDown(int index);
+  void Remove(int index);
+  void Program();
+
+  Timer** heap_ = nullptr;
+  int size_ = 0;
+  int capacity_ = 0;
+  uint64_t slice_deadline_[system_param::CPU_NUM] = {0};
+  uint64_t interrupt_count_[system_param::CPU_NUM] = {0};
+  SpinLock lk_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_TIMER_H
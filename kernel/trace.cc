@@ -0,0 +1,50 @@
+#include "kernel/trace.h"
+
+#include "kernel/lock/critical_guard.h"
+#include "kernel/scheduler.h"
+#include "kernel/timer.h"
+#include "kernel/utils.h"
+
+namespace kernel {
+
+void Tracer::Emit(trace_def::event event, uint64_t arg0, uint64_t arg1) {
+  ProcessTask* task = Schedueler::Instance()->ThisProcess();
+  rings_[cpu_id()].Push([&](trace_def::record* record) {
+    record->timestamp = TimerManager::Now();
+    record->hart = cpu_id();
+    record->event = event;
+    record->pid = task ? task->pid : 0;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+  });
+}
+
+void Tracer::SetEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::Clear() {
+  CriticalGuard guard(&read_lock_);
+  for (auto& ring : rings_) {
+    ring.Clear();
+  }
+}
+
+uint64_t Tracer::Dropped() const {
+  uint64_t dropped = 0;
+  for (const auto& ring : rings_) {
+    dropped += ring.Dropped();
+  }
+  return dropped;
+}
+
+size_t Tracer::Read(trace_def::record* out, size_t max_num) {
+  CriticalGuard guard(&read_lock_);
+  size_t num = 0;
+  for (auto& ring : rings_) {
+    num += ring.Pop(out + num, max_num - num);
+  }
+  return num;
+}
+
+}  // namespace kernel
@@ -0,0 +1,46 @@
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <atomic>
+
+#include "kernel/config/system_param.h"
+#include "kernel/lock/spin_lock.h"
+#include "kernel/per_hart_ring.h"
+#include "kernel/sys_def/trace_def.h"
+#include "lib/singleton.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Binary trace events kept in one ring per hart, tracepoints take no lock.
+class Tracer : public lib::Singleton<Tracer> {
+ public:
+  friend class lib::Singleton<Tracer>;
+  static constexpr size_t RING_SIZE = 1024;
+
+  // a disabled tracepoint costs a single load
+  void Record(trace_def::event event, uint64_t arg0 = 0, uint64_t arg1 = 0) {
+    if (enabled_.load(std::memory_order_relaxed)) {
+      Emit(event, arg0, arg1);
+    }
+  }
+  void SetEnabled(bool enabled);
+  void Clear();
+  uint64_t Dropped() const;
+  // move up to max_num records, oldest first within each hart, returns how many
+  size_t Read(trace_def::record* out, size_t max_num);
+
+ private:
+  Tracer() {}
+
+  void Emit(trace_def::event event, uint64_t arg0, uint64_t arg1);
+
+  std::atomic<bool> enabled_{false};
+  PerHartRing<trace_def::record, RING_SIZE> rings_[system_param::CPU_NUM];
+  // serializes readers, writers never take it
+  SpinLock read_lock_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_TRACE_H
@@ -4,9 +4,11 @@
 #include "arch/riscv_reg.h"
 #include "kernel/extern_controller.h"
 #include "kernel/printf.h"
+#include "kernel/profiler.h"
 #include "kernel/scheduler.h"
 #include "kernel/syscalls/define.h"
 #include "kernel/syscalls/syscall.h"
+#include "kernel/trace.h"
 #include "kernel/utils.h"
 #include "kernel/virtual_memory.h"
 #include "lib/common.h"
@@ -25,6 +27,8 @@ void ProcessException() {
   
   case riscv::Exception::store_page_fault:
   case riscv::Exception::load_page_fault:
+    process->usage.nfault += 1;
+    Tracer::Instance()->Record(trace_def::page_fault, riscv::regs::mtval.read(), process->frame->mepc);
     if (process->frame->sp < (VirtualMemory::GetUserSpVa() - memory_layout::PGSIZE)) {
       printf("Stack overflow: %p vs %p\n", process->frame->sp, VirtualMemory::GetUserSpVa() - memory_layout::PGSIZE);
     } else {
@@ -37,6 +41,7 @@ void ProcessException() {
     panic("Unexpted exception code: %d", lib::common::literal(e_code));
     break;
   }
+  Schedueler::Instance()->MaybePreempt();
   TrapRet(Schedueler::Instance()->ThisProcess(), e_code);
 }
 
@@ -44,10 +49,8 @@ void ProcessInterrupt() {
   riscv::Interrupt i_code = Schedueler::Instance()->ThisProcess()->frame->interrunpt();
   switch (i_code) {
   case riscv::Interrupt::m_timer:
-    if (cpu_id() == 0) {
-      Schedueler::Instance()->ClockInterrupt();
-    }
-    Schedueler::Instance()->Yield();
+    Schedueler::Instance()->ClockInterrupt();
+    Profiler::Instance()->SampleUser(Schedueler::Instance()->ThisProcess());
     break;
 
   case riscv::Interrupt::m_external:
@@ -58,6 +61,7 @@ void ProcessInterrupt() {
     panic("Unexpectd interrunpt code: %d", lib::common::literal(i_code));
     break;
   }
+  Schedueler::Instance()->MaybePreempt();
   TrapRet(Schedueler::Instance()->ThisProcess(), riscv::Exception::none);
 }
 
@@ -69,6 +73,7 @@ void ProcessUserTrap() {
     panic("Invalid mstatus mie bit, interrupt enabled");
   }
   auto* process = Schedueler::Instance()->ThisProcess();
+  process->AccountUserTime();
   if (process->frame->mcause & riscv::EXCEPTION_MASK) {
     ProcessInterrupt();
     return;
@@ -88,16 +93,12 @@ void ProcessKernelTrap() {
   }
   riscv::Interrupt i_code = riscv::regs::mcause.get_interrupt();
   if (i_code == riscv::Interrupt::m_timer) {
-    if (cpu_id() == 0) {
-      Schedueler::Instance()->ClockInterrupt();
-    }
-    if (!Schedueler::Instance()->ThisCpu()->process_task) {
-      return;
-    }
-    Schedueler::Instance()->Yield();
+    Schedueler::Instance()->ClockInterrupt();
+    Profiler::Instance()->SampleKernel(riscv::regs::mepc.read(), static_cast<const uint64_t*>(__builtin_frame_address(0)));
   } else if (i_code == riscv::Interrupt::m_external) {
     ExternController::Instance()->DoWork();
   }
+  Schedueler::Instance()->MaybePreempt();
   riscv::regs::mstatus.set_mpp(riscv::MPP::machine_mode);
   riscv::regs::mstatus.set_bit(riscv::StatusBit::mpie);
 }
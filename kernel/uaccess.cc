@@ -0,0 +1,89 @@
+#include "kernel/uaccess.h"
+
+#include <algorithm>
+
+#include "kernel/config/memory_layout.h"
+#include "kernel/process.h"
+#include "kernel/scheduler.h"
+#include "kernel/virtual_memory.h"
+#include "lib/common.h"
+
+namespace kernel {
+
+// one leaf page table maps 512 pages
+static constexpr uint64_t LEAF_REGION_SHIFT = 21;
+
+uint64_t UserTranslator::Translate(uint64_t va, riscv::PTE privilege) {
+  if (va > memory_layout::MAX_SUPPORT_VA) {
+    return 0;
+  }
+  uint64_t region = va >> LEAF_REGION_SHIFT;
+  // misses are not cached, the table may get populated later on
+  if (region != leaf_region_ || !leaf_table_) {
+    leaf_table_ = VirtualMemory::Instance()->GetLeafTable(root_page_, va);
+    leaf_region_ = region;
+  }
+  if (!leaf_table_) {
+    return 0;
+  }
+  uint64_t pte = leaf_table_[(va / memory_layout::PGSIZE) & 0x1ff];
+  uint64_t need = lib::common::literal(riscv::PTE::V | riscv::PTE::U | privilege);
+  if ((pte & need) != need) {
+    return 0;
+  }
+  return VirtualMemory::PTEToPA(pte) + va % memory_layout::PGSIZE;
+}
+
+template <typename F>
+static bool walk_user(uint64_t va, size_t len, riscv::PTE privilege, F&& fun) {
+  UserTranslator translator(Schedueler::Instance()->ThisProcess()->mm->page_table);
+  while (len > 0) {
+    uint64_t pa = translator.Translate(va, privilege);
+    if (!pa) {
+      return false;
+    }
+    size_t n = std::min<size_t>(len, memory_layout::PGSIZE - va % memory_layout::PGSIZE);
+    fun(reinterpret_cast<char*>(pa), n);
+    va += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool copy_from_user(void* dst, uint64_t src, size_t len) {
+  char* out = reinterpret_cast<char*>(dst);
+  return walk_user(src, len, riscv::PTE::R, [&out](const char* buf, size_t n) {
+    std::copy(buf, buf + n, out);
+    out += n;
+  });
+}
+
+bool copy_to_user(uint64_t dst, const void* src, size_t len) {
+  const char* in = reinterpret_cast<const char*>(src);
+  return walk_user(dst, len, riscv::PTE::W, [&in](char* buf, size_t n) {
+    std::copy(in, in + n, buf);
+    in += n;
+  });
+}
+
+int64_t strncpy_from_user(char* dst, uint64_t src, size_t size) {
+  UserTranslator translator(Schedueler::Instance()->ThisProcess()->mm->page_table);
+  size_t copied = 0;
+  while (copied < size) {
+    const char* buf = reinterpret_cast<const char*>(translator.Translate(src + copied, riscv::PTE::R));
+    if (!buf) {
+      return -1;
+    }
+    size_t n = std::min<size_t>(size - copied, memory_layout::PGSIZE - (src + copied) % memory_layout::PGSIZE);
+    for (size_t i = 0; i < n; ++i) {
+      dst[copied + i] = buf[i];
+      if (!buf[i]) {
+        return copied + i;
+      }
+    }
+    copied += n;
+  }
+  return -1;
+}
+
+}  // namespace kernel
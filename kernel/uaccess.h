@@ -0,0 +1,33 @@
+#ifndef KERNEL_UACCESS_H
+#define KERNEL_UACCESS_H
+
+#include "arch/riscv_isa.h"
+#include "lib/types.h"
+
+namespace kernel {
+
+// Translates virtual addresses of one user address space. The leaf page
+// table of the last touched 2MiB region is kept, so walking a buffer page
+// by page costs a single pte load per page instead of a full table walk.
+class UserTranslator {
+ public:
+  explicit UserTranslator(uint64_t* root_page) : root_page_(root_page) {}
+  // physical address of va, 0 if va is not a user page carrying privilege
+  uint64_t Translate(uint64_t va, riscv::PTE privilege = riscv::PTE::None);
+
+ private:
+  uint64_t* root_page_ = nullptr;
+  uint64_t leaf_region_ = ~0uL;
+  uint64_t* leaf_table_ = nullptr;
+};
+
+// Accessors of the current process memory, a fault stops the copy at the
+// first unmapped or insufficiently privileged page.
+bool copy_from_user(void* dst, uint64_t src, size_t len);
+bool copy_to_user(uint64_t dst, const void* src, size_t len);
+// length of the copied string, -1 on fault or if no terminator fits in size
+int64_t strncpy_from_user(char* dst, uint64_t src, size_t size);
+
+}  // namespace kernel
+
+#endif  // KERNEL_UACCESS_H
@@ -7,6 +7,7 @@
 #include "arch/riscv_reg.h"
 #include "kernel/config/memory_layout.h"
 #include "kernel/scheduler.h"
+#include "kernel/uaccess.h"
 #include "kernel/virtual_memory.h"
 
 namespace kernel {
@@ -30,16 +31,18 @@ inline __attribute__((always_inline)) void global_interrunpt_off() {
   riscv::regs::mstatus.clear_bit(riscv::StatusBit::mie);
 }
 
+// Walks the user buffer [dst, dst + size) page by page, stops at the first
+// page which is not mapped with privilege or when fun consumes less than given.
 template <typename F, typename = std::enable_if_t<std::is_invocable_v<F&, char*, size_t>>>
-size_t safe_copy(uint64_t dst, size_t size, F& fun) {
-  auto* process = Schedueler::Instance()->ThisProcess();
-  auto f = [process](uint64_t addr){
-    return VirtualMemory::Instance()->VAToPA(process->page_table, addr);
-  };
+size_t safe_copy(uint64_t dst, size_t size, F& fun, riscv::PTE privilege = riscv::PTE::R) {
+  UserTranslator translator(Schedueler::Instance()->ThisProcess()->mm->page_table);
   size_t copyout_size = 0;
   while (size > 0) {
-    uint64_t pa = f(dst);
-    uint64_t remain = memory_layout::PGSIZE - pa % memory_layout::PGSIZE;
+    uint64_t pa = translator.Translate(dst, privilege);
+    if (!pa) {
+      return copyout_size;
+    }
+    uint64_t remain = memory_layout::PGSIZE - dst % memory_layout::PGSIZE;
     size_t len = std::min(remain, size);
     size_t ret = fun(reinterpret_cast<char*>(pa), len);
     copyout_size += ret;
@@ -3,9 +3,11 @@
 #include <iterator>
 
 #include "kernel/config/memory_layout.h"
+#include "kernel/timer.h"
 #include "kernel/lock/critical_guard.h"
 #include "kernel/regs_frame.hpp"
 #include "kernel/scheduler.h"
+#include "kernel/sys_def/sched_def.h"
 #include "kernel/utils.h"
 #include "lib/string.h"
 
@@ -39,17 +41,76 @@ bool VirtualMemory::HasInit() {
 }
 
 size_t VirtualMemory::GetFreePageSize() {
-  return memory_list_.Size();
+  return memory_list_.Size() + zeroed_list_.Size();
+}
+
+size_t VirtualMemory::GetZeroedPageSize() {
+  return zeroed_list_.Size();
+}
+
+PageStats VirtualMemory::GetPageStats() {
+  CriticalGuard guard(&lk_);
+  return stats_;
 }
 
 uint64_t* VirtualMemory::Alloc() {
   CriticalGuard guard(&lk_);
-  auto* t = memory_list_.Pop();
-  memset(t, 0, memory_layout::PGSIZE);
+  auto* t = zeroed_list_.Pop();
+  if (t) {
+    // only the list links were written after clearing
+    memset(t, 0, sizeof(MemoryChunk));
+    stats_.alloc_zeroed += 1;
+  } else {
+    t = memory_list_.Pop();
+    if (!t) {
+      return nullptr;
+    }
+    memset(t, 0, memory_layout::PGSIZE);
+  }
   UpdateBitMap(t, BitMapAction::alloc);
+  stats_.alloc += 1;
   return reinterpret_cast<uint64_t*>(t);
 }
 
+size_t VirtualMemory::ZeroFreePages(size_t n) {
+  constexpr size_t max_zeroed_pages = 512;
+  CriticalGuard guard(&lk_);
+  size_t count = 0;
+  while (count < n && zeroed_list_.Size() < max_zeroed_pages) {
+    auto* t = memory_list_.Pop();
+    if (!t) {
+      break;
+    }
+    memset(t, 0, memory_layout::PGSIZE);
+    zeroed_list_.Push(t);
+    count += 1;
+  }
+  return count;
+}
+
+static void ZeroWorker(void*) {
+  constexpr size_t batch = 16;
+  auto* scheduler = Schedueler::Instance();
+  while (true) {
+    // give the cpu back between batches, idle until the next tick when nothing is left
+    if (VirtualMemory::Instance()->ZeroFreePages(batch) > 0) {
+      scheduler->Yield();
+    } else {
+      scheduler->SleepUntil(TimerManager::Now() + system_param::TIMER_INTERVAL);
+    }
+  }
+}
+
+bool VirtualMemory::StartZeroWorker() {
+  auto* task = Schedueler::Instance()->CreateKernelThread("kzerod", ZeroWorker, nullptr);
+  if (!task) {
+    return false;
+  }
+  // only uses cpu time nobody else wants
+  Schedueler::Instance()->SetNice(task, sched_def::NICE_MAX);
+  return true;
+}
+
 uint64_t* VirtualMemory::AllocContinuousPage(uint8_t n) {
   constexpr uint8_t max_page_num = 8;
   CriticalGuard guard(&lk_);
@@ -65,9 +126,13 @@ uint64_t* VirtualMemory::AllocContinuousPage(uint8_t n) {
         for (int j = 0; j < n; ++j) {
           auto m = (page_index + j) * memory_layout::PGSIZE + memory_layout::KERNEL_BASE;
           UpdateBitMap(m, BitMapAction::alloc);
-          memory_list_.Erase(reinterpret_cast<MemoryChunk*>(m));
+          auto* chunk = reinterpret_cast<MemoryChunk*>(m);
+          if (!memory_list_.Erase(chunk)) {
+            zeroed_list_.Erase(chunk);
+          }
           memset(reinterpret_cast<uint8_t*>(m), 0, memory_layout::PGSIZE);
         }
+        stats_.alloc += n;
         return reinterpret_cast<uint64_t*>(page_index * memory_layout::PGSIZE + memory_layout::KERNEL_BASE);
       }
     }
@@ -101,7 +166,7 @@ uint64_t* VirtualMemory::GetPTE(uint64_t* root_page, uint64_t va, bool need_allo
         return nullptr;
       }
     }
-    pte = reinterpret_cast<uint64_t*>((*sub_pte << 2) & (0xfff'ffff'ffffL * memory_layout::PGSIZE));
+    pte = reinterpret_cast<uint64_t*>(PTEToPA(*sub_pte));
   }
   return pte + ((va >> (12 + (3 - level) * 9)) & 0x1ff);
 }
@@ -123,9 +188,13 @@ bool VirtualMemory::MapPage(uint64_t* root_page, uint64_t va, uint64_t pa, riscv
   }
   uint64_t* pte = GetPTE(root_page, va, true);
   if (!pte) return false;
+  bool is_remap = *pte & riscv::PTE::V;
   *pte = pa >> 2;
   *pte |= riscv::PTE::V;
   *pte |= privilege;
+  if (is_remap) {
+    riscv::isa::sfence_va(va);
+  }
   return true;
 }
 
@@ -135,12 +204,25 @@ void VirtualMemory::FreePage(uint64_t* root_page, uint64_t va, int level) {
   }
   uint64_t* pte = GetPTE(root_page, va, false, level);
   if (pte && (*pte & riscv::PTE::V)) {
-    uint64_t* sub_pte = reinterpret_cast<uint64_t*>((*pte << 2) & (0xfff'ffff'ffffL * memory_layout::PGSIZE));
+    uint64_t* sub_pte = reinterpret_cast<uint64_t*>(PTEToPA(*pte));
     auto* t = reinterpret_cast<MemoryChunk*>(sub_pte);
     CriticalGuard guard(&lk_);
-    memory_list_.Push(t);
-    UpdateBitMap(t, BitMapAction::free);
+    if (PutPage(reinterpret_cast<uint64_t>(t))) {
+      memory_list_.Push(t);
+      UpdateBitMap(t, BitMapAction::free);
+    }
     *pte = 0x0;
+    if (level == 3) {
+      riscv::isa::sfence_va(va);
+    }
+  }
+}
+
+void VirtualMemory::UnMapPage(uint64_t* root_page, uint64_t va) {
+  uint64_t* pte = GetPTE(root_page, va, false);
+  if (pte && (*pte & riscv::PTE::V)) {
+    *pte = 0x0;
+    riscv::isa::sfence_va(AddrCastDown(va));
   }
 }
 
@@ -151,8 +233,26 @@ void VirtualMemory::FreePage(uint64_t* pa) {
   }
   auto* t = reinterpret_cast<MemoryChunk*>(pa);
   CriticalGuard guard(&lk_);
+  if (!PutPage(reinterpret_cast<uint64_t>(pa))) {
+    return;
+  }
   memory_list_.Push(t);
   UpdateBitMap(pa, BitMapAction::free);
+  stats_.free += 1;
+}
+
+void VirtualMemory::GetPage(uint64_t* pa) {
+  CriticalGuard guard(&lk_);
+  page_refs_[(reinterpret_cast<uint64_t>(pa) - memory_layout::KERNEL_BASE) / memory_layout::PGSIZE] += 1;
+}
+
+bool VirtualMemory::PutPage(uint64_t pa) {
+  uint16_t& refs = page_refs_[(pa - memory_layout::KERNEL_BASE) / memory_layout::PGSIZE];
+  if (refs > 0) {
+    refs -= 1;
+    return false;
+  }
+  return true;
 }
 
 void VirtualMemory::FreePage(std::initializer_list<uint64_t*> pa_list) {
@@ -213,6 +313,18 @@ uint64_t VirtualMemory::AddrCastDown(uint64_t addr) {
   return addr & (~(memory_layout::PGSIZE - 1));
 }
 
+uint64_t* VirtualMemory::GetLeafTable(uint64_t* root_page, uint64_t va) {
+  uint64_t* pte = GetPTE(root_page, va, false, 2);
+  if (!pte || (!(*pte & riscv::PTE::V))) {
+    return nullptr;
+  }
+  return reinterpret_cast<uint64_t*>(PTEToPA(*pte));
+}
+
+uint64_t VirtualMemory::PTEToPA(uint64_t pte) {
+  return (pte << 2) & (0xfff'ffff'ffffL * memory_layout::PGSIZE);
+}
+
 uint64_t VirtualMemory::VAToPA(uint64_t* root_page, uint64_t va, riscv::PTE* output_privi) {
   uint64_t remain = va % memory_layout::PGSIZE;
   uint64_t* pte = GetPTE(root_page, va, false);
@@ -222,7 +334,7 @@ uint64_t VirtualMemory::VAToPA(uint64_t* root_page, uint64_t va, riscv::PTE* out
   if (output_privi) {
     *output_privi = static_cast<riscv::PTE>(*pte & riscv::PTE_MASK);
   }
-  return (((*pte) << 2) & (0xfff'ffff'ffffL * memory_layout::PGSIZE)) + remain;
+  return PTEToPA(*pte) + remain;
 }
 
 }  // namespace kernel
\ No newline at end of file
@@ -5,7 +5,8 @@
 
 #include "arch/riscv_isa.h"
 #include "kernel/config/memory_layout.h"
-#include "kernel/lock/spin_lock.h"
+#include "kernel/lock/instrumented_lock.h"
+#include "kernel/lock/mcs_lock.h"
 #include "kernel/process.h"
 #include "lib/singleton.h"
 #include "lib/types.h"
@@ -53,7 +54,7 @@ class MemoryList {
   }
 
   bool Erase(MemoryChunk* chunk) {
-    if (chunk->identify != this || (!chunk->next && !chunk->previous)) {
+    if (chunk->identify != this || (!chunk->next && !chunk->previous && chunk != head_)) {
       return false;
     }
     // check wether chunk is head or tail node
@@ -75,6 +76,7 @@ class MemoryList {
     } else {
       chunk->previous->next = chunk->next;
     }
+    chunk->identify = nullptr;
     size_ -= 1;
     return true;
   }
@@ -90,6 +92,13 @@ class MemoryList {
 };
 
 
+struct PageStats {
+  uint64_t alloc = 0;
+  // allocations served from pages the zero worker cleared in advance
+  uint64_t alloc_zeroed = 0;
+  uint64_t free = 0;
+};
+
 class VirtualMemory : public lib::Singleton<VirtualMemory> {
  public:
   friend class lib::Singleton<VirtualMemory>;
@@ -97,17 +106,31 @@ class VirtualMemory : public lib::Singleton<VirtualMemory> {
   bool Init();
   bool HasInit();
   size_t GetFreePageSize();
+  size_t GetZeroedPageSize();
+  PageStats GetPageStats();
   uint64_t* Alloc();
   uint64_t* AllocContinuousPage(uint8_t n);
+  // move up to n freed pages to the zeroed list, returns how many were cleared
+  size_t ZeroFreePages(size_t n);
+  // background kernel thread which keeps a stock of zeroed pages for Alloc
+  bool StartZeroWorker();
   bool MapPage(uint64_t* root_page, uint64_t va, uint64_t pa, riscv::PTE privilege);
   void FreePage(uint64_t* root_page, uint64_t va, int level = 3);
+  // drop the mapping of va but keep the page, for pages owned by the kernel
+  void UnMapPage(uint64_t* root_page, uint64_t va);
   void FreePage(uint64_t* pa);
   void FreePage(std::initializer_list<uint64_t*> pa_list);
+  // one more owner of the allocated page pa, e.g. a shared mapping, every
+  // owner frees it and it goes back to the free list with the last one
+  void GetPage(uint64_t* pa);
   bool MapMemory(uint64_t* root_page, uint64_t va_beg, uint64_t va_end, riscv::PTE privilege);
   bool MapMemory(uint64_t* root_page, uint64_t va, uint64_t pa, size_t size, riscv::PTE privilege);
   void FreeMemory(uint64_t* root_page, uint64_t va_beg, uint64_t va_end, int level = 3);
   static uint64_t GetUserSpVa();
   uint64_t VAToPA(uint64_t* root_page, uint64_t va, riscv::PTE* output_privi = nullptr);
+  // last level page table which covers va, nullptr if not exists
+  uint64_t* GetLeafTable(uint64_t* root_page, uint64_t va);
+  static uint64_t PTEToPA(uint64_t pte);
   static uint64_t AddrCastUp(uint64_t addr);
   static uint64_t AddrCastDown(uint64_t addr);
  
@@ -116,6 +139,8 @@ class VirtualMemory : public lib::Singleton<VirtualMemory> {
   VirtualMemory(const VirtualMemory&) = delete;
 
   uint64_t* GetPTE(uint64_t* root_page, uint64_t va, bool need_alloc, int level = 3);
+  // lk_ is held, drop one owner of pa, true if it was the last one
+  bool PutPage(uint64_t pa);
 
   enum class BitMapAction {
     alloc = 1,
@@ -138,9 +163,14 @@ class VirtualMemory : public lib::Singleton<VirtualMemory> {
   }
 
   bool has_init_ = false;
+  // pages with stale content, and pages already cleared by the zero worker
   MemoryList memory_list_;
+  MemoryList zeroed_list_;
+  PageStats stats_;
   uint8_t bit_map_[(memory_layout::MEMORY_END - memory_layout::KERNEL_BASE) / memory_layout::PGSIZE / 8] = {0};
-  SpinLock lk_;
+  // owners of a page besides the first one
+  uint16_t page_refs_[(memory_layout::MEMORY_END - memory_layout::KERNEL_BASE) / memory_layout::PGSIZE] = {0};
+  Instrumented<McsLock> lk_{"page_alloc"};
 };
 
 }  // namespace kernel
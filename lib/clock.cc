@@ -0,0 +1,35 @@
+#include "lib/clock.h"
+
+#include "kernel/sys_def/time_def.h"
+
+namespace lib {
+
+static const time_def::clock_page* ClockPage() {
+  return reinterpret_cast<const time_def::clock_page*>(time_def::CLOCK_PAGE_VA);
+}
+
+uint64_t clock_now() {
+  uint64_t t = 0;
+  asm volatile ("rdtime %0" : "=r" (t));
+  uint64_t freq = ClockPage()->mtime_freq;
+  // split to keep t * NSEC_PER_SEC from overflowing
+  return t / freq * time_def::NSEC_PER_SEC + t % freq * time_def::NSEC_PER_SEC / freq;
+}
+
+uint64_t clock_realtime() {
+  return clock_now() + ClockPage()->realtime_offset_ns;
+}
+
+uint64_t cycle_now() {
+  uint64_t c = 0;
+  asm volatile ("rdcycle %0" : "=r" (c));
+  return c;
+}
+
+uint64_t instret_now() {
+  uint64_t i = 0;
+  asm volatile ("rdinstret %0" : "=r" (i));
+  return i;
+}
+
+}  // namespace lib
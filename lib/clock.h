@@ -0,0 +1,18 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace lib {
+
+// Timestamps without a syscall, the time and cycle csrs are readable from
+// user mode and the kernel publishes the time base in a shared page.
+// nanoseconds since boot
+uint64_t clock_now();
+// nanoseconds of wall clock time, same as clock_now until there is an rtc
+uint64_t clock_realtime();
+// cpu cycles, only meaningful as a difference on the same hart
+uint64_t cycle_now();
+// retired instructions, same caveat, see syscall::perf_open for per thread counts
+uint64_t instret_now();
+
+}  // namespace lib
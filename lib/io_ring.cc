@@ -0,0 +1,89 @@
+#include "lib/io_ring.h"
+
+#include "lib/syscall.h"
+
+namespace lib {
+
+bool IoRing::Init() {
+  return syscall::io_setup(&ring_) == 0 && ring_;
+}
+
+bool IoRing::Queue(uint8_t opcode, int fd, uint64_t addr, uint64_t len, uint64_t user_data) {
+  uint32_t tail = ring_->sq_tail;
+  if (tail - __atomic_load_n(&ring_->sq_head, __ATOMIC_ACQUIRE) >= io_def::RING_ENTRIES) {
+    return false;
+  }
+  io_def::sqe& sqe = ring_->sq[tail % io_def::RING_ENTRIES];
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  sqe.addr = addr;
+  sqe.len = len;
+  sqe.user_data = user_data;
+  // the entry has to be complete before the kernel can see it
+  __atomic_store_n(&ring_->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+uint32_t IoRing::Pending() const {
+  return ring_->sq_tail - __atomic_load_n(&ring_->sq_head, __ATOMIC_ACQUIRE);
+}
+
+int IoRing::Submit() {
+  return syscall::io_enter(Pending());
+}
+
+bool IoRing::Reap(io_def::cqe* cqe) {
+  uint32_t head = ring_->cq_head;
+  if (head == __atomic_load_n(&ring_->cq_tail, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  *cqe = ring_->cq[head % io_def::RING_ENTRIES];
+  __atomic_store_n(&ring_->cq_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static constexpr int COPY_BLOCKS = 16;
+static constexpr uint64_t COPY_BLOCK_SIZE = 512;
+static char copy_buf[COPY_BLOCKS][COPY_BLOCK_SIZE];
+
+int64_t io_copy(IoRing* ring, int in_fd, int out_fd) {
+  int64_t total = 0;
+  while (true) {
+    for (int i = 0; i < COPY_BLOCKS; ++i) {
+      ring->QueueRead(in_fd, copy_buf[i], COPY_BLOCK_SIZE, i);
+    }
+    if (ring->Submit() < 0) {
+      return -1;
+    }
+    // reads run in order, the first short one is the end of the file
+    int64_t len[COPY_BLOCKS] = {0};
+    io_def::cqe cqe;
+    while (ring->Reap(&cqe)) {
+      len[cqe.user_data] = cqe.res;
+    }
+    bool end = false;
+    for (int i = 0; i < COPY_BLOCKS && !end; ++i) {
+      if (len[i] < 0) {
+        return -1;
+      }
+      if (len[i] > 0) {
+        ring->QueueWrite(out_fd, copy_buf[i], len[i], i);
+      }
+      end = len[i] < static_cast<int64_t>(COPY_BLOCK_SIZE);
+    }
+    if (ring->Pending() && ring->Submit() < 0) {
+      return -1;
+    }
+    while (ring->Reap(&cqe)) {
+      if (cqe.res != len[cqe.user_data]) {
+        return -1;
+      }
+      total += cqe.res;
+    }
+    if (end) {
+      return total;
+    }
+  }
+}
+
+}  // namespace lib
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "kernel/sys_def/io_def.h"
+#include "lib/types.h"
+
+namespace lib {
+
+// Queues file operations in the ring of io_setup, Submit runs all of them
+// with a single trap. Completions come back in submission order. Not
+// thread safe, every thread of a process sees the same ring.
+class IoRing {
+ public:
+  bool Init();
+
+  // false when the submission queue is full, Submit to make room
+  bool Queue(uint8_t opcode, int fd, uint64_t addr, uint64_t len, uint64_t user_data = 0);
+  bool QueueRead(int fd, void* buf, uint64_t len, uint64_t user_data = 0) {
+    return Queue(io_def::read, fd, reinterpret_cast<uint64_t>(buf), len, user_data);
+  }
+  bool QueueWrite(int fd, const void* buf, uint64_t len, uint64_t user_data = 0) {
+    return Queue(io_def::write, fd, reinterpret_cast<uint64_t>(buf), len, user_data);
+  }
+  // entries queued but not submitted yet
+  uint32_t Pending() const;
+
+  // returns the number of entries the kernel consumed or -1
+  int Submit();
+  // false when there is no completion left
+  bool Reap(io_def::cqe* cqe);
+
+ private:
+  io_def::ring* ring_ = nullptr;
+};
+
+// copy in_fd from its offset on to out_fd, 16 block reads and then their
+// writes go in one trap each, returns the bytes copied or -1
+int64_t io_copy(IoRing* ring, int in_fd, int out_fd);
+
+}  // namespace lib
@@ -1,9 +1,14 @@
 #include "lib/memory.h"
 
+#include <array>
+#include <utility>
+
 #include "kernel/config/memory_layout.h"
 #include "lib/lib.h"
 #include "lib/syscall.h"
 #include "lib/singleton.h"
+#include "lib/string.h"
+#include "lib/sync.h"
 
 namespace lib {
 
@@ -125,9 +130,277 @@ class MemManager : public Singleton<MemManager> {
   Header* free_list = nullptr;
 };
 
+// Small objects are served from 16KiB spans, each span holds objects of a
+// single size class and is aligned to its size, so free finds the owning
+// span by masking the address. Spans are carved from arenas grown by sbrk,
+// anything above the largest class goes to MemManager.
+constexpr uint32_t SPAN_SIZE = 16 * 1024;
+constexpr uint32_t ARENA_SPANS = 16;
+constexpr uint32_t MAX_ARENAS = 16;
+constexpr uint32_t MAX_ARENA_SHIFT = 6;
+constexpr uint64_t SPAN_MAGIC = 0x5350'414e'0bad'cafeuL;
+constexpr uint32_t CLASS_GRANULE = 16;
+constexpr uint32_t SIZE_CLASSES[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+constexpr uint32_t CLASS_NUM = sizeof(SIZE_CLASSES) / sizeof(SIZE_CLASSES[0]);
+constexpr uint32_t MAX_SMALL_SIZE = SIZE_CLASSES[CLASS_NUM - 1];
+
+struct FreeObject {
+  FreeObject* next;
+};
+
+struct Span {
+  uint64_t magic;
+  uint32_t size_class;
+  uint32_t used;
+  FreeObject* free_list;
+  // never handed out part of the span, objects are carved lazily
+  char* bump;
+  Span* prev;
+  Span* next;
+};
+
+constexpr uint32_t SPAN_HEADER_SIZE = (sizeof(Span) + CLASS_GRANULE - 1) / CLASS_GRANULE * CLASS_GRANULE;
+
+class SpanAllocator : public Singleton<SpanAllocator> {
+ public:
+  friend class Singleton<SpanAllocator>;
+
+  Span* Alloc() {
+    if (!free_spans_ && !GrowArena()) {
+      return nullptr;
+    }
+    Span* span = free_spans_;
+    free_spans_ = span->next;
+    return span;
+  }
+
+  void Free(Span* span) {
+    span->magic = 0;
+    span->next = free_spans_;
+    free_spans_ = span;
+  }
+
+  bool Contains(const void* addr) const {
+    auto a = reinterpret_cast<uint64_t>(addr);
+    for (uint32_t i = 0; i < arena_num_; ++i) {
+      if (a >= arenas_[i].first && a < arenas_[i].second) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  SpanAllocator() {}
+
+  bool GrowArena() {
+    if (arena_num_ == MAX_ARENAS) {
+      return false;
+    }
+    // arenas double in size so a few of them cover the whole heap
+    uint32_t span_num = ARENA_SPANS << (arena_num_ < MAX_ARENA_SHIFT ? arena_num_ : MAX_ARENA_SHIFT);
+    // sbrk is page aligned only, over allocate to align the arena to span size
+    char* addr = syscall::sbrk(span_num * SPAN_SIZE + SPAN_SIZE - memory_layout::PGSIZE);
+    if (!addr) {
+      return false;
+    }
+    uint64_t beg = (reinterpret_cast<uint64_t>(addr) + SPAN_SIZE - 1) & ~(uint64_t(SPAN_SIZE) - 1);
+    uint64_t end = beg + span_num * SPAN_SIZE;
+    arenas_[arena_num_++] = {beg, end};
+    for (uint64_t span = end - SPAN_SIZE; span >= beg; span -= SPAN_SIZE) {
+      Free(reinterpret_cast<Span*>(span));
+    }
+    return true;
+  }
+
+  Span* free_spans_ = nullptr;
+  std::pair<uint64_t, uint64_t> arenas_[MAX_ARENAS];
+  uint32_t arena_num_ = 0;
+};
+
+constexpr auto MakeClassIndex() {
+  std::array<uint8_t, MAX_SMALL_SIZE / CLASS_GRANULE + 1> index{};
+  uint32_t size_class = 0;
+  for (uint32_t i = 0; i < index.size(); ++i) {
+    while (SIZE_CLASSES[size_class] < i * CLASS_GRANULE) {
+      size_class += 1;
+    }
+    index[i] = size_class;
+  }
+  return index;
+}
+
+class SizeClassAllocator : public Singleton<SizeClassAllocator> {
+ public:
+  friend class Singleton<SizeClassAllocator>;
+
+  static uint32_t SizeClass(uint32_t bytes) {
+    return class_index_[(bytes + CLASS_GRANULE - 1) / CLASS_GRANULE];
+  }
+
+  // span owning addr, nullptr if addr is not a small object
+  static Span* SpanOf(void* addr) {
+    if (!SpanAllocator::Instance()->Contains(addr)) {
+      return nullptr;
+    }
+    auto* span = reinterpret_cast<Span*>(reinterpret_cast<uint64_t>(addr) & ~(uint64_t(SPAN_SIZE) - 1));
+    if (span->magic != (SPAN_MAGIC ^ reinterpret_cast<uint64_t>(span))) {
+      return nullptr;
+    }
+    return span;
+  }
+
+  void* Alloc(uint32_t bytes) {
+    uint32_t size_class = SizeClass(bytes);
+    Span* span = partial_[size_class];
+    if (!span) {
+      span = NewSpan(size_class);
+      if (!span) {
+        return nullptr;
+      }
+    }
+    void* obj = nullptr;
+    if (span->free_list) {
+      obj = span->free_list;
+      span->free_list = span->free_list->next;
+    } else {
+      obj = span->bump;
+      span->bump += SIZE_CLASSES[size_class];
+    }
+    span->used += 1;
+    if (IsFull(span)) {
+      Unlink(span);
+    }
+    return obj;
+  }
+
+  void Free(Span* span, void* addr) {
+    bool was_full = IsFull(span);
+    auto* obj = reinterpret_cast<FreeObject*>(addr);
+    obj->next = span->free_list;
+    span->free_list = obj;
+    span->used -= 1;
+    if (was_full) {
+      Link(span);
+    }
+    // keep one empty span per class around to avoid thrashing on alloc/free pairs
+    if (span->used == 0 && (span->prev || span->next)) {
+      Unlink(span);
+      SpanAllocator::Instance()->Free(span);
+    }
+  }
+
+ private:
+  SizeClassAllocator() {}
+
+  Span* NewSpan(uint32_t size_class) {
+    Span* span = SpanAllocator::Instance()->Alloc();
+    if (!span) {
+      return nullptr;
+    }
+    span->magic = SPAN_MAGIC ^ reinterpret_cast<uint64_t>(span);
+    span->size_class = size_class;
+    span->used = 0;
+    span->free_list = nullptr;
+    span->bump = reinterpret_cast<char*>(span) + SPAN_HEADER_SIZE;
+    span->prev = span->next = nullptr;
+    Link(span);
+    return span;
+  }
+
+  static bool IsFull(const Span* span) {
+    const char* end = reinterpret_cast<const char*>(span) + SPAN_SIZE;
+    return !span->free_list && span->bump + SIZE_CLASSES[span->size_class] > end;
+  }
+
+  void Link(Span* span) {
+    Span*& head = partial_[span->size_class];
+    span->prev = nullptr;
+    span->next = head;
+    if (head) {
+      head->prev = span;
+    }
+    head = span;
+  }
+
+  void Unlink(Span* span) {
+    if (span->prev) {
+      span->prev->next = span->next;
+    } else {
+      partial_[span->size_class] = span->next;
+    }
+    if (span->next) {
+      span->next->prev = span->prev;
+    }
+    span->prev = span->next = nullptr;
+  }
+
+  static constexpr auto class_index_ = MakeClassIndex();
+  Span* partial_[CLASS_NUM] = {nullptr};
+};
+
+// threads of a process share the heap, one which finds it taken sleeps on
+// the futex instead of spinning away the slice of a preempted holder
+static Mutex heap_lock;
+
+using HeapGuard = ScopedLock<Mutex>;
+
+static uint32_t HeaderUnites(uint32_t bytes) {
+  return (bytes + sizeof(Header) - 1) / sizeof(Header) + 1;
+}
+
+// header of a block produced by MemManager, nullptr if addr is not one of them
+static Header* LargeHeader(void* addr) {
+  auto* header = reinterpret_cast<Header*>(addr) - 1;
+  if (header->meta.data != addr) {
+    return nullptr;
+  }
+  // aligned_alloc leaves an alias in front of the returned address
+  if (!header->meta.size) {
+    header = header->meta.next;
+    if (!header || !header->meta.size || header->meta.data != header + 1) {
+      return nullptr;
+    }
+  }
+  return header;
+}
+
+static size_t UsableSize(void* addr) {
+  if (Span* span = SizeClassAllocator::SpanOf(addr)) {
+    return SIZE_CLASSES[span->size_class];
+  }
+  Header* header = LargeHeader(addr);
+  if (!header) {
+    return 0;
+  }
+  return reinterpret_cast<char*>(header + header->meta.size) - reinterpret_cast<char*>(addr);
+}
+
+// the heap lock is held by the callers of the Locked functions
+static void* MallocLocked(uint32_t bytes) {
+  if (bytes <= MAX_SMALL_SIZE) {
+    return SizeClassAllocator::Instance()->Alloc(bytes ? bytes : 1);
+  }
+  return MemManager::Instance()->FindFirstFitBlock(HeaderUnites(bytes));
+}
+
+static void FreeLocked(void* addr) {
+  if (Span* span = SizeClassAllocator::SpanOf(addr)) {
+    SizeClassAllocator::Instance()->Free(span, addr);
+    return;
+  }
+  // determine whether block is produced by malloc
+  Header* header = LargeHeader(addr);
+  if (!header) {
+    printf(PrintLevel::error, "free: not a valid addr: 0x%p\n", addr);
+    syscall::exit(-1);
+  }
+  MemManager::Instance()->FreeBlock(header);
+}
+
 void* malloc(uint32_t bytes) {
-  uint32_t unites = (bytes + sizeof(Header) - 1) / sizeof(Header) + 1;
-  return MemManager::Instance()->FindFirstFitBlock(unites);
+  HeapGuard guard(&heap_lock);
+  return MallocLocked(bytes);
 }
 
 void free(void* addr) {
@@ -135,13 +408,69 @@ void free(void* addr) {
     printf(PrintLevel::error, "free: not a valid addr: 0\n");
     syscall::exit(-1);
   }
-  auto* header = reinterpret_cast<Header*>(addr) - 1;
-  // determine whether block is produced by malloc
-  if (header->meta.data != addr || !header->meta.size) {
-    printf(PrintLevel::error, "free: not a valid addr: 0x%p\n", addr);
+  HeapGuard guard(&heap_lock);
+  FreeLocked(addr);
+}
+
+void* calloc(uint32_t num, uint32_t bytes) {
+  uint64_t total = static_cast<uint64_t>(num) * bytes;
+  if (total > UINT32_MAX) {
+    return nullptr;
+  }
+  void* addr = malloc(total);
+  if (addr) {
+    memset(addr, 0, total);
+  }
+  return addr;
+}
+
+void* realloc(void* addr, uint32_t bytes) {
+  if (!addr) {
+    return malloc(bytes);
+  }
+  // the header and span of addr are shared with blocks other threads free
+  HeapGuard guard(&heap_lock);
+  size_t old_size = UsableSize(addr);
+  if (!old_size) {
+    printf(PrintLevel::error, "realloc: not a valid addr: 0x%p\n", addr);
     syscall::exit(-1);
   }
-  MemManager::Instance()->FreeBlock(header);
+  if (bytes <= old_size && (bytes > MAX_SMALL_SIZE || old_size <= MAX_SMALL_SIZE)) {
+    return addr;
+  }
+  void* new_addr = MallocLocked(bytes);
+  if (!new_addr) {
+    return nullptr;
+  }
+  memcpy(new_addr, addr, old_size < bytes ? old_size : bytes);
+  FreeLocked(addr);
+  return new_addr;
+}
+
+void* aligned_alloc(uint32_t alignment, uint32_t bytes) {
+  if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+    return nullptr;
+  }
+  // size classes are multiples of the granule, large blocks are not aligned that well
+  if (alignment <= CLASS_GRANULE && bytes <= MAX_SMALL_SIZE) {
+    return malloc(bytes);
+  }
+  if (bytes > UINT32_MAX - alignment - sizeof(Header)) {
+    return nullptr;
+  }
+  HeapGuard guard(&heap_lock);
+  // reserve room for an alias header in front of the aligned address
+  auto* block = reinterpret_cast<char*>(MemManager::Instance()->FindFirstFitBlock(HeaderUnites(bytes + alignment + sizeof(Header))));
+  if (!block) {
+    return nullptr;
+  }
+  auto* header = reinterpret_cast<Header*>(block) - 1;
+  uint64_t aligned = (reinterpret_cast<uint64_t>(block) + sizeof(Header) + alignment - 1) & ~(uint64_t(alignment) - 1);
+  auto* alias = reinterpret_cast<Header*>(aligned) - 1;
+  alias->meta.next = header;
+  alias->meta.size = 0;
+  alias->meta.data = reinterpret_cast<void*>(aligned);
+  return alias->meta.data;
 }
 
 }  // nammespace lib
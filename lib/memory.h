@@ -6,6 +6,10 @@ namespace lib {
 
 void* malloc(uint32_t bytes);
 void free(void* addr);
+void* calloc(uint32_t num, uint32_t bytes);
+void* realloc(void* addr, uint32_t bytes);
+// alignment must be a power of two
+void* aligned_alloc(uint32_t alignment, uint32_t bytes);
 
 }  // namespace lib
 
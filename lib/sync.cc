@@ -0,0 +1,88 @@
+#include "lib/sync.h"
+
+#include "lib/syscall.h"
+
+namespace lib {
+
+// waiters_ is only a hint to skip futex_wake, the sequentially consistent
+// accesses order it against the word a waiter sleeps on
+
+constexpr int WAKE_ALL = 0x7fff'ffff;
+
+bool Mutex::TryLock() {
+  uint32_t expected = 0;
+  return __atomic_compare_exchange_n(&state_, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void Mutex::Lock() {
+  uint32_t c = 0;
+  if (__atomic_compare_exchange_n(&state_, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return;
+  }
+  // mark contended before sleeping so that the owner knows to wake us
+  if (c != 2) {
+    c = __atomic_exchange_n(&state_, 2, __ATOMIC_ACQUIRE);
+  }
+  while (c != 0) {
+    syscall::futex_wait(&state_, 2);
+    c = __atomic_exchange_n(&state_, 2, __ATOMIC_ACQUIRE);
+  }
+}
+
+void Mutex::UnLock() {
+  if (__atomic_fetch_sub(&state_, 1, __ATOMIC_RELEASE) != 1) {
+    __atomic_store_n(&state_, 0, __ATOMIC_RELEASE);
+    syscall::futex_wake(&state_, 1);
+  }
+}
+
+void CondVar::Wait(Mutex* mutex) {
+  uint32_t seq = __atomic_load_n(&seq_, __ATOMIC_ACQUIRE);
+  __atomic_fetch_add(&waiters_, 1, __ATOMIC_SEQ_CST);
+  mutex->UnLock();
+  // a signal between UnLock and the syscall bumps seq_, futex_wait returns at once then
+  syscall::futex_wait(&seq_, seq);
+  __atomic_fetch_sub(&waiters_, 1, __ATOMIC_RELAXED);
+  mutex->Lock();
+}
+
+void CondVar::Signal() {
+  __atomic_fetch_add(&seq_, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&waiters_, __ATOMIC_SEQ_CST) > 0) {
+    syscall::futex_wake(&seq_, 1);
+  }
+}
+
+void CondVar::Broadcast() {
+  __atomic_fetch_add(&seq_, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&waiters_, __ATOMIC_SEQ_CST) > 0) {
+    syscall::futex_wake(&seq_, WAKE_ALL);
+  }
+}
+
+bool Semaphore::TryWait() {
+  uint32_t c = __atomic_load_n(&count_, __ATOMIC_RELAXED);
+  while (c > 0) {
+    if (__atomic_compare_exchange_n(&count_, &c, c - 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Semaphore::Wait() {
+  while (!TryWait()) {
+    __atomic_fetch_add(&waiters_, 1, __ATOMIC_SEQ_CST);
+    syscall::futex_wait(&count_, 0);
+    __atomic_fetch_sub(&waiters_, 1, __ATOMIC_RELAXED);
+  }
+}
+
+void Semaphore::Post() {
+  __atomic_fetch_add(&count_, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&waiters_, __ATOMIC_SEQ_CST) > 0) {
+    syscall::futex_wake(&count_, 1);
+  }
+}
+
+}  // namespace lib
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace lib {
+
+// Blocking primitives on top of futex_wait/futex_wake. The uncontended
+// paths are a single atomic operation and never enter the kernel. They
+// work across processes as long as the object lives in shared memory.
+
+class Mutex {
+ public:
+  void Lock();
+  bool TryLock();
+  void UnLock();
+
+ private:
+  // 0: unlocked, 1: locked, 2: locked and somebody may sleep on it
+  uint32_t state_ = 0;
+};
+
+class CondVar {
+ public:
+  // mutex must be held, it is held again on return, wakeups may be spurious
+  void Wait(Mutex* mutex);
+  void Signal();
+  void Broadcast();
+
+ private:
+  uint32_t seq_ = 0;
+  uint32_t waiters_ = 0;
+};
+
+class Semaphore {
+ public:
+  explicit Semaphore(uint32_t count = 0) : count_(count) {}
+  void Wait();
+  bool TryWait();
+  void Post();
+
+ private:
+  uint32_t count_;
+  uint32_t waiters_ = 0;
+};
+
+template <typename T>
+class ScopedLock {
+ public:
+  ScopedLock(const ScopedLock&) = delete;
+  ScopedLock& operator= (const ScopedLock&) = delete;
+  explicit ScopedLock(T* lock) : lock_(lock) {
+    lock_->Lock();
+  }
+  ~ScopedLock() {
+    lock_->UnLock();
+  }
+
+ private:
+  T* lock_;
+};
+
+}  // namespace lib
@@ -4,6 +4,14 @@
 #include "kernel/sys_def/device_info.h"
 #include "lib/types.h"
 #include "filesystem/inode_def.h"
+#include "kernel/sys_def/rusage_def.h"
+#include "kernel/sys_def/time_def.h"
+#include "kernel/sys_def/io_def.h"
+#include "kernel/sys_def/mman_def.h"
+#include "kernel/sys_def/perf_def.h"
+#include "kernel/sys_def/prof_def.h"
+#include "kernel/sys_def/trace_def.h"
+#include "kernel/sys_def/uio_def.h"
 #include <array>
 namespace syscall {
   
@@ -34,6 +42,78 @@ int move_cursor(uint32_t x, uint32_t y);
 int detach_framebuffer();
 int dlopen(const char* path);
 int dlclose();
+// run fn(arg) on a new thread with a kernel provided stack, returns its tid
+int clone(void (*fn)(void*), void* arg);
+int thread_exit(int);
+int thread_join(int tid, int* exit = nullptr);
+// sleep while *addr == expected, returns -1 at once if it differs
+int futex_wait(uint32_t* addr, uint32_t expected);
+// wake up to num waiters of addr, returns how many were woken
+int futex_wake(uint32_t* addr, int num);
+// mtime resolution, rem gets the time left when woken early
+int nanosleep(const time_def::timespec* req, time_def::timespec* rem = nullptr);
+int clock_gettime(int clock_id, time_def::timespec* ts);
+// pid 0 is the caller, nice is in sched_def::NICE_MIN .. NICE_MAX. Only
+// the caller's thread group and its descendants can be changed, the real
+// time policies are only granted by init or by a real time caller
+int nice(int inc);
+int setpriority(int pid, int nice);
+int sched_setscheduler(int pid, int policy, int priority);
+// who is one of rusage_def::who
+int getrusage(int who, rusage_def::rusage* usage);
+// wait for the child pid, any child if pid is -1, usage gets what it and its descendants used
+int wait4(int pid, int* exit, rusage_def::rusage* usage = nullptr);
+// cmd is one of trace_def::ctl_cmd
+int trace_ctl(int cmd);
+// drain up to max_num records of the kernel trace rings
+int trace_read(trace_def::record* records, int max_num);
+// cmd is one of prof_def::ctl_cmd, period_us only used by start
+int prof_ctl(int cmd, uint64_t period_us);
+// drain up to max_num samples of the kernel profiler
+int prof_read(prof_def::sample* samples, int max_num);
+// count event of perf_def::type for the calling thread, returns the counter id,
+// counters start disabled
+int perf_open(int type, uint64_t config);
+// cmd is one of perf_def::ctl_cmd
+int perf_ctl(int id, int cmd);
+int perf_read(int id, uint64_t* value);
+// map the io_def::ring of the process, the same ring on every call
+int io_setup(io_def::ring** ring);
+// run up to to_submit queued entries, returns how many were consumed
+int io_enter(int to_submit);
+// fill or drain the buffers one after another, stops at the first one
+// not used up, iov_num is at most uio_def::MAX_IOV
+ssize_t readv(int fd, const uio_def::iovec* iov, int iov_num);
+ssize_t writev(int fd, const uio_def::iovec* iov, int iov_num);
+// at offset, the offset of fd is left alone
+ssize_t pread(int fd, void* buf, size_t count, uint64_t offset);
+ssize_t pwrite(int fd, const void* buf, size_t count, uint64_t offset);
+// whence is one of uio_def::whence, the new offset is put into *result,
+// it is at most fs::MAX_FILE_SIZE
+int lseek(int fd, int64_t offset, int whence, uint64_t* result);
+// copy from the regular file in_fd to out_fd, a regular file or a device,
+// without passing through user memory. in_fd is read at *offset, which is
+// advanced, or at its own offset when offset is null, returns bytes copied
+ssize_t sendfile(int out_fd, int in_fd, uint64_t* offset, size_t count);
+// the same between two regular files, null offsets use the fd ones
+ssize_t copy_file_range(int in_fd, uint64_t* in_offset, int out_fd, uint64_t* out_offset, size_t count);
+// fds[0] becomes the read end and fds[1] the write end, reads wait for
+// data and return 0 once every write end is closed
+int pipe(int* fds);
+// the new fd shares the open file, offset included, -1 on failure
+int dup(int fd);
+// new_fd is closed first if it is open, returns new_fd
+int dup2(int fd, int new_fd);
+// fd of the shared memory segment name, created with size bytes if there is
+// none yet, a null name makes an anonymous one
+int shm_open(const char* name, size_t size);
+// later shm_open create a new segment, existing fds and mappings keep theirs
+int shm_unlink(const char* name);
+// map the first length bytes of the segment of fd, all of it if length is 0,
+// prot is a mask of mman_def::prot. The address is put into *addr, the
+// mapping stays shared across fork and goes away with exec
+int mmap(int fd, size_t length, int prot, void** addr);
+int munmap(void* addr);
 
 }  // namespace syscall
 
@@ -0,0 +1,41 @@
+#include "lib/thread.h"
+
+#include "lib/memory.h"
+#include "lib/syscall.h"
+
+namespace lib {
+
+struct ThreadStart {
+  void (*fn)(void*);
+  void* arg;
+};
+
+// the kernel starts a thread with no return address, so leave through the syscall
+static void ThreadEntry(void* data) {
+  auto* start = reinterpret_cast<ThreadStart*>(data);
+  auto fn = start->fn;
+  auto* arg = start->arg;
+  free(start);
+  fn(arg);
+  syscall::thread_exit(0);
+}
+
+int thread_create(void (*fn)(void*), void* arg) {
+  auto* start = reinterpret_cast<ThreadStart*>(malloc(sizeof(ThreadStart)));
+  if (!start) {
+    return -1;
+  }
+  start->fn = fn;
+  start->arg = arg;
+  int tid = syscall::clone(ThreadEntry, start);
+  if (tid < 0) {
+    free(start);
+  }
+  return tid;
+}
+
+int thread_join(int tid, int* exit_code) {
+  return syscall::thread_join(tid, exit_code);
+}
+
+}  // namespace lib
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "lib/types.h"
+
+namespace lib {
+
+// Threads share the address space and open files of the process. A thread
+// finishes when its function returns, the exit code of thread_join is 0 then.
+int thread_create(void (*fn)(void*), void* arg);
+int thread_join(int tid, int* exit_code = nullptr);
+
+}  // namespace lib
@@ -0,0 +1,172 @@
+import bisect
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+# Symbolizes the output of the user 'prof' command.
+# usage: prof_symbolize.py [console_log] [--build-dir dir] [--elf name=path]
+#                          [--top n] [--folded out_file]
+# Reads stdin when no log is given. Kernel pcs are looked up in
+# kernel/kernel.elf, pcs of the profiled task in user/<name> of the build
+# directory, the binaries generate_asm dumped next to them are used when
+# no nm is installed. Prints a flat profile of self and total samples per
+# function, --folded writes one "comm;outer;...;leaf count" line per call
+# chain for flamegraph.pl. Kernel frames carry a [k] suffix.
+
+MODES = {'u': 'user', 'k': 'kernel', 'i': 'idle'}
+ASM_SYMBOL = re.compile(r'^([0-9a-f]+) <(.+)>:$')
+
+
+def demangle(names):
+  tool = shutil.which('c++filt')
+  if not tool or not names:
+    return names
+  out = subprocess.run([tool], input='\n'.join(names), capture_output=True, text=True).stdout
+  result = out.split('\n')[:len(names)]
+  return result if len(result) == len(names) else names
+
+
+class Symbols:
+  def __init__(self, path):
+    self.addrs = []
+    self.names = []
+    entries = self.from_nm(path) or self.from_asm(path + '.ASM')
+    entries.sort()
+    for addr, name in entries:
+      self.addrs.append(addr)
+      self.names.append(name)
+    self.names = demangle(self.names)
+
+  @staticmethod
+  def from_nm(path):
+    if not os.path.exists(path):
+      return []
+    for tool in ('riscv64-linux-gnu-nm', 'nm'):
+      if not shutil.which(tool):
+        continue
+      out = subprocess.run([tool, '-n', path], capture_output=True, text=True)
+      if out.returncode != 0:
+        continue
+      entries = []
+      for line in out.stdout.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in 'tTwW':
+          entries.append((int(parts[0], 16), parts[2]))
+      return entries
+    return []
+
+  @staticmethod
+  def from_asm(path):
+    entries = []
+    if not os.path.exists(path):
+      return entries
+    with open(path, errors='replace') as f:
+      for line in f:
+        m = ASM_SYMBOL.match(line.strip())
+        if m:
+          entries.append((int(m.group(1), 16), m.group(2)))
+    return entries
+
+  def lookup(self, pc):
+    i = bisect.bisect_right(self.addrs, pc) - 1
+    if i < 0:
+      return None
+    return self.names[i]
+
+
+def parse(lines):
+  tasks = {}
+  samples = []
+  dropped = 0
+  for line in lines:
+    m = re.search(r'prof task (\d+) (\S+)', line)
+    if m:
+      tasks[int(m.group(1))] = os.path.basename(m.group(2))
+      continue
+    m = re.search(r'prof samples \d+ dropped (\d+)', line)
+    if m:
+      dropped = int(m.group(1))
+      continue
+    m = re.search(r'prof (\d+) ([uki]) (\d+)((?: [0-9a-f]+)+)', line)
+    if m:
+      pcs = [int(pc, 16) for pc in m.group(4).split()]
+      samples.append((int(m.group(1)), m.group(2), pcs))
+  return tasks, samples, dropped
+
+
+def main(argv):
+  build_dir = 'build'
+  elfs = {}
+  top = 30
+  folded = None
+  paths = []
+  i = 1
+  while i < len(argv):
+    if argv[i] == '--build-dir':
+      build_dir = argv[i + 1]
+    elif argv[i] == '--elf':
+      name, path = argv[i + 1].split('=', 1)
+      elfs[name] = path
+    elif argv[i] == '--top':
+      top = int(argv[i + 1])
+    elif argv[i] == '--folded':
+      folded = argv[i + 1]
+    else:
+      paths.append(argv[i])
+      i += 1
+      continue
+    i += 2
+  if paths:
+    with open(paths[0], errors='replace') as f:
+      tasks, samples, dropped = parse(f)
+  else:
+    tasks, samples, dropped = parse(sys.stdin)
+  if not samples:
+    print('no prof samples found')
+    return 1
+
+  kernel = Symbols(elfs.get('kernel', os.path.join(build_dir, 'kernel', 'kernel.elf')))
+  users = {}
+  for name in set(tasks.values()):
+    users[name] = Symbols(elfs.get(name, os.path.join(build_dir, 'user', name)))
+
+  self_count = {}
+  total_count = {}
+  stacks = {}
+  for pid, mode, pcs in samples:
+    comm = tasks.get(pid, 'idle' if mode == 'i' else 'pid{}'.format(pid))
+    symbols = kernel if mode != 'u' else users.get(comm)
+    suffix = '' if mode == 'u' else ' [k]'
+    frames = []
+    for depth, pc in enumerate(pcs):
+      # return addresses point past the call, look up the call itself
+      name = symbols.lookup(pc if depth == 0 else pc - 1) if symbols else None
+      frames.append((name or '{:#x}'.format(pc)) + suffix)
+    self_count[frames[0]] = self_count.get(frames[0], 0) + 1
+    for frame in set(frames):
+      total_count[frame] = total_count.get(frame, 0) + 1
+    key = ';'.join([comm] + frames[::-1])
+    stacks[key] = stacks.get(key, 0) + 1
+
+  num = len(samples)
+  by_mode = {}
+  for _, mode, _ in samples:
+    by_mode[MODES[mode]] = by_mode.get(MODES[mode], 0) + 1
+  print('{} samples, {}'.format(num, ', '.join('{} {:.1f}%'.format(m, c * 100.0 / num) for m, c in sorted(by_mode.items()))))
+  print('\n{:>8} {:>7} {:>8} {:>7}  function'.format('self', '', 'total', ''))
+  for name, count in sorted(self_count.items(), key=lambda x: -x[1])[:top]:
+    total = total_count[name]
+    print('{:>8} {:>6.1f}% {:>8} {:>6.1f}%  {}'.format(count, count * 100.0 / num, total, total * 100.0 / num, name))
+  if folded:
+    with open(folded, 'w') as f:
+      for key, count in sorted(stacks.items()):
+        f.write('{} {}\n'.format(key, count))
+  if dropped:
+    print('\n{} samples were dropped, lower the frequency'.format(dropped))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,132 @@
+import os
+import re
+import struct
+import sys
+
+# Decodes the output of the user 'trace dump' command.
+# usage: trace_decode.py [console_log] [--freq mtime_hz]
+# Reads stdin when no log is given, prints every event followed by
+# syscall latencies and the delay from wakeup until a task runs again.
+
+# keep in sync with kernel/sys_def/trace_def.h
+RECORD = struct.Struct('<QHHiQQ')
+EVENTS = {
+  1: 'syscall_enter',
+  2: 'syscall_exit',
+  3: 'switch_in',
+  4: 'switch_out',
+  5: 'sleep',
+  6: 'wakeup',
+  7: 'virtio_submit',
+  8: 'virtio_complete',
+  9: 'page_fault',
+}
+STATES = ['unused', 'used', 'sleep', 'runnable', 'running', 'zombie']
+
+
+def load_syscall_names():
+  path = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'kernel', 'syscalls', 'syscall_num_def.h')
+  names = {}
+  if not os.path.exists(path):
+    return names
+  with open(path) as f:
+    for line in f:
+      m = re.match(r'#define SYSCALL_(\w+)\s+(\d+)', line)
+      if m:
+        names[int(m.group(2))] = m.group(1)
+  return names
+
+
+def parse(lines):
+  records = []
+  dropped = 0
+  for line in lines:
+    m = re.search(r'trace ([0-9a-f]{%d})\b' % (RECORD.size * 2), line)
+    if m:
+      records.append(RECORD.unpack(bytes.fromhex(m.group(1))))
+      continue
+    m = re.search(r'trace dropped (\d+)', line)
+    if m:
+      dropped = int(m.group(1))
+  records.sort(key=lambda r: r[0])
+  return records, dropped
+
+
+def describe(event, arg0, arg1, syscalls):
+  if event in (1, 2):
+    value = arg1 if event == 1 else struct.unpack('<q', struct.pack('<Q', arg1))[0]
+    return '{} {}'.format(syscalls.get(arg0, arg0), value)
+  if event == 4:
+    return STATES[arg0] if arg0 < len(STATES) else str(arg0)
+  if event == 5:
+    return 'channel {:#x}'.format(arg0)
+  if event == 6:
+    return 'pid {} channel {:#x}'.format(arg0, arg1)
+  if event in (7, 8):
+    return 'device {:#x} {:#x}'.format(arg0, arg1)
+  if event == 9:
+    return 'addr {:#x} pc {:#x}'.format(arg0, arg1)
+  return ''
+
+
+def summarize(name, samples, us):
+  if not samples:
+    return
+  samples.sort()
+  print('  {:<16} count {:>6}  avg {:>10.1f}us  p50 {:>10.1f}us  max {:>10.1f}us'.format(
+    name, len(samples), us(sum(samples) / len(samples)), us(samples[len(samples) // 2]), us(samples[-1])))
+
+
+def main(argv):
+  freq = 10000000
+  paths = []
+  i = 1
+  while i < len(argv):
+    if argv[i] == '--freq':
+      freq = int(argv[i + 1])
+      i += 2
+      continue
+    paths.append(argv[i])
+    i += 1
+  if paths:
+    with open(paths[0], errors='replace') as f:
+      records, dropped = parse(f)
+  else:
+    records, dropped = parse(sys.stdin)
+  if not records:
+    print('no trace records found')
+    return 1
+  us = lambda mtime: mtime * 1000000.0 / freq
+  syscalls = load_syscall_names()
+  start = records[0][0]
+  for timestamp, hart, event, pid, arg0, arg1 in records:
+    print('{:>12.1f}us hart {} pid {:>4} {:<16} {}'.format(
+      us(timestamp - start), hart, pid, EVENTS.get(event, event), describe(event, arg0, arg1, syscalls)))
+
+  latency = {}
+  pending_syscall = {}
+  woken_at = {}
+  wakeup_delay = []
+  for timestamp, hart, event, pid, arg0, arg1 in records:
+    if event == 1:
+      pending_syscall[pid] = (arg0, timestamp)
+    elif event == 2 and pid in pending_syscall:
+      num, enter = pending_syscall.pop(pid)
+      latency.setdefault(syscalls.get(num, str(num)), []).append(timestamp - enter)
+    elif event == 6:
+      woken_at.setdefault(arg0, timestamp)
+    elif event == 3 and pid in woken_at:
+      wakeup_delay.append(timestamp - woken_at.pop(pid))
+
+  print('\nsyscall latency')
+  for name in sorted(latency):
+    summarize(name, latency[name], us)
+  print('\nwakeup to run')
+  summarize('all', wakeup_delay, us)
+  if dropped:
+    print('\n{} records were dropped, drain more often or trace a shorter run'.format(dropped))
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv))
@@ -0,0 +1,347 @@
+#include <algorithm>
+
+#include "kernel/sys_def/device_info.h"
+#include "lib/clock.h"
+#include "lib/lib.h"
+#include "lib/memory.h"
+#include "lib/string.h"
+#include "lib/syscall.h"
+#include "lib/thread.h"
+
+// Latency of kernel paths measured from user mode, one cycle count per
+// operation. Every test prints a single line
+//   bench <test> iters=N min=C median=C p99=C unit=cycles [bytes=B kb_per_s=K]
+// so logs of different commits can be compared with a script.
+
+static constexpr int MAX_ITERS = 10'000;
+static uint64_t samples[MAX_ITERS];
+
+// the files of the disk hold at most (12 + 128) blocks, stay below that
+static constexpr int IO_BLOCK = 512;
+static constexpr int IO_BLOCKS_PER_FILE = 128;
+static constexpr const char* IO_FILE = "bench.dat";
+static char io_buf[IO_BLOCK];
+
+static const char* self_path = nullptr;
+
+static void Report(const char* name, int iters, uint64_t bytes, uint64_t total_ns) {
+  std::sort(samples, samples + iters);
+  uint64_t min = samples[0];
+  uint64_t median = samples[iters / 2];
+  uint64_t p99 = samples[std::min(iters - 1, iters * 99 / 100)];
+  printf("bench %s iters=%d min=%lu median=%lu p99=%lu unit=cycles", name, iters, min, median, p99);
+  if (bytes && total_ns) {
+    printf(" bytes=%lu kb_per_s=%lu", bytes, bytes * iters * 1'000'000 / 1024 / (total_ns / 1000 + 1));
+  }
+  printf("\n");
+}
+
+// time op() iters times, op returns false when the kernel refused
+template <typename F>
+static bool Run(const char* name, int iters, uint64_t bytes, F&& op) {
+  uint64_t start_ns = lib::clock_now();
+  for (int i = 0; i < iters; ++i) {
+    uint64_t start = lib::cycle_now();
+    if (!op()) {
+      printf(PrintLevel::error, "bench %s failed at iteration %d\n", name, i);
+      return false;
+    }
+    samples[i] = lib::cycle_now() - start;
+  }
+  Report(name, iters, bytes, lib::clock_now() - start_ns);
+  return true;
+}
+
+static bool BenchSyscall(int iters) {
+  return Run("syscall", iters, 0, [] {
+    return syscall::getpid() > 0;
+  });
+}
+
+static bool BenchFork(int iters) {
+  return Run("fork", iters, 0, [] {
+    int pid = syscall::fork();
+    if (pid == 0) {
+      syscall::exit(0);
+    }
+    return pid > 0 && syscall::wait4(pid, nullptr) == pid;
+  });
+}
+
+static bool BenchExec(int iters) {
+  return Run("fork_exec", iters, 0, [] {
+    int pid = syscall::fork();
+    if (pid == 0) {
+      const char* argv[] = {self_path, "nop", nullptr};
+      syscall::exec(self_path, argv);
+      syscall::exit(-1);
+    }
+    int exit_code = -1;
+    return pid > 0 && syscall::wait4(pid, &exit_code) == pid && exit_code == 0;
+  });
+}
+
+// 0 is the turn of the main thread, 1 the one of the partner, 2 stops it
+static uint32_t turn = 0;
+
+static void Partner(void*) {
+  while (true) {
+    uint32_t t;
+    while ((t = __atomic_load_n(&turn, __ATOMIC_ACQUIRE)) == 0) {
+      syscall::futex_wait(&turn, 0);
+    }
+    if (t == 2) {
+      return;
+    }
+    __atomic_store_n(&turn, 0, __ATOMIC_RELEASE);
+    syscall::futex_wake(&turn, 1);
+  }
+}
+
+// one sample is a round trip, two switches between threads of a process
+static bool BenchContextSwitch(int iters) {
+  __atomic_store_n(&turn, 0, __ATOMIC_RELEASE);
+  int partner = lib::thread_create(Partner, nullptr);
+  if (partner < 0) {
+    printf(PrintLevel::error, "bench ctxsw: cannot create thread\n");
+    return false;
+  }
+  bool ok = Run("ctxsw", iters, 0, [] {
+    __atomic_store_n(&turn, 1, __ATOMIC_RELEASE);
+    syscall::futex_wake(&turn, 1);
+    while (__atomic_load_n(&turn, __ATOMIC_ACQUIRE) == 1) {
+      syscall::futex_wait(&turn, 1);
+    }
+    return true;
+  });
+  __atomic_store_n(&turn, 2, __ATOMIC_RELEASE);
+  syscall::futex_wake(&turn, 1);
+  lib::thread_join(partner);
+  return ok;
+}
+
+// passes over the file from its start, one sample per block, reopening
+// is the only way back to offset 0 and is not part of the samples
+template <typename F>
+static bool RunFile(const char* name, int iters, F&& op) {
+  uint64_t total_ns = 0;
+  for (int i = 0; i < iters;) {
+    int fd = syscall::open(IO_FILE);
+    if (fd < 0) {
+      printf(PrintLevel::error, "bench %s: cannot open %s\n", name, IO_FILE);
+      return false;
+    }
+    uint64_t start_ns = lib::clock_now();
+    for (int block = 0; block < IO_BLOCKS_PER_FILE && i < iters; ++block, ++i) {
+      uint64_t start = lib::cycle_now();
+      if (!op(fd)) {
+        printf(PrintLevel::error, "bench %s failed at iteration %d\n", name, i);
+        syscall::close(fd);
+        return false;
+      }
+      samples[i] = lib::cycle_now() - start;
+    }
+    total_ns += lib::clock_now() - start_ns;
+    syscall::close(fd);
+  }
+  Report(name, iters, IO_BLOCK, total_ns);
+  return true;
+}
+
+static bool BenchSeqWrite(int iters) {
+  int fd = syscall::create(IO_FILE, fs::FileType::regular_file);
+  if (fd >= 0) {
+    syscall::close(fd);
+  }
+  memset(io_buf, 'b', sizeof(io_buf));
+  return RunFile("seq_write", iters, [](int fd) {
+    return syscall::write(fd, io_buf, IO_BLOCK) == IO_BLOCK;
+  });
+}
+
+static bool BenchSeqRead(int iters) {
+  return RunFile("seq_read", iters, [](int fd) {
+    return syscall::read(fd, io_buf, IO_BLOCK) == IO_BLOCK;
+  });
+}
+
+// block offsets of a small lcg, every block of the file gets its turn
+template <typename F>
+static bool RunRandom(const char* name, int iters, F&& op) {
+  int fd = syscall::open(IO_FILE);
+  if (fd < 0) {
+    printf(PrintLevel::error, "bench %s: cannot open %s, run seq_write first\n", name, IO_FILE);
+    return false;
+  }
+  uint32_t seed = 1;
+  bool ok = Run(name, iters, IO_BLOCK, [fd, &seed, &op] {
+    seed = seed * 1103515245 + 12345;
+    return op(fd, static_cast<uint64_t>((seed >> 16) % IO_BLOCKS_PER_FILE) * IO_BLOCK);
+  });
+  syscall::close(fd);
+  return ok;
+}
+
+static bool BenchRandRead(int iters) {
+  return RunRandom("rand_read", iters, [](int fd, uint64_t offset) {
+    return syscall::pread(fd, io_buf, IO_BLOCK, offset) == IO_BLOCK;
+  });
+}
+
+static bool BenchRandWrite(int iters) {
+  return RunRandom("rand_write", iters, [](int fd, uint64_t offset) {
+    return syscall::pwrite(fd, io_buf, IO_BLOCK, offset) == IO_BLOCK;
+  });
+}
+
+// one sample copies the whole file inside the kernel
+static bool BenchCopyRange(int iters) {
+  constexpr const char* copy_file = "bench.cp";
+  int out = syscall::create(copy_file, fs::FileType::regular_file);
+  if (out < 0) {
+    out = syscall::open(copy_file);
+  }
+  int in = syscall::open(IO_FILE);
+  if (in < 0 || out < 0) {
+    printf(PrintLevel::error, "bench copy_range: cannot open %s, run seq_write first\n", IO_FILE);
+    return false;
+  }
+  constexpr uint64_t size = IO_BLOCKS_PER_FILE * IO_BLOCK;
+  bool ok = Run("copy_range", iters, size, [in, out] {
+    uint64_t in_offset = 0;
+    uint64_t out_offset = 0;
+    return syscall::copy_file_range(in, &in_offset, out, &out_offset, size) == size;
+  });
+  syscall::close(in);
+  syscall::close(out);
+  return ok;
+}
+
+// one sample maps a segment into the caller and drops it again, the pages
+// are only referenced, nothing is copied
+static bool BenchShmMap(int iters) {
+  constexpr size_t size = 1024 * 1024;
+  int fd = syscall::shm_open(nullptr, size);
+  if (fd < 0) {
+    printf(PrintLevel::error, "bench shm_map: cannot create a segment\n");
+    return false;
+  }
+  bool ok = Run("shm_map", iters, size, [fd] {
+    void* addr = nullptr;
+    if (syscall::mmap(fd, 0, mman_def::read | mman_def::write, &addr) < 0) {
+      return false;
+    }
+    return syscall::munmap(addr) == 0;
+  });
+  syscall::close(fd);
+  return ok;
+}
+
+static bool BenchSbrk(int iters) {
+  // the heap never shrinks, do not eat up all memory
+  iters = std::min(iters, 256);
+  return Run("sbrk", iters, 4096, [] {
+    return syscall::sbrk(4096) != nullptr;
+  });
+}
+
+static bool BenchMalloc(int iters) {
+  return Run("malloc", iters, 64, [] {
+    void* p = lib::malloc(64);
+    if (!p) {
+      return false;
+    }
+    lib::free(p);
+    return true;
+  });
+}
+
+static bool BenchFrameFlush(int iters) {
+  uint8_t* buffer = syscall::framebuffer();
+  if (!buffer) {
+    printf(PrintLevel::error, "bench frame_flush: no framebuffer\n");
+    return false;
+  }
+  device_info::screen_info info{};
+  syscall::get_screen_info(&info);
+  uint64_t frame_bytes = static_cast<uint64_t>(info.width) * info.height * 4;
+  uint8_t shade = 0;
+  bool ok = Run("frame_flush", iters, frame_bytes, [buffer, frame_bytes, &shade] {
+    // touch a line so the flush has something to move
+    memset(buffer, shade++, std::min<uint64_t>(frame_bytes, 4096));
+    return syscall::frame_flush() >= 0;
+  });
+  syscall::detach_framebuffer();
+  return ok;
+}
+
+struct Test {
+  const char* name;
+  bool (*fn)(int iters);
+  // default iterations, the slow ones run fewer
+  int iters;
+};
+
+static const Test tests[] = {
+  {"syscall", BenchSyscall, 10'000},
+  {"fork", BenchFork, 200},
+  {"fork_exec", BenchExec, 100},
+  {"ctxsw", BenchContextSwitch, 2'000},
+  {"seq_write", BenchSeqWrite, 512},
+  {"seq_read", BenchSeqRead, 512},
+  {"rand_read", BenchRandRead, 512},
+  {"rand_write", BenchRandWrite, 512},
+  {"copy_range", BenchCopyRange, 20},
+  {"shm_map", BenchShmMap, 200},
+  {"sbrk", BenchSbrk, 256},
+  {"malloc", BenchMalloc, 10'000},
+  {"frame_flush", BenchFrameFlush, 100},
+};
+
+// a decimal in 0..max, checked digit by digit so that long inputs cannot overflow
+static bool ParseInt(const char* s, int max, int* value) {
+  if (!*s) {
+    return false;
+  }
+  int v = 0;
+  for (; *s; ++s) {
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    v = v * 10 + (*s - '0');
+    if (v > max) {
+      return false;
+    }
+  }
+  *value = v;
+  return true;
+}
+
+// bench [-n iters] [test...], all tests but frame_flush when none is given
+int main(int argc, char** argv) {
+  self_path = argv[0];
+  // the child of fork_exec
+  if (argc == 2 && strcmp(argv[1], "nop") == 0) {
+    return 0;
+  }
+  int iters = 0;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    if (!ParseInt(argv[2], MAX_ITERS, &iters) || iters <= 0) {
+      printf(PrintLevel::error, "bench: iterations must be in 1..%d\n", MAX_ITERS);
+      return -1;
+    }
+    first = 3;
+  }
+  int failed = 0;
+  for (const Test& test : tests) {
+    bool selected = first == argc && strcmp(test.name, "frame_flush") != 0;
+    for (int i = first; i < argc; ++i) {
+      selected |= strcmp(argv[i], test.name) == 0;
+    }
+    if (selected && !test.fn(iters ? iters : test.iters)) {
+      failed += 1;
+    }
+  }
+  return failed ? -1 : 0;
+}
@@ -1,12 +1,33 @@
 #include "filesystem/inode_def.h"
 #include "kernel/sys_def/descriptor_def.h"
+#include "lib/io_ring.h"
 #include "lib/lib.h"
 #include "lib/syscall.h"
 
+static constexpr size_t COPY_CHUNK = 64 * 1024;
+
+// for what sendfile does not take, like /proc files and pipes
+static void CopyThroughUser(lib::IoRing* ring, int fd) {
+  if (ring) {
+    lib::io_copy(ring, fd, descriptor_def::io::console);
+    return;
+  }
+  int n;
+  char buf[512];
+  while ((n = syscall::read(fd, buf, sizeof(buf))) > 0) {
+    syscall::write(descriptor_def::io::console, buf, n);
+  }
+}
+
 int main(int argc, char** argv) {
+  // with no file the input is copied, e.g. the read end of a pipe, not
+  // through the ring which takes the first short read for the end
   if (argc < 2) {
+    CopyThroughUser(nullptr, descriptor_def::io::input);
     return 0;
   }
+  lib::IoRing ring;
+  bool has_ring = ring.Init();
   for (int i = 1; i < argc; i++) {
     int fd = syscall::open(argv[i]);
     if (fd < 0) {
@@ -19,10 +40,12 @@ int main(int argc, char** argv) {
       printf("cat: %s: Not a regular file\n", argv[i]);
       continue;
     }
-    int n;
-    char buf[512];
-    while ((n = syscall::read(fd, buf, sizeof(buf))) > 0) {
-      syscall::write(descriptor_def::io::console, buf, n);
+    // the kernel moves regular files by itself
+    int64_t sent;
+    while ((sent = syscall::sendfile(descriptor_def::io::console, fd, nullptr, COPY_CHUNK)) > 0) {
+    }
+    if (sent < 0) {
+      CopyThroughUser(has_ring ? &ring : nullptr, fd);
     }
     syscall::write(descriptor_def::io::console, reinterpret_cast<const char*>(0x0), 5);
     printf("\n");
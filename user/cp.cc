@@ -1,10 +1,13 @@
 #include "filesystem/inode_def.h"
+#include "lib/io_ring.h"
 #include "lib/lib.h"
 #include "lib/stl/smart_pointer.h"
 #include "lib/stringpp.h"
 #include "lib/syscall.h"
 #include "lib/stl/vector.h"
 
+static constexpr size_t COPY_CHUNK = 64 * 1024;
+
 int main(int argc, char** argv) {
   if (argc < 3) {
     printf(PrintLevel::error, "cp: missing operand\nTry 'cp --help' for more information.\n");
@@ -33,6 +36,8 @@ int main(int argc, char** argv) {
       return -1;
     }
   }
+  lib::IoRing ring;
+  bool has_ring = ring.Init();
   lib::string dest_path = lib::string(dest);
   if (dest_state.type == fs::FileType::directory && dest_path[dest_path.size() - 1] != '/') {
     dest_path.append('/');
@@ -45,6 +50,17 @@ int main(int argc, char** argv) {
       target = dest_path;
     }
     int target_fd = syscall::create(target.c_str(), fs::FileType::regular_file);
+    // the kernel copies between regular files by itself
+    int64_t copied;
+    while ((copied = syscall::copy_file_range((*src_fds)[i - 1], nullptr, target_fd, nullptr, COPY_CHUNK)) > 0) {
+    }
+    if (copied == 0) {
+      continue;
+    }
+    if (has_ring) {
+      lib::io_copy(&ring, (*src_fds)[i - 1], target_fd);
+      continue;
+    }
     char buf[512];
     int cnt;
     while ((cnt = syscall::read((*src_fds)[i - 1], buf, sizeof(buf))) > 0) {
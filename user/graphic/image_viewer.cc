@@ -1,6 +1,7 @@
 #include "user/graphic/image_viewer.h"
 #include "filesystem/inode_def.h"
 #include "lib/common.h"
+#include "lib/io_ring.h"
 #include "lib/lib.h"
 #include "lib/stl/smart_pointer.h"
 #include "lib/syscall.h"
@@ -86,22 +87,34 @@ class bmpParser : public ImageParser {
     uint32_t img_size = header_.bmp_header.height * row_size;
     uint32_t padding = ((row_size) % 4) == 0 ? 0 : 4 - ((row_size) % 4);
     data->resize(img_size);
+    lib::IoRing ring;
+    bool has_ring = ring.Init();
+    char padding_buf[4];
+    io_def::cqe cqe;
     for (uint32_t row_index = 0; row_index < header_.bmp_header.height; ++row_index) {
-      uint32_t size = row_size;
       // pixels are stored bottom to top instead of top to bottom
       char* buf = reinterpret_cast<char*>(data->data() + (header_.bmp_header.height - row_index - 1) * row_size);
-      while (size > 0) {
-        constexpr size_t size_per_batch = 128;
-        const size_t count = size > size_per_batch ? size_per_batch : size;
-        syscall::read(fd_, buf, count);
-        buf += count;
-        size -= count;
+      if (!has_ring) {
+        syscall::read(fd_, buf, row_size);
+        if (padding) {
+          syscall::read(fd_, padding_buf, padding);
+        }
+        continue;
       }
+      // a row and its padding in one go, a full ring is read with one trap
+      if (io_def::RING_ENTRIES - ring.Pending() < 2) {
+        ring.Submit();
+        while (ring.Reap(&cqe)) {}
+      }
+      ring.QueueRead(fd_, buf, row_size);
       if (padding) {
-        char padding_buf[4];
-        syscall::read(fd_, padding_buf, padding);
+        ring.QueueRead(fd_, padding_buf, padding);
       }
     }
+    if (has_ring && ring.Pending()) {
+      ring.Submit();
+      while (ring.Reap(&cqe)) {}
+    }
     return true;
   }
 
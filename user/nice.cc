@@ -0,0 +1,45 @@
+#include "lib/lib.h"
+#include "lib/string.h"
+#include "lib/syscall.h"
+
+static bool ParseInt(const char* s, int* value) {
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') {
+    s++;
+  }
+  if (!*s) {
+    return false;
+  }
+  int v = 0;
+  for (; *s; ++s) {
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    v = v * 10 + (*s - '0');
+  }
+  *value = negative ? -v : v;
+  return true;
+}
+
+// nice [-n adjustment] command [args...]
+int main(int argc, char** argv) {
+  int adjustment = 10;
+  int cmd = 1;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+    if (!ParseInt(argv[2], &adjustment)) {
+      printf(PrintLevel::error, "nice: invalid adjustment '%s'\n", argv[2]);
+      return -1;
+    }
+    cmd = 3;
+  }
+  if (cmd >= argc) {
+    printf(PrintLevel::error, "nice: missing operand\nTry 'nice -n 10 command'.\n");
+    return -1;
+  }
+  if (syscall::nice(adjustment) < 0) {
+    printf(PrintLevel::error, "nice: cannot set niceness\n");
+  }
+  syscall::exec(argv[cmd], argv + cmd);
+  printf("%s: command not found\n", argv[cmd]);
+  return -1;
+}
@@ -0,0 +1,135 @@
+#include "lib/lib.h"
+#include "lib/string.h"
+#include "lib/syscall.h"
+#include "lib/thread.h"
+
+// the kernel rings hold little, samples are moved here while the command runs
+static constexpr int MAX_SAMPLES = 4096;
+static prof_def::sample samples[MAX_SAMPLES];
+static int sample_num = 0;
+static bool done = false;
+
+static void Drain() {
+  while (sample_num < MAX_SAMPLES) {
+    int num = syscall::prof_read(samples + sample_num, MAX_SAMPLES - sample_num);
+    if (num <= 0) {
+      break;
+    }
+    sample_num += num;
+  }
+}
+
+static void Drainer(void*) {
+  time_def::timespec interval{0, 20'000'000};
+  while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+    syscall::nanosleep(&interval);
+    Drain();
+  }
+}
+
+static char* PutHex(char* p, uint64_t v) {
+  const char* digits = "0123456789abcdef";
+  int shift = 60;
+  while (shift > 0 && (v >> shift) == 0) {
+    shift -= 4;
+  }
+  for (; shift >= 0; shift -= 4) {
+    *p++ = digits[(v >> shift) & 0xf];
+  }
+  return p;
+}
+
+static char* PutDec(char* p, uint64_t v) {
+  char buf[20];
+  int n = 0;
+  do {
+    buf[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v);
+  while (n > 0) {
+    *p++ = buf[--n];
+  }
+  return p;
+}
+
+// One line per sample, "prof pid mode hart pc...", innermost pc first.
+// tools/prof_symbolize.py turns a console log of them into profiles.
+static void Print() {
+  static const char* modes[] = {"u", "k", "i"};
+  for (int i = 0; i < sample_num; ++i) {
+    const prof_def::sample& sample = samples[i];
+    char line[32 + 17 * prof_def::MAX_DEPTH];
+    char* p = line;
+    memcpy(p, "prof ", 5);
+    p = PutDec(p + 5, sample.pid);
+    *p++ = ' ';
+    *p++ = *modes[sample.mode <= prof_def::idle ? sample.mode : prof_def::idle];
+    *p++ = ' ';
+    p = PutDec(p, sample.hart);
+    for (int j = 0; j < sample.depth && j < prof_def::MAX_DEPTH; ++j) {
+      *p++ = ' ';
+      p = PutHex(p, sample.pc[j]);
+    }
+    *p++ = '\n';
+    syscall::write(1, line, p - line);
+  }
+}
+
+static bool ParseInt(const char* s, int* value) {
+  if (!*s) {
+    return false;
+  }
+  int v = 0;
+  for (; *s; ++s) {
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    v = v * 10 + (*s - '0');
+  }
+  *value = v;
+  return true;
+}
+
+// prof [-f hz] command [args...]
+int main(int argc, char** argv) {
+  int hz = 1000;
+  int cmd = 1;
+  if (argc > 2 && strcmp(argv[1], "-f") == 0) {
+    if (!ParseInt(argv[2], &hz) || hz <= 0 || hz > 100'000) {
+      printf(PrintLevel::error, "prof: invalid frequency '%s'\n", argv[2]);
+      return -1;
+    }
+    cmd = 3;
+  }
+  if (cmd >= argc) {
+    printf(PrintLevel::error, "prof: missing operand\nUsage: prof [-f hz] command [args...]\n");
+    return -1;
+  }
+  int drainer = lib::thread_create(Drainer, nullptr);
+  if (drainer < 0) {
+    printf(PrintLevel::error, "prof: cannot create drainer thread\n");
+    return -1;
+  }
+  syscall::prof_ctl(prof_def::start, 1'000'000 / hz);
+  int sub_process = syscall::fork();
+  if (sub_process < 0) {
+    syscall::prof_ctl(prof_def::stop, 0);
+    printf(PrintLevel::error, "prof: fork failed\n");
+    return -1;
+  }
+  if (sub_process == 0) {
+    syscall::exec(argv[cmd], argv + cmd);
+    printf("%s: command not found\n", argv[cmd]);
+    syscall::exit(-1);
+  }
+  int exit_code = 0;
+  syscall::wait4(sub_process, &exit_code);
+  syscall::prof_ctl(prof_def::stop, 0);
+  __atomic_store_n(&done, true, __ATOMIC_RELEASE);
+  lib::thread_join(drainer);
+  Drain();
+  printf("prof task %d %s\n", sub_process, argv[cmd]);
+  Print();
+  printf("prof samples %d dropped %d\n", sample_num, syscall::prof_ctl(prof_def::dropped, 0));
+  return exit_code;
+}
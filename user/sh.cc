@@ -4,7 +4,168 @@
 #include "lib/syscall.h"
 #include "filesystem/inode_def.h"
 #include "kernel/resource.h"
+#include "kernel/sys_def/descriptor_def.h"
 #include "kernel/sys_def/syscall_err.h"
+#include "kernel/sys_def/uio_def.h"
+
+static constexpr int MAX_TOKENS = 16;
+static constexpr int MAX_COMMANDS = 8;
+
+// one stage of a pipeline, with the files of its redirections
+struct Command {
+  char* argv[MAX_TOKENS + 1];
+  const char* input;
+  const char* output;
+  bool append;
+};
+
+// Splits the tokens of a line at "|" into commands and takes "< file",
+// "> file" and ">> file" out of their arguments. The operators have to
+// stand apart like every token. Returns the number of commands or -1.
+static int ParseLine(char tokens[][32], int token_num, Command* commands) {
+  int num = 0;
+  int argc = 0;
+  commands[0] = Command{};
+  for (int i = 0; i < token_num; ++i) {
+    char* token = tokens[i];
+    if (strcmp(token, "|") == 0) {
+      if (argc == 0 || num + 1 == MAX_COMMANDS) {
+        printf(PrintLevel::error, "sh: syntax error near '|'\n");
+        return -1;
+      }
+      commands[num].argv[argc] = nullptr;
+      commands[++num] = Command{};
+      argc = 0;
+      continue;
+    }
+    bool is_input = strcmp(token, "<") == 0;
+    bool is_output = strcmp(token, ">") == 0 || strcmp(token, ">>") == 0;
+    if (is_input || is_output) {
+      if (i + 1 == token_num) {
+        printf(PrintLevel::error, "sh: syntax error near '%s'\n", token);
+        return -1;
+      }
+      if (is_input) {
+        commands[num].input = tokens[++i];
+      } else {
+        commands[num].append = token[1] == '>';
+        commands[num].output = tokens[++i];
+      }
+      continue;
+    }
+    commands[num].argv[argc++] = token;
+  }
+  if (argc == 0) {
+    if (num > 0) {
+      printf(PrintLevel::error, "sh: syntax error near '|'\n");
+      return -1;
+    }
+    return 0;
+  }
+  commands[num].argv[argc] = nullptr;
+  return num + 1;
+}
+
+// the file is created if it does not exist. Files cannot be truncated,
+// so > refuses an existing one instead of leaving its old tail behind,
+// >> writes from its end
+static int OpenOutput(const Command& command) {
+  int fd = syscall::open(command.output);
+  if (fd < 0) {
+    return syscall::create(command.output, fs::FileType::regular_file);
+  }
+  if (!command.append) {
+    printf("sh: %s: file exists, use >> to append\n", command.output);
+    syscall::close(fd);
+    return -1;
+  }
+  uint64_t end = 0;
+  if (syscall::lseek(fd, 0, uio_def::end, &end) < 0) {
+    syscall::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// in the child, in_fd and out_fd are pipe ends or -1, files named by the
+// redirections take precedence over them
+static void RunCommand(Command& command, int in_fd, int out_fd) {
+  if (command.input) {
+    int fd = syscall::open(command.input);
+    if (fd < 0) {
+      printf("sh: %s: No such file or directory\n", command.input);
+      syscall::exit(-1);
+    }
+    if (in_fd >= 0) {
+      syscall::close(in_fd);
+    }
+    in_fd = fd;
+  }
+  if (command.output) {
+    int fd = OpenOutput(command);
+    if (fd < 0) {
+      printf("sh: %s: cannot open for writing\n", command.output);
+      syscall::exit(-1);
+    }
+    if (out_fd >= 0) {
+      syscall::close(out_fd);
+    }
+    out_fd = fd;
+  }
+  if (in_fd >= 0) {
+    syscall::dup2(in_fd, descriptor_def::io::input);
+    syscall::close(in_fd);
+  }
+  if (out_fd >= 0) {
+    syscall::dup2(out_fd, descriptor_def::io::console);
+    syscall::close(out_fd);
+  }
+  syscall::exec(command.argv[0], command.argv);
+  printf("%s: command not found\n", command.argv[0]);
+  syscall::exit(-1);
+}
+
+// every stage runs in a child of its own, the output of one feeds the
+// input of the next through a pipe, waits for all of them
+static void RunPipeline(Command* commands, int num) {
+  int pids[MAX_COMMANDS];
+  int started = 0;
+  int prev_read = -1;
+  for (int i = 0; i < num; ++i) {
+    int fds[2] = {-1, -1};
+    if (i + 1 < num && syscall::pipe(fds) < 0) {
+      printf("sh: trying to create a pipe failed\n");
+      break;
+    }
+    int pid = syscall::fork();
+    if (pid == 0) {
+      // the read end belongs to the next stage
+      if (fds[0] >= 0) {
+        syscall::close(fds[0]);
+      }
+      RunCommand(commands[i], prev_read, fds[1]);
+    }
+    // the shell keeps no write end, or the readers would never see the end
+    if (prev_read >= 0) {
+      syscall::close(prev_read);
+    }
+    if (fds[1] >= 0) {
+      syscall::close(fds[1]);
+    }
+    prev_read = fds[0];
+    if (pid < 0) {
+      printf("trying to create a new process failed\n");
+      break;
+    }
+    pids[started++] = pid;
+  }
+  if (prev_read >= 0) {
+    syscall::close(prev_read);
+  }
+  for (int i = 0; i < started; ++i) {
+    syscall::wait4(pids[i], nullptr);
+  }
+}
 
 int main(void) {
   const char* console_path = "/dev/console";
@@ -27,28 +188,33 @@ int main(void) {
     char buf[128];
     syscall::getcwd(buf, 128);
     printf("\033[34;1m%s\033[32;1m$\033[0m > ", buf);
-    int n = syscall::read(console, buf, 128);
+    int n = syscall::read(console, buf, 127);
+    if (n <= 0) {
+      continue;
+    }
     if (buf[n - 1] == '\n') {
-      buf[n - 1] = '\0';
+      n -= 1;
     }
-    char split_ret[16][32];
+    buf[n] = '\0';
+    char split_ret[MAX_TOKENS][32];
     int token_num = lib::common::SplitString(buf, split_ret, ' ');
     if (token_num < 0) {
       printf(PrintLevel::error, "sh: command argument to mush\n");
       continue;
     }
-    char* argv[16 + 1];
-    for (int i = 0; i < token_num; ++i) {
-      argv[i] = split_ret[i];
+    Command commands[MAX_COMMANDS];
+    int command_num = ParseLine(split_ret, token_num, commands);
+    if (command_num <= 0) {
+      continue;
     }
-    argv[token_num] = nullptr;
-    if (strcmp(argv[0], "cd") == 0) {
-      if (token_num > 2) {
+    char** argv = commands[0].argv;
+    if (command_num == 1 && strcmp(argv[0], "cd") == 0) {
+      if (argv[1] && argv[2]) {
         printf("cd: too many arguments\n");
         continue;
       }
       int cd_ret;
-      if (token_num == 1) {
+      if (!argv[1]) {
         cd_ret = syscall::chdir("/");
       } else {
         cd_ret = syscall::chdir(argv[1]);
@@ -60,17 +226,7 @@ int main(void) {
       }
       continue;
     }
-    int sub_process = syscall::fork();
-    if (sub_process < 0) {
-      printf("trying to create a new process failed\n");
-      continue;
-    }
-    if (sub_process == 0) {
-      syscall::exec(split_ret[0], argv);
-      printf("%s: command not found\n", split_ret[0]);
-      return -1;
-    }
-    syscall::wait();
+    RunPipeline(commands, command_num);
   }
   // never reach
   return 0;
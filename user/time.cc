@@ -1,43 +1,38 @@
+#include "lib/clock.h"
 #include "lib/lib.h"
 #include "lib/syscall.h"
 
-class TimeMonitor {
- public:
-  TimeMonitor() : tick_(syscall::uptime()) {}
-  ~TimeMonitor() {
-    if (!need_output_) {
-      return;
-    }
-    auto cur = syscall::uptime();
-    printf(PrintLevel::info, "Total use time tick: %d\n", cur - tick_);
-  }
-  void disable() {
-    need_output_ = false;
-  }
- private:
-  int tick_;
-  bool need_output_ = true;
-};
+static uint64_t ToMs(const time_def::timespec& ts) {
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1'000'000;
+}
 
 int main(int argc, char** argv) {
   if (argc == 1) {
     printf(PrintLevel::error, "time: missing operand\nTry 'time --help' for more information.\n");
     return -1;
   }
-  {
-    TimeMonitor monitor;
-    int sub_process = syscall::fork();
-    if (sub_process < 0) {
-      printf("trying to create a new process failed\n");
-      return -1;
-    }
-    if (sub_process == 0) {
-      syscall::exec(argv[1], argv + 1);
-      printf("%s: command not found\n", argv[1]);
-      monitor.disable();
-      return -1;
-    }
-    syscall::wait();
+  uint64_t start_ns = lib::clock_now();
+  int sub_process = syscall::fork();
+  if (sub_process < 0) {
+    printf("trying to create a new process failed\n");
+    return -1;
+  }
+  if (sub_process == 0) {
+    syscall::exec(argv[1], argv + 1);
+    printf("%s: command not found\n", argv[1]);
+    syscall::exit(-1);
+  }
+  int exit_code = 0;
+  rusage_def::rusage usage{};
+  if (syscall::wait4(sub_process, &exit_code, &usage) < 0) {
+    return -1;
   }
-  return 0;
+  uint64_t real_ms = (lib::clock_now() - start_ns) / 1'000'000;
+  uint64_t user_ms = ToMs(usage.utime);
+  uint64_t sys_ms = ToMs(usage.stime);
+  printf(PrintLevel::info, "real %lu.%03lus user %lu.%03lus sys %lu.%03lus\n",
+         real_ms / 1000, real_ms % 1000, user_ms / 1000, user_ms % 1000, sys_ms / 1000, sys_ms % 1000);
+  printf(PrintLevel::info, "io %lu blocks in %lu out, context switches %lu voluntary %lu involuntary\n",
+         usage.inblock, usage.oublock, usage.nvcsw, usage.nivcsw);
+  return exit_code;
 }
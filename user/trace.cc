@@ -0,0 +1,68 @@
+#include "lib/lib.h"
+#include "lib/string.h"
+#include "lib/syscall.h"
+
+// Records are printed as raw little endian bytes in hex, one per line,
+// tools/trace_decode.py turns a console log of them into readable events.
+static void Dump() {
+  static trace_def::record records[64];
+  const char* digits = "0123456789abcdef";
+  while (true) {
+    int num = syscall::trace_read(records, 64);
+    if (num <= 0) {
+      break;
+    }
+    for (int i = 0; i < num; ++i) {
+      char line[2 * sizeof(trace_def::record) + 1] = {0};
+      auto* bytes = reinterpret_cast<const uint8_t*>(&records[i]);
+      for (size_t j = 0; j < sizeof(trace_def::record); ++j) {
+        line[2 * j] = digits[bytes[j] >> 4];
+        line[2 * j + 1] = digits[bytes[j] & 0xf];
+      }
+      printf("trace %s\n", line);
+    }
+  }
+  printf("trace dropped %d\n", syscall::trace_ctl(trace_def::dropped));
+}
+
+// trace start|stop|clear|dump, or trace run command [args...]
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf(PrintLevel::error, "trace: missing operand\nUsage: trace start|stop|clear|dump|run command\n");
+    return -1;
+  }
+  if (strcmp(argv[1], "start") == 0) {
+    return syscall::trace_ctl(trace_def::start);
+  }
+  if (strcmp(argv[1], "stop") == 0) {
+    return syscall::trace_ctl(trace_def::stop);
+  }
+  if (strcmp(argv[1], "clear") == 0) {
+    return syscall::trace_ctl(trace_def::clear);
+  }
+  if (strcmp(argv[1], "dump") == 0) {
+    Dump();
+    return 0;
+  }
+  if (strcmp(argv[1], "run") == 0 && argc > 2) {
+    syscall::trace_ctl(trace_def::clear);
+    syscall::trace_ctl(trace_def::start);
+    int sub_process = syscall::fork();
+    if (sub_process < 0) {
+      syscall::trace_ctl(trace_def::stop);
+      printf(PrintLevel::error, "trace: fork failed\n");
+      return -1;
+    }
+    if (sub_process == 0) {
+      syscall::exec(argv[2], argv + 2);
+      printf("%s: command not found\n", argv[2]);
+      syscall::exit(-1);
+    }
+    syscall::wait4(sub_process, nullptr);
+    syscall::trace_ctl(trace_def::stop);
+    Dump();
+    return 0;
+  }
+  printf(PrintLevel::error, "trace: unknown command %s\n", argv[1]);
+  return -1;
+}